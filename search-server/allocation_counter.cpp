@@ -0,0 +1,140 @@
+#include "allocation_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+thread_local size_t thread_allocation_count = 0;
+
+void *Allocate(size_t size, size_t alignment) noexcept
+{
+    ++thread_allocation_count;
+    size = size == 0U ? 1U : size;
+    if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+    {
+        return std::malloc(size);
+    }
+    // aligned_alloc needs a multiple of the alignment
+    return std::aligned_alloc(alignment, (size + alignment - 1U) / alignment * alignment);
+}
+
+void *AllocateOrThrow(size_t size, size_t alignment)
+{
+    if (void *memory = Allocate(size, alignment))
+    {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void Release(void *memory) noexcept
+{
+    std::free(memory);
+}
+}
+
+size_t GetThreadAllocationCount()
+{
+    return thread_allocation_count;
+}
+
+void *operator new(size_t size)
+{
+    return AllocateOrThrow(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void *operator new[](size_t size)
+{
+    return AllocateOrThrow(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void *operator new(size_t size, std::align_val_t alignment)
+{
+    return AllocateOrThrow(size, static_cast<size_t>(alignment));
+}
+
+void *operator new[](size_t size, std::align_val_t alignment)
+{
+    return AllocateOrThrow(size, static_cast<size_t>(alignment));
+}
+
+void *operator new(size_t size, const std::nothrow_t& /*unused*/) noexcept
+{
+    return Allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void *operator new[](size_t size, const std::nothrow_t& /*unused*/) noexcept
+{
+    return Allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void *operator new(size_t size, std::align_val_t alignment, const std::nothrow_t& /*unused*/) noexcept
+{
+    return Allocate(size, static_cast<size_t>(alignment));
+}
+
+void *operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t& /*unused*/) noexcept
+{
+    return Allocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void *memory) noexcept
+{
+    Release(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    Release(memory);
+}
+
+void operator delete(void *memory, size_t /*unused*/) noexcept
+{
+    Release(memory);
+}
+
+void operator delete[](void *memory, size_t /*unused*/) noexcept
+{
+    Release(memory);
+}
+
+void operator delete(void *memory, std::align_val_t /*unused*/) noexcept
+{
+    Release(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t /*unused*/) noexcept
+{
+    Release(memory);
+}
+
+void operator delete(void *memory, size_t /*unused*/, std::align_val_t /*unused*/) noexcept
+{
+    Release(memory);
+}
+
+void operator delete[](void *memory, size_t /*unused*/, std::align_val_t /*unused*/) noexcept
+{
+    Release(memory);
+}
+
+void operator delete(void *memory, const std::nothrow_t& /*unused*/) noexcept
+{
+    Release(memory);
+}
+
+void operator delete[](void *memory, const std::nothrow_t& /*unused*/) noexcept
+{
+    Release(memory);
+}
+
+void operator delete(void *memory, std::align_val_t /*unused*/, const std::nothrow_t& /*unused*/) noexcept
+{
+    Release(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t /*unused*/, const std::nothrow_t& /*unused*/) noexcept
+{
+    Release(memory);
+}
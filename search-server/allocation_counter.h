@@ -0,0 +1,14 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <cstddef>
+
+// The test executable replaces every form of the global operator new,
+// so that tests can assert that code makes no heap allocations. The
+// replacements live in their own translation unit: inlined into callers,
+// their malloc/free pairing would trip -Wmismatched-new-delete.
+
+// Calls of any operator new made by the current thread
+size_t GetThreadAllocationCount();
+
+#endif // ALLOCATION_COUNTER_H
@@ -0,0 +1,345 @@
+#include <chrono>
+#include <execution>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "corpus_generator.h"
+#include "perf_counters.h"
+#include "process_queries.h"
+#include "remove_duplicates.h"
+#include "search_server.h"
+
+/**
+ * Microbenchmarks of SearchServer over a synthetic Zipfian corpus.
+ * Results are written as JSON to stdout or to --output.
+ * Build with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+ *
+ *  SearchServerBenchmark --sizes=10000,100000,1000000,10000000
+ *                        --queries=1000 --seed=42 --output=bench.json
+ *                        [--perf-counters]
+ *
+ * With --perf-counters, hardware counters of the benchmark thread are read
+ * around every measured operation and reported per operation. Counters the
+ * system does not provide are reported as null. Operations that run on
+ * other threads (par policies, ProcessQueries) only count the calling thread.
+ */
+
+using namespace std;
+
+namespace
+{
+using Clock = chrono::steady_clock;
+
+struct BenchmarkOptions
+{
+    vector<size_t> corpus_sizes = {10000, 100000};
+    size_t query_count = 1000;
+    uint64_t seed = 42;
+    string output_path;
+    bool perf_counters = false;
+};
+
+struct Measurement
+{
+    size_t corpus_size = 0;
+    string operation;
+    size_t iterations = 0;
+    uint64_t total_ns = 0;
+    PerfCounterValues counters;
+};
+
+// Documents are generated in batches so that a 10M corpus never has
+// to be materialized next to the index
+const size_t GENERATION_BATCH = 100000;
+
+const char STOP_WORDS[] = "a an and in of the to with";
+
+vector<size_t> ParseSizes(const string &text)
+{
+    vector<size_t> sizes;
+    istringstream input(text);
+    string item;
+    while (getline(input, item, ','))
+    {
+        sizes.push_back(stoull(item));
+    }
+    return sizes;
+}
+
+BenchmarkOptions ParseOptions(int argc, char *argv[])
+{
+    BenchmarkOptions options;
+    for (int ii = 1; ii < argc; ++ii)
+    {
+        const string argument = argv[ii];
+        const auto separator = argument.find('=');
+        const string name = argument.substr(0, separator);
+        const string value = separator == string::npos ? ""s : argument.substr(separator + 1);
+
+        if (name == "--sizes"s)
+        {
+            options.corpus_sizes = ParseSizes(value);
+        }
+        else if (name == "--queries"s)
+        {
+            options.query_count = stoull(value);
+        }
+        else if (name == "--seed"s)
+        {
+            options.seed = stoull(value);
+        }
+        else if (name == "--output"s)
+        {
+            options.output_path = value;
+        }
+        else if (name == "--perf-counters"s)
+        {
+            options.perf_counters = true;
+        }
+        else
+        {
+            throw invalid_argument("Unknown argument "s + argument);
+        }
+    }
+    return options;
+}
+
+// Set when --perf-counters is given
+PerfCounters *perf_counters = nullptr;
+
+template <typename Operation>
+Measurement Measure(size_t corpus_size,
+                    const string &operation,
+                    size_t iterations,
+                    Operation run)
+{
+    if (perf_counters != nullptr)
+    {
+        perf_counters->Start();
+    }
+    const auto start = Clock::now();
+    run();
+    const auto finish = Clock::now();
+
+    Measurement measurement{corpus_size,
+                            operation,
+                            iterations,
+                            static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(finish - start).count()),
+                            {}};
+    if (perf_counters != nullptr)
+    {
+        measurement.counters = perf_counters->Stop();
+    }
+    return measurement;
+}
+
+void AddCounters(PerfCounterValues &total, const PerfCounterValues &values)
+{
+    for (size_t ii = 0; ii < PERF_EVENT_COUNT; ++ii)
+    {
+        if (values[ii])
+        {
+            total[ii] = total[ii].value_or(0) + *values[ii];
+        }
+    }
+}
+
+void RunCorpus(size_t corpus_size,
+               const BenchmarkOptions &options,
+               vector<Measurement> &measurements)
+{
+    CorpusOptions corpus_options;
+    corpus_options.seed = options.seed;
+    CorpusGenerator generator(corpus_options);
+    SearchServer search_server(string{STOP_WORDS});
+
+    cerr << "corpus "s << corpus_size << ": AddDocument"s << endl;
+    Measurement add{corpus_size, "AddDocument"s, corpus_size, 0, {}};
+    for (size_t added = 0; added < corpus_size; added += GENERATION_BATCH)
+    {
+        vector<GeneratedDocument> batch;
+        const size_t batch_size = min(GENERATION_BATCH, corpus_size - added);
+        batch.reserve(batch_size);
+        for (size_t ii = 0; ii < batch_size; ++ii)
+        {
+            batch.push_back(generator.NextDocument());
+        }
+
+        const Measurement batch_measurement =
+                Measure(corpus_size, add.operation, batch_size, [&]()
+        {
+            for (const GeneratedDocument &document : batch)
+            {
+                search_server.AddDocument(document.id, document.text,
+                                          document.status, document.ratings);
+            }
+        });
+        add.total_ns += batch_measurement.total_ns;
+        AddCounters(add.counters, batch_measurement.counters);
+    }
+    measurements.push_back(add);
+
+    vector<string> queries;
+    vector<int> match_ids;
+    for (size_t ii = 0; ii < options.query_count; ++ii)
+    {
+        queries.push_back(generator.NextQuery(3, 1));
+        match_ids.push_back(static_cast<int>(generator.NextBelow(corpus_size)));
+    }
+
+    cerr << "corpus "s << corpus_size << ": queries"s << endl;
+    measurements.push_back(Measure(corpus_size, "FindTopDocuments(seq)"s, queries.size(), [&]()
+    {
+        for (const string &query : queries)
+        {
+            search_server.FindTopDocuments(execution::seq, query);
+        }
+    }));
+
+    measurements.push_back(Measure(corpus_size, "FindTopDocuments(par)"s, queries.size(), [&]()
+    {
+        for (const string &query : queries)
+        {
+            search_server.FindTopDocuments(execution::par, query);
+        }
+    }));
+
+    measurements.push_back(Measure(corpus_size, "MatchDocument"s, queries.size(), [&]()
+    {
+        for (size_t ii = 0; ii < queries.size(); ++ii)
+        {
+            search_server.MatchDocument(queries[ii], match_ids[ii]);
+        }
+    }));
+
+    measurements.push_back(Measure(corpus_size, "ProcessQueries"s, queries.size(), [&]()
+    {
+        ProcessQueries(search_server, queries);
+    }));
+
+    cerr << "corpus "s << corpus_size << ": removal"s << endl;
+    {
+        // RemoveDuplicates reports every duplicate to cout, which would
+        // both skew the timing and corrupt JSON written to stdout
+        ostringstream discarded;
+        auto *const cout_buffer = cout.rdbuf(discarded.rdbuf());
+        measurements.push_back(Measure(corpus_size, "RemoveDuplicates"s, 1, [&]()
+        {
+            RemoveDuplicates(search_server);
+        }));
+        cout.rdbuf(cout_buffer);
+    }
+
+    const size_t remove_count = max<size_t>(1, corpus_size / 100);
+    vector<int> remove_ids;
+    for (size_t ii = 0; ii < remove_count; ++ii)
+    {
+        remove_ids.push_back(static_cast<int>(generator.NextBelow(corpus_size)));
+    }
+    measurements.push_back(Measure(corpus_size, "RemoveDocument"s, remove_ids.size(), [&]()
+    {
+        for (const int id : remove_ids)
+        {
+            search_server.RemoveDocument(id);
+        }
+    }));
+
+    vector<int> purge_ids(search_server.begin(), search_server.end());
+    purge_ids.resize(purge_ids.size() / 2);
+    measurements.push_back(Measure(corpus_size, "RemoveDocuments"s, max<size_t>(1, purge_ids.size()), [&]()
+    {
+        search_server.RemoveDocuments(execution::par, purge_ids);
+    }));
+}
+
+void WriteJson(ostream &output,
+               const BenchmarkOptions &options,
+               const vector<Measurement> &measurements)
+{
+    output << "{\n  \"benchmark\": \"search-server\",\n  \"seed\": "s << options.seed
+           << ",\n  \"perf_counters_available\": "s
+           << (perf_counters != nullptr && perf_counters->IsAvailable() ? "true"s : "false"s)
+           << ",\n  \"query_count\": "s << options.query_count
+           << ",\n  \"results\": ["s;
+    for (size_t ii = 0; ii < measurements.size(); ++ii)
+    {
+        const Measurement &measurement = measurements[ii];
+        const double ns_per_op = static_cast<double>(measurement.total_ns) /
+                static_cast<double>(max<size_t>(1, measurement.iterations));
+        output << (ii == 0 ? "\n"s : ",\n"s)
+               << "    {\"corpus_size\": "s << measurement.corpus_size
+               << ", \"operation\": \""s << measurement.operation
+               << "\", \"iterations\": "s << measurement.iterations
+               << ", \"total_ns\": "s << measurement.total_ns
+               << ", \"ns_per_op\": "s << ns_per_op
+               << ", \"ops_per_second\": "s << (ns_per_op > 0.0 ? 1e9 / ns_per_op : 0.0);
+        if (perf_counters != nullptr)
+        {
+            output << ", \"counters_per_op\": {"s;
+            for (size_t event = 0; event < PERF_EVENT_COUNT; ++event)
+            {
+                output << (event == 0 ? "\""s : ", \""s)
+                       << PerfCounters::GetEventName(static_cast<PerfEvent>(event)) << "\": "s;
+                if (measurement.counters[event])
+                {
+                    output << static_cast<double>(*measurement.counters[event]) /
+                              static_cast<double>(max<size_t>(1, measurement.iterations));
+                }
+                else
+                {
+                    output << "null"s;
+                }
+            }
+            output << "}"s;
+        }
+        output << "}"s;
+    }
+    output << "\n  ]\n}"s << endl;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        const BenchmarkOptions options = ParseOptions(argc, argv);
+
+        unique_ptr<PerfCounters> counters;
+        if (options.perf_counters)
+        {
+            counters = make_unique<PerfCounters>();
+            if (!counters->IsAvailable())
+            {
+                cerr << "hardware counters are unavailable, reporting null"s << endl;
+            }
+            perf_counters = counters.get();
+        }
+
+        vector<Measurement> measurements;
+        for (const size_t corpus_size : options.corpus_sizes)
+        {
+            RunCorpus(corpus_size, options, measurements);
+        }
+
+        if (options.output_path.empty())
+        {
+            WriteJson(cout, options, measurements);
+        }
+        else
+        {
+            ofstream output(options.output_path);
+            WriteJson(output, options, measurements);
+        }
+    }
+    catch (const exception &error)
+    {
+        cerr << error.what() << endl;
+        return 1;
+    }
+    return 0;
+}
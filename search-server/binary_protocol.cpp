@@ -0,0 +1,218 @@
+#include "binary_protocol.h"
+
+#include <cstring>
+
+using namespace std::literals::string_literals;
+
+MessageWriter::MessageWriter()
+    : buffer_(FrameHeader::SIZE, '\0')
+{
+
+}
+
+void MessageWriter::PutU8(uint8_t value)
+{
+    buffer_.push_back(static_cast<char>(value));
+}
+
+void MessageWriter::PutU32(uint32_t value)
+{
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        buffer_.push_back(static_cast<char>((value >> shift) & 0xFFU));
+    }
+}
+
+void MessageWriter::PutI32(int32_t value)
+{
+    PutU32(static_cast<uint32_t>(value));
+}
+
+void MessageWriter::PutDouble(double value)
+{
+    uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    PutU32(static_cast<uint32_t>(bits));
+    PutU32(static_cast<uint32_t>(bits >> 32U));
+}
+
+void MessageWriter::PutString(std::string_view value)
+{
+    PutU32(static_cast<uint32_t>(value.size()));
+    buffer_.append(value);
+}
+
+std::string MessageWriter::Finish(uint32_t request_id, uint8_t type)
+{
+    const size_t payload_size = buffer_.size() - FrameHeader::SIZE;
+    if (payload_size > FrameHeader::MAX_PAYLOAD_SIZE)
+    {
+        throw ProtocolError("Message payload is too large"s);
+    }
+
+    size_t offset = 0;
+    for (const uint32_t value : {static_cast<uint32_t>(payload_size), request_id})
+    {
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            buffer_[offset++] = static_cast<char>((value >> shift) & 0xFFU);
+        }
+    }
+    buffer_[offset] = static_cast<char>(type);
+    return std::move(buffer_);
+}
+
+MessageReader::MessageReader(std::string_view payload)
+    : payload_(payload)
+{
+
+}
+
+uint8_t MessageReader::GetU8()
+{
+    return static_cast<uint8_t>(Take(1)[0]);
+}
+
+uint32_t MessageReader::GetU32()
+{
+    const std::string_view bytes = Take(4);
+    uint32_t value = 0;
+    for (int ii = 3; ii >= 0; --ii)
+    {
+        value = (value << 8U) | static_cast<uint8_t>(bytes[ii]);
+    }
+    return value;
+}
+
+int32_t MessageReader::GetI32()
+{
+    return static_cast<int32_t>(GetU32());
+}
+
+double MessageReader::GetDouble()
+{
+    const uint64_t low = GetU32();
+    const uint64_t bits = low | (static_cast<uint64_t>(GetU32()) << 32U);
+    double value = 0.0;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+std::string_view MessageReader::GetString()
+{
+    return Take(GetU32());
+}
+
+void MessageReader::ExpectEnd() const
+{
+    if (!payload_.empty())
+    {
+        throw ProtocolError("Unexpected bytes at the end of a message"s);
+    }
+}
+
+std::string_view MessageReader::Take(size_t size)
+{
+    if (size > payload_.size())
+    {
+        throw ProtocolError("Message is truncated"s);
+    }
+    const std::string_view bytes = payload_.substr(0, size);
+    payload_.remove_prefix(size);
+    return bytes;
+}
+
+FrameHeader DecodeFrameHeader(std::string_view header)
+{
+    MessageReader reader(header.substr(0, FrameHeader::SIZE));
+    FrameHeader result;
+    result.payload_size = reader.GetU32();
+    result.request_id = reader.GetU32();
+    result.type = reader.GetU8();
+    if (result.payload_size > FrameHeader::MAX_PAYLOAD_SIZE)
+    {
+        throw ProtocolError("Message payload is too large"s);
+    }
+    return result;
+}
+
+void PutStatistics(MessageWriter &writer, const CorpusStatistics &statistics)
+{
+    writer.PutI32(statistics.document_count);
+    writer.PutU32(static_cast<uint32_t>(statistics.document_freqs.size()));
+    for (const auto &[word, document_freq] : statistics.document_freqs)
+    {
+        writer.PutString(word);
+        writer.PutI32(document_freq);
+    }
+    writer.PutU32(static_cast<uint32_t>(statistics.prefixes.size()));
+    for (const auto &prefix : statistics.prefixes)
+    {
+        writer.PutString(prefix);
+    }
+}
+
+CorpusStatistics GetStatistics(MessageReader &reader)
+{
+    CorpusStatistics statistics;
+    statistics.document_count = reader.GetI32();
+    const uint32_t word_count = reader.GetU32();
+    for (uint32_t ii = 0; ii < word_count; ++ii)
+    {
+        const std::string_view word = reader.GetString();
+        statistics.document_freqs.emplace(word, reader.GetI32());
+    }
+    const uint32_t prefix_count = reader.GetU32();
+    for (uint32_t ii = 0; ii < prefix_count; ++ii)
+    {
+        statistics.prefixes.emplace(reader.GetString());
+    }
+    return statistics;
+}
+
+void PutDocuments(MessageWriter &writer, const std::vector<Document> &documents)
+{
+    writer.PutU32(static_cast<uint32_t>(documents.size()));
+    for (const Document &document : documents)
+    {
+        writer.PutI32(document.id);
+        writer.PutDouble(document.relevance);
+        writer.PutI32(document.rating);
+    }
+}
+
+std::vector<Document> GetDocuments(MessageReader &reader)
+{
+    const uint32_t count = reader.GetU32();
+    std::vector<Document> documents;
+    for (uint32_t ii = 0; ii < count; ++ii)
+    {
+        const int id = reader.GetI32();
+        const double relevance = reader.GetDouble();
+        documents.emplace_back(id, relevance, reader.GetI32());
+    }
+    return documents;
+}
+
+DocumentStatus GetDocumentStatus(MessageReader &reader)
+{
+    const uint8_t status = reader.GetU8();
+    if (status > static_cast<uint8_t>(DocumentStatus::REMOVED))
+    {
+        throw ProtocolError("Unknown document status "s + std::to_string(status));
+    }
+    return static_cast<DocumentStatus>(status);
+}
+
+void ThrowRemoteError(ResponseStatus status, std::string_view message)
+{
+    switch (status)
+    {
+    case ResponseStatus::INVALID_ARGUMENT:
+        throw std::invalid_argument(std::string{message});
+    case ResponseStatus::OUT_OF_RANGE:
+        throw std::out_of_range(std::string{message});
+    default:
+        throw std::runtime_error(std::string{message});
+    }
+}
@@ -0,0 +1,110 @@
+#ifndef BINARY_PROTOCOL_H
+#define BINARY_PROTOCOL_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "corpus_statistics.h"
+#include "document.h"
+
+/**
+ * Compact binary protocol for remote SearchServer calls.
+ *
+ * Every message is a frame: a header of payload length (u32), request id
+ * (u32) and message type (u8), followed by the payload. Integers are
+ * little-endian, doubles are sent as their IEEE-754 bits, strings and
+ * arrays are prefixed with a u32 size. A response carries the id of its
+ * request and a ResponseStatus as its type; responses on a connection
+ * come in request order, so requests may be pipelined.
+ */
+
+enum class MessageType : uint8_t
+{
+    ADD_DOCUMENT = 1,
+    REMOVE_DOCUMENT = 2,
+    COLLECT_STATISTICS = 3,
+    FIND_TOP_DOCUMENTS = 4,
+    MATCH_DOCUMENT = 5,
+    GET_DOCUMENT_COUNT = 6,
+};
+
+enum class ResponseStatus : uint8_t
+{
+    OK = 0,
+    INVALID_ARGUMENT = 1,
+    OUT_OF_RANGE = 2,
+    INTERNAL_ERROR = 3,
+};
+
+struct ProtocolError : std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+struct FrameHeader
+{
+    static constexpr size_t SIZE = 9;
+    // Protects a peer from allocating for a corrupt length
+    static constexpr uint32_t MAX_PAYLOAD_SIZE = 64U << 20U;
+
+    uint32_t payload_size = 0;
+    uint32_t request_id = 0;
+    uint8_t type = 0;
+};
+
+class MessageWriter
+{
+public:
+    MessageWriter();
+
+    void PutU8(uint8_t value);
+    void PutU32(uint32_t value);
+    void PutI32(int32_t value);
+    void PutDouble(double value);
+    void PutString(std::string_view value);
+
+    // Header and payload, ready to be sent
+    std::string Finish(uint32_t request_id, uint8_t type);
+
+private:
+    std::string buffer_;
+};
+
+class MessageReader
+{
+public:
+    explicit MessageReader(std::string_view payload);
+
+    uint8_t GetU8();
+    uint32_t GetU32();
+    int32_t GetI32();
+    double GetDouble();
+    std::string_view GetString();
+
+    // Throws ProtocolError if unread bytes are left
+    void ExpectEnd() const;
+
+private:
+    std::string_view Take(size_t size);
+
+    std::string_view payload_;
+};
+
+FrameHeader DecodeFrameHeader(std::string_view header);
+
+void PutStatistics(MessageWriter &writer, const CorpusStatistics &statistics);
+CorpusStatistics GetStatistics(MessageReader &reader);
+
+void PutDocuments(MessageWriter &writer, const std::vector<Document> &documents);
+std::vector<Document> GetDocuments(MessageReader &reader);
+
+DocumentStatus GetDocumentStatus(MessageReader &reader);
+
+// Rethrows the exception a server reported in an error response
+[[noreturn]] void ThrowRemoteError(ResponseStatus status, std::string_view message);
+
+#endif // BINARY_PROTOCOL_H
@@ -0,0 +1,76 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// Blocking queue between producer and consumer threads. A full queue
+// stops the producers, so a fast producer cannot run ahead unboundedly.
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity) :
+        capacity_(capacity == 0U ? 1U : capacity)
+    {
+
+    }
+
+    // Blocks while the queue is full. False once the queue is closed.
+    bool Push(T item)
+    {
+        std::unique_lock lock(mutex_);
+        not_full_.wait(lock, [this]()
+        {
+            return closed_ || items_.size() < capacity_;
+        });
+        if (closed_)
+        {
+            return false;
+        }
+        items_.push_back(std::move(item));
+        lock.unlock();
+        not_empty_.notify_one();
+        return true;
+    }
+
+    // Blocks while the queue is empty. False once it is closed and drained.
+    bool Pop(T &item)
+    {
+        std::unique_lock lock(mutex_);
+        not_empty_.wait(lock, [this]()
+        {
+            return closed_ || !items_.empty();
+        });
+        if (items_.empty())
+        {
+            return false;
+        }
+        item = std::move(items_.front());
+        items_.pop_front();
+        lock.unlock();
+        not_full_.notify_one();
+        return true;
+    }
+
+    void Close()
+    {
+        {
+            std::lock_guard lock(mutex_);
+            closed_ = true;
+        }
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+private:
+    const size_t capacity_;
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+    std::deque<T> items_;
+    bool closed_ = false;
+};
+
+#endif // BOUNDED_QUEUE_H
@@ -0,0 +1,60 @@
+#include "concurrent_request_queue.h"
+
+#include <limits>
+
+ConcurrentRequestQueue::ConcurrentRequestQueue(const SearchServer& search_server) :
+    search_server_(search_server),
+    next_slot_(0),
+    no_result_requests_(0)
+{
+    for (auto &slot : slots_)
+    {
+        slot.store(empty_slot_, std::memory_order_relaxed);
+    }
+}
+
+std::vector<Document>
+ConcurrentRequestQueue::AddFindRequest(const std::string& raw_query,
+                                       DocumentStatus status)
+{
+    return AddFindRequest(raw_query,
+                          [status](int  /*unused*/,
+                          DocumentStatus document_status,
+                          int  /*unused*/)
+    {
+        return document_status == status;
+    });
+}
+
+std::vector<Document> ConcurrentRequestQueue::AddFindRequest(const std::string& raw_query)
+{
+    return AddFindRequest(raw_query, DocumentStatus::ACTUAL);
+}
+
+void ConcurrentRequestQueue::RecordRequest(size_t founded_docs)
+{
+    const auto value = static_cast<int32_t>(
+                std::min<size_t>(founded_docs, std::numeric_limits<int32_t>::max()));
+
+    const uint64_t position = next_slot_.fetch_add(1, std::memory_order_relaxed);
+    const int32_t evicted = slots_[position % min_in_day_].exchange(value,
+                                                                    std::memory_order_acq_rel);
+    if (value == 0)
+    {
+        no_result_requests_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (evicted == 0)
+    {
+        no_result_requests_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+int ConcurrentRequestQueue::GetNoResultRequests() const
+{
+    return no_result_requests_.load(std::memory_order_relaxed);
+}
+
+uint64_t ConcurrentRequestQueue::GetTotalRequests() const
+{
+    return next_slot_.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,63 @@
+#ifndef CONCURRENT_REQUEST_QUEUE_H
+#define CONCURRENT_REQUEST_QUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "search_server.h"
+
+// RequestQueue for many producer threads. The window of the last
+// min_in_day_ requests is a fixed ring of atomic slots: a producer claims
+// a slot with fetch_add and swaps its result in, so the evicted request
+// is known without locking and the statistics stay O(1).
+class ConcurrentRequestQueue
+{
+public:
+
+    explicit ConcurrentRequestQueue(const SearchServer& search_server);
+
+    template <typename DocumentPredicate>
+    std::vector<Document> AddFindRequest(const std::string& raw_query,
+                                         DocumentPredicate document_predicate);
+
+    std::vector<Document> AddFindRequest(const std::string& raw_query,
+                                         DocumentStatus status);
+
+    std::vector<Document> AddFindRequest(const std::string& raw_query);
+
+    // Records a request whose search already ran elsewhere
+    void RecordRequest(size_t founded_docs);
+
+    // Exact once concurrent RecordRequest calls have returned
+    int GetNoResultRequests() const;
+
+    uint64_t GetTotalRequests() const;
+
+private:
+
+    const static size_t min_in_day_ = 1440;
+
+    static const int32_t empty_slot_ = -1;
+
+    const SearchServer& search_server_;
+
+    std::array<std::atomic<int32_t>, min_in_day_> slots_;
+
+    std::atomic<uint64_t> next_slot_;
+
+    std::atomic<int> no_result_requests_;
+};
+
+template <typename DocumentPredicate>
+std::vector<Document>
+ConcurrentRequestQueue::AddFindRequest(const std::string& raw_query,
+                                       DocumentPredicate document_predicate)
+{
+    std::vector<Document> result =
+            search_server_.FindTopDocuments(raw_query, document_predicate);
+    RecordRequest(result.size());
+    return result;
+}
+
+#endif // CONCURRENT_REQUEST_QUEUE_H
@@ -0,0 +1,160 @@
+#include "corpus_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+#include "hashing.h"
+
+namespace
+{
+// Distinct bijective base-26 spelling of the index behind a pseudo-random
+// letter, so that frequent and rare words look alike
+std::string MakeWord(size_t index)
+{
+    std::string word(1, static_cast<char>('a' + MixHash(index) % 26U));
+    size_t rest = index + 1;
+    while (rest != 0U)
+    {
+        --rest;
+        word += static_cast<char>('a' + rest % 26U);
+        rest /= 26U;
+    }
+    return word;
+}
+
+const size_t RECENT_TEXT_COUNT = 64;
+}
+
+CorpusGenerator::CorpusGenerator(const CorpusOptions &options) :
+    options_(options),
+    state_(options.seed)
+{
+    using namespace std::literals::string_literals;
+
+    if (options_.vocabulary_size == 0U ||
+            options_.min_document_words == 0U ||
+            options_.min_document_words > options_.max_document_words)
+    {
+        throw std::invalid_argument("Invalid corpus options"s);
+    }
+
+    vocabulary_.reserve(options_.vocabulary_size);
+    zipf_cdf_.reserve(options_.vocabulary_size);
+    double total = 0.0;
+    for (size_t rank = 0; rank < options_.vocabulary_size; ++rank)
+    {
+        vocabulary_.push_back(MakeWord(rank));
+        total += 1.0 / std::pow(static_cast<double>(rank + 1), options_.zipf_exponent);
+        zipf_cdf_.push_back(total);
+    }
+    for (double &value : zipf_cdf_)
+    {
+        value /= total;
+    }
+}
+
+GeneratedDocument CorpusGenerator::NextDocument()
+{
+    GeneratedDocument document;
+    document.id = next_id_++;
+    document.status = NextStatus();
+
+    const size_t rating_count = NextBelow(options_.max_ratings + 1);
+    const uint64_t rating_range =
+            static_cast<uint64_t>(options_.max_rating - options_.min_rating) + 1;
+    for (size_t ii = 0; ii < rating_count; ++ii)
+    {
+        document.ratings.push_back(options_.min_rating +
+                                   static_cast<int>(NextBelow(rating_range)));
+    }
+
+    if (!recent_texts_.empty() && NextUnit() < options_.duplicate_share)
+    {
+        document.text = recent_texts_[NextBelow(recent_texts_.size())];
+        return document;
+    }
+
+    const size_t word_count = options_.min_document_words +
+            NextBelow(options_.max_document_words - options_.min_document_words + 1);
+    for (size_t ii = 0; ii < word_count; ++ii)
+    {
+        if (ii != 0U)
+        {
+            document.text += ' ';
+        }
+        document.text += NextWord();
+    }
+
+    if (recent_texts_.size() < RECENT_TEXT_COUNT)
+    {
+        recent_texts_.push_back(document.text);
+    }
+    else
+    {
+        recent_texts_[NextBelow(RECENT_TEXT_COUNT)] = document.text;
+    }
+    return document;
+}
+
+std::string CorpusGenerator::NextQuery(size_t plus_word_count, size_t minus_word_count)
+{
+    std::string query;
+    for (size_t ii = 0; ii < plus_word_count + minus_word_count; ++ii)
+    {
+        if (!query.empty())
+        {
+            query += ' ';
+        }
+        if (ii >= plus_word_count)
+        {
+            query += '-';
+        }
+        query += NextWord();
+    }
+    return query;
+}
+
+const std::vector<std::string> &CorpusGenerator::GetVocabulary() const
+{
+    return vocabulary_;
+}
+
+uint64_t CorpusGenerator::NextRandom()
+{
+    // splitmix64 sequence
+    state_ += 0x9e3779b97f4a7c15ULL;
+    return MixHash(state_);
+}
+
+uint64_t CorpusGenerator::NextBelow(uint64_t bound)
+{
+    return bound == 0U ? 0U : NextRandom() % bound;
+}
+
+double CorpusGenerator::NextUnit()
+{
+    return static_cast<double>(NextRandom() >> 11U) * 0x1.0p-53;
+}
+
+const std::string &CorpusGenerator::NextWord()
+{
+    const auto rank = std::upper_bound(zipf_cdf_.begin(), zipf_cdf_.end(), NextUnit());
+    return vocabulary_[std::min<size_t>(rank - zipf_cdf_.begin(), vocabulary_.size() - 1)];
+}
+
+DocumentStatus CorpusGenerator::NextStatus()
+{
+    const auto &weights = options_.status_weights;
+    double point = NextUnit() * std::accumulate(weights.begin(), weights.end(), 0.0);
+    for (size_t ii = 0; ii + 1 < weights.size(); ++ii)
+    {
+        if (point < weights[ii])
+        {
+            return static_cast<DocumentStatus>(ii);
+        }
+        point -= weights[ii];
+    }
+    return static_cast<DocumentStatus>(weights.size() - 1);
+}
@@ -0,0 +1,72 @@
+#ifndef CORPUS_GENERATOR_H
+#define CORPUS_GENERATOR_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "document.h"
+
+struct CorpusOptions
+{
+    size_t vocabulary_size = 50000;
+    // Word with rank r is drawn with probability proportional to 1 / r^s
+    double zipf_exponent = 1.0;
+    size_t min_document_words = 10;
+    size_t max_document_words = 100;
+    // Relative weights of ACTUAL, IRRELEVANT, BANNED and REMOVED documents
+    std::array<double, 4> status_weights = {0.85, 0.05, 0.05, 0.05};
+    int min_rating = -10;
+    int max_rating = 10;
+    size_t max_ratings = 5;
+    // Share of documents that repeat the word set of an earlier document
+    double duplicate_share = 0.01;
+    uint64_t seed = 42;
+};
+
+struct GeneratedDocument
+{
+    int id = 0;
+    std::string text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
+
+// Deterministic synthetic corpus: the same options produce the same
+// documents and queries on every platform, because no standard
+// distribution (whose algorithms are implementation-defined) is used
+class CorpusGenerator
+{
+public:
+    explicit CorpusGenerator(const CorpusOptions &options = {});
+
+    // Documents get consecutive ids starting from 0
+    GeneratedDocument NextDocument();
+
+    // Minus words are prefixed with '-'
+    std::string NextQuery(size_t plus_word_count, size_t minus_word_count = 0);
+
+    const std::vector<std::string> &GetVocabulary() const;
+
+    uint64_t NextRandom();
+
+    // Uniform in [0, bound)
+    uint64_t NextBelow(uint64_t bound);
+
+private:
+    CorpusOptions options_;
+    std::vector<std::string> vocabulary_;
+    std::vector<double> zipf_cdf_;
+    std::vector<std::string> recent_texts_;
+    uint64_t state_;
+    int next_id_ = 0;
+
+    double NextUnit();
+
+    const std::string &NextWord();
+
+    DocumentStatus NextStatus();
+};
+
+#endif // CORPUS_GENERATOR_H
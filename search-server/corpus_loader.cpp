@@ -0,0 +1,195 @@
+#include "corpus_loader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <charconv>
+#include <stdexcept>
+#include <system_error>
+
+#include "binary_protocol.h"
+
+using namespace std::literals::string_literals;
+
+namespace
+{
+template <typename Number>
+bool ParseNumber(std::string_view text, Number &number)
+{
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), number);
+    return !text.empty() && error == std::errc{} && end == text.data() + text.size();
+}
+
+std::string_view TakeField(std::string_view &line, char separator)
+{
+    const size_t end = line.find(separator);
+    const std::string_view field = line.substr(0, end);
+    line.remove_prefix(end == std::string_view::npos ? line.size() : end + 1U);
+    return field;
+}
+}
+
+MappedFile::MappedFile(const std::string &path)
+{
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw std::system_error(errno, std::generic_category(), "Cannot open "s + path);
+    }
+
+    struct stat file_stat{};
+    if (fstat(fd, &file_stat) != 0)
+    {
+        const int error = errno;
+        close(fd);
+        throw std::system_error(error, std::generic_category(), "Cannot stat "s + path);
+    }
+
+    size_ = static_cast<size_t>(file_stat.st_size);
+    if (size_ != 0U)
+    {
+        void *data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            const int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), "Cannot map "s + path);
+        }
+        // The corpus is read once, front to back
+        madvise(data, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(data);
+    }
+    // The mapping stays valid without the descriptor
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_ != nullptr)
+    {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+std::string_view MappedFile::GetData() const
+{
+    return {data_, size_};
+}
+
+CorpusReader::CorpusReader(std::string_view data, CorpusFormat format) :
+    data_(data),
+    format_(format)
+{
+
+}
+
+bool CorpusReader::Next(CorpusRecord &record)
+{
+    return format_ == CorpusFormat::LINES ? NextLine(record) : NextFrame(record);
+}
+
+bool CorpusReader::NextLine(CorpusRecord &record)
+{
+    if (data_.empty())
+    {
+        return false;
+    }
+
+    std::string_view line = TakeField(data_, '\n');
+    ++line_number_;
+    if (!line.empty() && line.back() == '\r')
+    {
+        line.remove_suffix(1);
+    }
+
+    record.ratings.clear();
+    if (std::count(line.begin(), line.end(), '\t') < 3)
+    {
+        record.id = next_id_++;
+        record.status = DocumentStatus::ACTUAL;
+        record.text = line;
+        return true;
+    }
+
+    const auto invalid_line = [this]()
+    {
+        return std::invalid_argument("Invalid corpus line "s + std::to_string(line_number_));
+    };
+
+    if (!ParseNumber(TakeField(line, '\t'), record.id))
+    {
+        throw invalid_line();
+    }
+    record.status = ParseDocumentStatus(TakeField(line, '\t'));
+    std::string_view ratings = TakeField(line, '\t');
+    while (!ratings.empty())
+    {
+        int rating = 0;
+        if (!ParseNumber(TakeField(ratings, ','), rating))
+        {
+            throw invalid_line();
+        }
+        record.ratings.push_back(rating);
+    }
+    record.text = line;
+    next_id_ = std::max(next_id_, record.id + 1);
+    return true;
+}
+
+bool CorpusReader::NextFrame(CorpusRecord &record)
+{
+    if (data_.empty())
+    {
+        return false;
+    }
+    if (data_.size() < FrameHeader::SIZE)
+    {
+        throw ProtocolError("Corpus ends inside a frame header"s);
+    }
+
+    const FrameHeader header = DecodeFrameHeader(data_.substr(0, FrameHeader::SIZE));
+    if (header.type != static_cast<uint8_t>(MessageType::ADD_DOCUMENT))
+    {
+        throw ProtocolError("Corpus record is not an ADD_DOCUMENT frame"s);
+    }
+    if (data_.size() - FrameHeader::SIZE < header.payload_size)
+    {
+        throw ProtocolError("Corpus ends inside a frame"s);
+    }
+
+    MessageReader reader(data_.substr(FrameHeader::SIZE, header.payload_size));
+    data_.remove_prefix(FrameHeader::SIZE + header.payload_size);
+
+    record.id = reader.GetI32();
+    record.text = reader.GetString();
+    record.status = GetDocumentStatus(reader);
+    const uint32_t rating_count = reader.GetU32();
+    if (rating_count > header.payload_size / sizeof(int32_t))
+    {
+        throw ProtocolError("Corpus record has a corrupt rating count"s);
+    }
+    record.ratings.resize(rating_count);
+    for (int &rating : record.ratings)
+    {
+        rating = reader.GetI32();
+    }
+    reader.ExpectEnd();
+    return true;
+}
+
+void AppendCorpusRecord(std::string &output, const CorpusRecord &record)
+{
+    MessageWriter writer;
+    writer.PutI32(record.id);
+    writer.PutString(record.text);
+    writer.PutU8(static_cast<uint8_t>(record.status));
+    writer.PutU32(static_cast<uint32_t>(record.ratings.size()));
+    for (const int rating : record.ratings)
+    {
+        writer.PutI32(rating);
+    }
+    output += writer.Finish(0, static_cast<uint8_t>(MessageType::ADD_DOCUMENT));
+}
@@ -0,0 +1,149 @@
+#ifndef CORPUS_LOADER_H
+#define CORPUS_LOADER_H
+
+#include <algorithm>
+#include <exception>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.h"
+#include "document.h"
+
+enum class CorpusFormat
+{
+    // One document per line: either plain text (ids are assigned in order,
+    // status ACTUAL) or "id<TAB>status<TAB>r1,r2,...<TAB>text"
+    LINES,
+    // ADD_DOCUMENT frames of the binary protocol, back to back
+    RECORDS,
+};
+
+// Read-only mapping of a whole file
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string &path);
+
+    MappedFile(const MappedFile &other) = delete;
+
+    MappedFile &operator=(const MappedFile &other) = delete;
+
+    ~MappedFile();
+
+    std::string_view GetData() const;
+
+private:
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+struct CorpusRecord
+{
+    int id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+    // Points into the corpus data
+    std::string_view text;
+};
+
+class CorpusReader
+{
+public:
+    CorpusReader(std::string_view data, CorpusFormat format);
+
+    // False at the end of the data. Throws std::invalid_argument or
+    // ProtocolError for a malformed record.
+    bool Next(CorpusRecord &record);
+
+private:
+    bool NextLine(CorpusRecord &record);
+    bool NextFrame(CorpusRecord &record);
+
+    std::string_view data_;
+    const CorpusFormat format_;
+    int next_id_ = 0;
+    size_t line_number_ = 0;
+};
+
+// Appends a record in the RECORDS format
+void AppendCorpusRecord(std::string &output, const CorpusRecord &record);
+
+struct CorpusLoadOptions
+{
+    CorpusFormat format = CorpusFormat::LINES;
+    size_t batch_size = 256;
+    // Parsed batches waiting for the index
+    size_t queue_capacity = 16;
+};
+
+// Maps the corpus file and parses it on a separate thread while the
+// calling thread adds the documents, so the text is copied only once,
+// into the index. Returns the largest document id, -1 for an empty corpus.
+template <typename Index>
+int LoadCorpus(Index &index, const std::string &path, const CorpusLoadOptions &options = {})
+{
+    const MappedFile file(path);
+    BoundedQueue<std::vector<CorpusRecord>> queue(options.queue_capacity);
+
+    std::exception_ptr parse_error;
+    std::thread parser([&file, &queue, &options, &parse_error]()
+    {
+        try
+        {
+            CorpusReader reader(file.GetData(), options.format);
+            std::vector<CorpusRecord> batch(std::max<size_t>(options.batch_size, 1U));
+            size_t filled = 0;
+            bool is_open = true;
+            while (is_open && reader.Next(batch[filled]))
+            {
+                if (++filled == batch.size())
+                {
+                    is_open = queue.Push(std::move(batch));
+                    batch.assign(std::max<size_t>(options.batch_size, 1U), CorpusRecord{});
+                    filled = 0;
+                }
+            }
+            if (is_open && filled != 0U)
+            {
+                batch.resize(filled);
+                queue.Push(std::move(batch));
+            }
+        }
+        catch (...)
+        {
+            parse_error = std::current_exception();
+        }
+        queue.Close();
+    });
+
+    int max_document_id = -1;
+    try
+    {
+        std::vector<CorpusRecord> batch;
+        while (queue.Pop(batch))
+        {
+            for (const auto &record : batch)
+            {
+                index.AddDocument(record.id, record.text, record.status, record.ratings);
+                max_document_id = std::max(max_document_id, record.id);
+            }
+        }
+    }
+    catch (...)
+    {
+        queue.Close();
+        parser.join();
+        throw;
+    }
+
+    parser.join();
+    if (parse_error)
+    {
+        std::rethrow_exception(parse_error);
+    }
+    return max_document_id;
+}
+
+#endif // CORPUS_LOADER_H
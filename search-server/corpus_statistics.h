@@ -0,0 +1,33 @@
+#ifndef CORPUS_STATISTICS_H
+#define CORPUS_STATISTICS_H
+
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+
+// Document counts of a corpus split between several servers. Ranking every
+// part with the merged counts gives the same inverse document frequencies
+// as a single server holding the whole corpus.
+struct CorpusStatistics
+{
+    int document_count = 0;
+    // Only the words of one query, not the whole dictionary. A plus
+    // word* brings every indexed word it expands to.
+    std::map<std::string, int, std::less<>> document_freqs;
+    // Plus prefixes of the query: every server expands them from the merged
+    // document_freqs, so all of them rank the same words
+    std::set<std::string, std::less<>> prefixes;
+
+    void Merge(const CorpusStatistics &other)
+    {
+        document_count += other.document_count;
+        for (const auto &[word, document_freq] : other.document_freqs)
+        {
+            document_freqs[word] += document_freq;
+        }
+        prefixes.insert(other.prefixes.begin(), other.prefixes.end());
+    }
+};
+
+#endif // CORPUS_STATISTICS_H
@@ -0,0 +1,58 @@
+#include "counting_memory_resource.h"
+
+CountingMemoryResource::CountingMemoryResource(std::pmr::memory_resource *upstream) :
+    upstream_(upstream)
+{
+
+}
+
+size_t CountingMemoryResource::GetAllocatedBytes() const
+{
+    return allocated_bytes_.load(std::memory_order_relaxed);
+}
+
+size_t CountingMemoryResource::GetPeakBytes() const
+{
+    return peak_bytes_.load(std::memory_order_relaxed);
+}
+
+size_t CountingMemoryResource::GetAllocationCount() const
+{
+    return allocation_count_.load(std::memory_order_relaxed);
+}
+
+size_t CountingMemoryResource::GetLiveAllocationCount() const
+{
+    return live_allocation_count_.load(std::memory_order_relaxed);
+}
+
+std::pmr::memory_resource *CountingMemoryResource::GetUpstream() const
+{
+    return upstream_;
+}
+
+void *CountingMemoryResource::do_allocate(size_t bytes, size_t alignment)
+{
+    void *memory = upstream_->allocate(bytes, alignment);
+    allocation_count_.fetch_add(1, std::memory_order_relaxed);
+    live_allocation_count_.fetch_add(1, std::memory_order_relaxed);
+    const size_t allocated = allocated_bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    size_t peak = peak_bytes_.load(std::memory_order_relaxed);
+    while (peak < allocated &&
+           !peak_bytes_.compare_exchange_weak(peak, allocated, std::memory_order_relaxed))
+    {
+    }
+    return memory;
+}
+
+void CountingMemoryResource::do_deallocate(void *memory, size_t bytes, size_t alignment)
+{
+    upstream_->deallocate(memory, bytes, alignment);
+    allocated_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+    live_allocation_count_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+bool CountingMemoryResource::do_is_equal(const std::pmr::memory_resource &other) const noexcept
+{
+    return this == &other;
+}
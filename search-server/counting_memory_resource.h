@@ -0,0 +1,42 @@
+#ifndef COUNTING_MEMORY_RESOURCE_H
+#define COUNTING_MEMORY_RESOURCE_H
+
+#include <atomic>
+#include <memory_resource>
+
+// Forwards to an upstream resource and keeps usage counters, so the
+// memory of every index on its own resource can be reported separately
+class CountingMemoryResource : public std::pmr::memory_resource
+{
+public:
+    explicit CountingMemoryResource(std::pmr::memory_resource *upstream =
+            std::pmr::get_default_resource());
+
+    // Allocated and not yet deallocated
+    size_t GetAllocatedBytes() const;
+
+    size_t GetPeakBytes() const;
+
+    // Calls of allocate so far
+    size_t GetAllocationCount() const;
+
+    // Blocks allocated and not yet deallocated
+    size_t GetLiveAllocationCount() const;
+
+    std::pmr::memory_resource *GetUpstream() const;
+
+private:
+    void *do_allocate(size_t bytes, size_t alignment) override;
+
+    void do_deallocate(void *memory, size_t bytes, size_t alignment) override;
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+    std::pmr::memory_resource *const upstream_;
+    std::atomic<size_t> allocated_bytes_ = 0;
+    std::atomic<size_t> peak_bytes_ = 0;
+    std::atomic<size_t> allocation_count_ = 0;
+    std::atomic<size_t> live_allocation_count_ = 0;
+};
+
+#endif // COUNTING_MEMORY_RESOURCE_H
@@ -1,5 +1,8 @@
 #include "document.h"
 
+#include <stdexcept>
+#include <string>
+
 std::ostream& operator<<(std::ostream& os, const Document& doc)
 {
     using namespace std::literals::string_literals;
@@ -9,3 +12,35 @@ std::ostream& operator<<(std::ostream& os, const Document& doc)
        << " }";
     return os;
 }
+
+DocumentStatus ParseDocumentStatus(std::string_view name)
+{
+    using namespace std::literals::string_literals;
+    for (const DocumentStatus status : {DocumentStatus::ACTUAL,
+                                        DocumentStatus::IRRELEVANT,
+                                        DocumentStatus::BANNED,
+                                        DocumentStatus::REMOVED})
+    {
+        if (GetDocumentStatusName(status) == name)
+        {
+            return status;
+        }
+    }
+    throw std::invalid_argument("Unknown document status "s + std::string{name});
+}
+
+std::string_view GetDocumentStatusName(DocumentStatus status)
+{
+    switch (status)
+    {
+    case DocumentStatus::ACTUAL:
+        return "ACTUAL";
+    case DocumentStatus::IRRELEVANT:
+        return "IRRELEVANT";
+    case DocumentStatus::BANNED:
+        return "BANNED";
+    case DocumentStatus::REMOVED:
+        return "REMOVED";
+    }
+    return "UNKNOWN";
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <iostream>
+#include <string_view>
 
 enum class DocumentStatus
 {
@@ -27,3 +28,8 @@ struct Document
 };
 
 std::ostream& operator<<(std::ostream& os, const Document& doc);
+
+// Names match the enumerators; throws std::invalid_argument for an unknown name
+DocumentStatus ParseDocumentStatus(std::string_view name);
+
+std::string_view GetDocumentStatusName(DocumentStatus status);
@@ -0,0 +1,265 @@
+#ifndef DOCUMENT_FILTER_H
+#define DOCUMENT_FILTER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "document.h"
+
+/**
+ * Structured filters for FindTopDocuments. They are called like any
+ * document predicate, but the server also sees their structure: the id
+ * bounds of a filter cut every posting list before it is scanned, and a
+ * filter that looks at ids only is checked without loading the document.
+ * Filters combine with && and ||, which build the checks at compile time.
+ *
+ *  search_server.FindTopDocuments("cat"s, StatusFilter{DocumentStatus::ACTUAL} &&
+ *                                         (RatingRange{3, 5} || IdRange{100, 200}));
+ */
+
+struct DocumentFilterTag
+{
+};
+
+template <typename Predicate>
+constexpr bool IS_DOCUMENT_FILTER = std::is_base_of_v<DocumentFilterTag, Predicate>;
+
+// Inclusive range of ids a filter can accept
+struct IdBounds
+{
+    int first = std::numeric_limits<int>::min();
+    int last = std::numeric_limits<int>::max();
+
+    bool IsEmpty() const
+    {
+        return first > last;
+    }
+};
+
+class StatusFilter : public DocumentFilterTag
+{
+public:
+    static constexpr bool NEEDS_DOCUMENT = true;
+
+    StatusFilter(std::initializer_list<DocumentStatus> statuses)
+    {
+        for (const DocumentStatus status : statuses)
+        {
+            mask_ |= 1U << static_cast<unsigned>(status);
+        }
+    }
+
+    bool operator()(int /*unused*/, DocumentStatus status, int /*unused*/) const
+    {
+        return (mask_ >> static_cast<unsigned>(status) & 1U) != 0U;
+    }
+
+    IdBounds GetIdBounds() const
+    {
+        return {};
+    }
+
+private:
+    uint32_t mask_ = 0;
+};
+
+struct RatingRange : DocumentFilterTag
+{
+    static constexpr bool NEEDS_DOCUMENT = true;
+
+    RatingRange(int min_rating, int max_rating) :
+        min(min_rating),
+        max(max_rating)
+    {
+
+    }
+
+    bool operator()(int /*unused*/, DocumentStatus /*unused*/, int rating) const
+    {
+        return min <= rating && rating <= max;
+    }
+
+    IdBounds GetIdBounds() const
+    {
+        return {};
+    }
+
+    int min;
+    int max;
+};
+
+struct IdRange : DocumentFilterTag
+{
+    static constexpr bool NEEDS_DOCUMENT = false;
+
+    IdRange(int first_id, int last_id) :
+        first(first_id),
+        last(last_id)
+    {
+
+    }
+
+    bool operator()(int document_id, DocumentStatus /*unused*/, int /*unused*/) const
+    {
+        return first <= document_id && document_id <= last;
+    }
+
+    IdBounds GetIdBounds() const
+    {
+        return {first, last};
+    }
+
+    int first;
+    int last;
+};
+
+class IdSet : public DocumentFilterTag
+{
+public:
+    static constexpr bool NEEDS_DOCUMENT = false;
+
+    explicit IdSet(std::vector<int> document_ids) :
+        document_ids_(std::move(document_ids))
+    {
+        std::sort(document_ids_.begin(), document_ids_.end());
+        document_ids_.erase(std::unique(document_ids_.begin(), document_ids_.end()),
+                            document_ids_.end());
+    }
+
+    IdSet(std::initializer_list<int> document_ids) :
+        IdSet(std::vector<int>(document_ids))
+    {
+
+    }
+
+    bool operator()(int document_id, DocumentStatus /*unused*/, int /*unused*/) const
+    {
+        return std::binary_search(document_ids_.begin(), document_ids_.end(), document_id);
+    }
+
+    IdBounds GetIdBounds() const
+    {
+        if (document_ids_.empty())
+        {
+            return {0, -1};
+        }
+        return {document_ids_.front(), document_ids_.back()};
+    }
+
+private:
+    std::vector<int> document_ids_;
+};
+
+template <typename Lhs, typename Rhs>
+struct AndFilter : DocumentFilterTag
+{
+    static constexpr bool NEEDS_DOCUMENT = Lhs::NEEDS_DOCUMENT || Rhs::NEEDS_DOCUMENT;
+
+    AndFilter(Lhs lhs_filter, Rhs rhs_filter) :
+        lhs(std::move(lhs_filter)),
+        rhs(std::move(rhs_filter))
+    {
+
+    }
+
+    bool operator()(int document_id, DocumentStatus status, int rating) const
+    {
+        return lhs(document_id, status, rating) && rhs(document_id, status, rating);
+    }
+
+    IdBounds GetIdBounds() const
+    {
+        const IdBounds lhs_bounds = lhs.GetIdBounds();
+        const IdBounds rhs_bounds = rhs.GetIdBounds();
+        return {std::max(lhs_bounds.first, rhs_bounds.first),
+                std::min(lhs_bounds.last, rhs_bounds.last)};
+    }
+
+    Lhs lhs;
+    Rhs rhs;
+};
+
+template <typename Lhs, typename Rhs>
+struct OrFilter : DocumentFilterTag
+{
+    static constexpr bool NEEDS_DOCUMENT = Lhs::NEEDS_DOCUMENT || Rhs::NEEDS_DOCUMENT;
+
+    OrFilter(Lhs lhs_filter, Rhs rhs_filter) :
+        lhs(std::move(lhs_filter)),
+        rhs(std::move(rhs_filter))
+    {
+
+    }
+
+    bool operator()(int document_id, DocumentStatus status, int rating) const
+    {
+        return lhs(document_id, status, rating) || rhs(document_id, status, rating);
+    }
+
+    IdBounds GetIdBounds() const
+    {
+        const IdBounds lhs_bounds = lhs.GetIdBounds();
+        const IdBounds rhs_bounds = rhs.GetIdBounds();
+        if (lhs_bounds.IsEmpty())
+        {
+            return rhs_bounds;
+        }
+        if (rhs_bounds.IsEmpty())
+        {
+            return lhs_bounds;
+        }
+        return {std::min(lhs_bounds.first, rhs_bounds.first),
+                std::max(lhs_bounds.last, rhs_bounds.last)};
+    }
+
+    Lhs lhs;
+    Rhs rhs;
+};
+
+template <typename Lhs, typename Rhs,
+          typename = std::enable_if_t<IS_DOCUMENT_FILTER<Lhs> && IS_DOCUMENT_FILTER<Rhs>>>
+AndFilter<Lhs, Rhs> operator&&(Lhs lhs, Rhs rhs)
+{
+    return {std::move(lhs), std::move(rhs)};
+}
+
+template <typename Lhs, typename Rhs,
+          typename = std::enable_if_t<IS_DOCUMENT_FILTER<Lhs> && IS_DOCUMENT_FILTER<Rhs>>>
+OrFilter<Lhs, Rhs> operator||(Lhs lhs, Rhs rhs)
+{
+    return {std::move(lhs), std::move(rhs)};
+}
+
+// An opaque predicate may accept any id
+template <typename Predicate>
+IdBounds GetIdBounds(const Predicate &predicate)
+{
+    if constexpr (IS_DOCUMENT_FILTER<Predicate>)
+    {
+        return predicate.GetIdBounds();
+    }
+    else
+    {
+        return {};
+    }
+}
+
+template <typename Predicate>
+constexpr bool NeedsDocumentData()
+{
+    if constexpr (IS_DOCUMENT_FILTER<Predicate>)
+    {
+        return Predicate::NEEDS_DOCUMENT;
+    }
+    else
+    {
+        return true;
+    }
+}
+
+#endif // DOCUMENT_FILTER_H
@@ -0,0 +1,42 @@
+#ifndef DOCUMENT_FINGERPRINT_H
+#define DOCUMENT_FINGERPRINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "hashing.h"
+
+// 128-bit hash of a set of words. Word hashes are summed, so the result
+// does not depend on the order of the words.
+struct DocumentFingerprint
+{
+    uint64_t low = 0;
+    uint64_t high = 0;
+
+    void AddWord(std::string_view word)
+    {
+        low += HashWord(word, 0x6a09e667f3bcc908ULL);
+        high += HashWord(word, 0xbb67ae8584caa73bULL);
+    }
+
+    bool operator==(const DocumentFingerprint &other) const
+    {
+        return low == other.low && high == other.high;
+    }
+
+    bool operator!=(const DocumentFingerprint &other) const
+    {
+        return !(*this == other);
+    }
+};
+
+struct DocumentFingerprintHasher
+{
+    size_t operator()(const DocumentFingerprint &fingerprint) const
+    {
+        return static_cast<size_t>(fingerprint.low ^ MixHash(fingerprint.high));
+    }
+};
+
+#endif // DOCUMENT_FINGERPRINT_H
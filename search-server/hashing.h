@@ -0,0 +1,28 @@
+#ifndef HASHING_H
+#define HASHING_H
+
+#include <cstdint>
+#include <string_view>
+
+// splitmix64 finalizer: spreads every input bit over the whole word
+constexpr uint64_t MixHash(uint64_t value)
+{
+    value += 0x9e3779b97f4a7c15ULL;
+    value = (value ^ (value >> 30U)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27U)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31U);
+}
+
+// FNV-1a over the bytes of the word, seeded and finalized with MixHash
+constexpr uint64_t HashWord(std::string_view word, uint64_t seed = 0)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL ^ MixHash(seed);
+    for (const char c : word)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ULL;
+    }
+    return MixHash(hash);
+}
+
+#endif // HASHING_H
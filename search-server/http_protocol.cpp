@@ -0,0 +1,262 @@
+#include "http_protocol.h"
+
+#include <algorithm>
+#include <cctype>
+
+using namespace std::literals::string_literals;
+
+namespace
+{
+const std::string_view HEAD_END = "\r\n\r\n";
+
+bool EqualsIgnoreCase(std::string_view lhs, std::string_view rhs)
+{
+    return lhs.size() == rhs.size() &&
+            std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](char left, char right)
+    {
+        return std::tolower(static_cast<unsigned char>(left)) ==
+                std::tolower(static_cast<unsigned char>(right));
+    });
+}
+
+std::string_view Trim(std::string_view text)
+{
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+    {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t'))
+    {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+int DecodeHexDigit(char digit)
+{
+    if (digit >= '0' && digit <= '9')
+    {
+        return digit - '0';
+    }
+    if (digit >= 'a' && digit <= 'f')
+    {
+        return digit - 'a' + 10;
+    }
+    if (digit >= 'A' && digit <= 'F')
+    {
+        return digit - 'A' + 10;
+    }
+    return -1;
+}
+
+std::string_view GetReasonPhrase(int status)
+{
+    switch (status)
+    {
+    case 200:
+        return "OK";
+    case 400:
+        return "Bad Request";
+    case 404:
+        return "Not Found";
+    case 405:
+        return "Method Not Allowed";
+    case 411:
+        return "Length Required";
+    case 413:
+        return "Payload Too Large";
+    case 431:
+        return "Request Header Fields Too Large";
+    case 501:
+        return "Not Implemented";
+    case 505:
+        return "HTTP Version Not Supported";
+    default:
+        return status < 500 ? "Client Error" : "Internal Server Error";
+    }
+}
+
+void ParseTarget(std::string_view target, HttpRequest &request)
+{
+    const auto question = target.find('?');
+    request.path = DecodeUrlComponent(target.substr(0, question));
+    if (question == std::string_view::npos)
+    {
+        return;
+    }
+
+    std::string_view parameters = target.substr(question + 1);
+    while (!parameters.empty())
+    {
+        const auto ampersand = parameters.find('&');
+        const std::string_view parameter = parameters.substr(0, ampersand);
+        const auto equals = parameter.find('=');
+        request.parameters[DecodeUrlComponent(parameter.substr(0, equals))] =
+                equals == std::string_view::npos ? ""s
+                                                 : DecodeUrlComponent(parameter.substr(equals + 1));
+        if (ampersand == std::string_view::npos)
+        {
+            break;
+        }
+        parameters.remove_prefix(ampersand + 1);
+    }
+}
+}
+
+size_t ParseHttpRequest(std::string_view input, HttpRequest &request)
+{
+    const auto head_end = input.find(HEAD_END);
+    if (head_end == std::string_view::npos)
+    {
+        if (input.size() > HttpLimits::MAX_HEAD_SIZE)
+        {
+            throw HttpError(431, "Request head is too large"s);
+        }
+        return 0;
+    }
+
+    std::string_view head = input.substr(0, head_end);
+    const auto line_end = head.find("\r\n");
+    const std::string_view request_line = head.substr(0, line_end);
+    head = line_end == std::string_view::npos ? std::string_view{} : head.substr(line_end + 2);
+
+    const auto first_space = request_line.find(' ');
+    const auto last_space = request_line.rfind(' ');
+    if (first_space == std::string_view::npos || first_space == last_space)
+    {
+        throw HttpError(400, "Malformed request line"s);
+    }
+    const std::string_view version = request_line.substr(last_space + 1);
+    if (version != "HTTP/1.1" && version != "HTTP/1.0")
+    {
+        throw HttpError(505, "Unsupported HTTP version"s);
+    }
+
+    request = HttpRequest{};
+    request.method = std::string{request_line.substr(0, first_space)};
+    ParseTarget(request_line.substr(first_space + 1, last_space - first_space - 1), request);
+    request.keep_alive = version == "HTTP/1.1";
+
+    size_t content_length = 0;
+    while (!head.empty())
+    {
+        const auto header_end = head.find("\r\n");
+        const std::string_view header = head.substr(0, header_end);
+        head = header_end == std::string_view::npos ? std::string_view{}
+                                                    : head.substr(header_end + 2);
+
+        const auto colon = header.find(':');
+        if (colon == std::string_view::npos)
+        {
+            throw HttpError(400, "Malformed header"s);
+        }
+        const std::string_view name = Trim(header.substr(0, colon));
+        const std::string_view value = Trim(header.substr(colon + 1));
+
+        if (EqualsIgnoreCase(name, "Content-Length"))
+        {
+            const std::string digits{value};
+            const bool is_number = std::all_of(digits.begin(), digits.end(), [](char c)
+            {
+                return c >= '0' && c <= '9';
+            });
+            if (digits.empty() || digits.size() > 9 || !is_number)
+            {
+                throw HttpError(400, "Invalid Content-Length"s);
+            }
+            content_length = std::stoul(digits);
+        }
+        else if (EqualsIgnoreCase(name, "Transfer-Encoding"))
+        {
+            throw HttpError(411, "Chunked request bodies are not supported"s);
+        }
+        else if (EqualsIgnoreCase(name, "Connection"))
+        {
+            if (EqualsIgnoreCase(value, "close"))
+            {
+                request.keep_alive = false;
+            }
+            else if (EqualsIgnoreCase(value, "keep-alive"))
+            {
+                request.keep_alive = true;
+            }
+        }
+    }
+
+    if (content_length > HttpLimits::MAX_BODY_SIZE)
+    {
+        throw HttpError(413, "Request body is too large"s);
+    }
+    const size_t request_size = head_end + HEAD_END.size() + content_length;
+    if (input.size() < request_size)
+    {
+        return 0;
+    }
+    request.body = std::string{input.substr(head_end + HEAD_END.size(), content_length)};
+    return request_size;
+}
+
+std::string FormatHttpResponseHead(int status, size_t content_length, bool keep_alive)
+{
+    std::string head = "HTTP/1.1 "s + std::to_string(status) + " "s +
+            std::string{GetReasonPhrase(status)} +
+            "\r\nContent-Type: application/json\r\nContent-Length: "s +
+            std::to_string(content_length) + "\r\n"s;
+    if (!keep_alive)
+    {
+        head += "Connection: close\r\n"s;
+    }
+    head += "\r\n"s;
+    return head;
+}
+
+std::string DecodeUrlComponent(std::string_view text)
+{
+    std::string decoded;
+    decoded.reserve(text.size());
+    for (size_t ii = 0; ii < text.size(); ++ii)
+    {
+        if (text[ii] == '+')
+        {
+            decoded.push_back(' ');
+        }
+        else if (text[ii] == '%' && ii + 2 < text.size() &&
+                 DecodeHexDigit(text[ii + 1]) >= 0 && DecodeHexDigit(text[ii + 2]) >= 0)
+        {
+            decoded.push_back(static_cast<char>(DecodeHexDigit(text[ii + 1]) * 16 +
+                                                DecodeHexDigit(text[ii + 2])));
+            ii += 2;
+        }
+        else
+        {
+            decoded.push_back(text[ii]);
+        }
+    }
+    return decoded;
+}
+
+void AppendJsonString(std::string &output, std::string_view text)
+{
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+
+    output.push_back('"');
+    for (const char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            output.push_back('\\');
+            output.push_back(c);
+        }
+        else if (static_cast<unsigned char>(c) < 0x20U)
+        {
+            output += "\\u00"s;
+            output.push_back(HEX_DIGITS[(c >> 4) & 0xF]);
+            output.push_back(HEX_DIGITS[c & 0xF]);
+        }
+        else
+        {
+            output.push_back(c);
+        }
+    }
+    output.push_back('"');
+}
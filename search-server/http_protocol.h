@@ -0,0 +1,52 @@
+#ifndef HTTP_PROTOCOL_H
+#define HTTP_PROTOCOL_H
+
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// Just enough HTTP/1.1 for the query server: requests with a
+// Content-Length body, keep-alive and pipelining. Chunked request
+// bodies are refused.
+
+struct HttpError : std::runtime_error
+{
+    HttpError(int status, const std::string &message)
+        : std::runtime_error(message)
+        , status(status)
+    {
+
+    }
+
+    int status;
+};
+
+struct HttpRequest
+{
+    std::string method;
+    std::string path;
+    std::map<std::string, std::string> parameters;
+    std::string body;
+    bool keep_alive = true;
+};
+
+struct HttpLimits
+{
+    static constexpr size_t MAX_HEAD_SIZE = 64U << 10U;
+    static constexpr size_t MAX_BODY_SIZE = 16U << 20U;
+};
+
+// Parses one request from the start of input. Returns the number of bytes
+// it took, or 0 if the request is not complete yet. Throws HttpError for
+// a malformed request, after which the connection should be closed.
+size_t ParseHttpRequest(std::string_view input, HttpRequest &request);
+
+std::string FormatHttpResponseHead(int status, size_t content_length, bool keep_alive);
+
+// Decodes %XX escapes and '+' in a URL component
+std::string DecodeUrlComponent(std::string_view text);
+
+void AppendJsonString(std::string &output, std::string_view text);
+
+#endif // HTTP_PROTOCOL_H
@@ -0,0 +1,57 @@
+#ifndef ITERATOR_RANGE_H
+#define ITERATOR_RANGE_H
+
+#include <iostream>
+#include <iterator>
+
+template <typename Iterator>
+class IteratorRange
+{
+public:
+
+    IteratorRange(Iterator _range_begin, Iterator _range_end) :
+        range_begin_(_range_begin),
+        range_end_(_range_end)
+    {
+
+    }
+
+    Iterator begin() const
+    {
+        return range_begin_;
+    }
+
+    Iterator end() const
+    {
+        return range_end_;
+    }
+
+    auto size() const
+    {
+        return distance(range_begin_, range_end_);
+    }
+
+    bool empty() const
+    {
+        return range_begin_ == range_end_;
+    }
+
+private:
+
+    Iterator range_begin_;
+    Iterator range_end_;
+
+};
+
+
+template <typename Iterator>
+std::ostream& operator<<(std::ostream& os, const IteratorRange<Iterator>& page)
+{
+    for (auto it = page.begin(); it != page.end(); advance(it, 1))
+    {
+        os << *it;
+    }
+    return os;
+}
+
+#endif // ITERATOR_RANGE_H
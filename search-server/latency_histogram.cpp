@@ -0,0 +1,97 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+void LatencyHistogram::Record(uint64_t value, uint64_t count)
+{
+    counts_[GetBucketIndex(value)] += count;
+    total_count_ += count;
+}
+
+void LatencyHistogram::Add(const LatencyHistogram &other)
+{
+    for (size_t ii = 0; ii < BUCKET_COUNT; ++ii)
+    {
+        counts_[ii] += other.counts_[ii];
+    }
+    total_count_ += other.total_count_;
+}
+
+void LatencyHistogram::Subtract(const LatencyHistogram &other)
+{
+    for (size_t ii = 0; ii < BUCKET_COUNT; ++ii)
+    {
+        counts_[ii] -= other.counts_[ii];
+    }
+    total_count_ -= other.total_count_;
+}
+
+void LatencyHistogram::Clear()
+{
+    counts_.fill(0);
+    total_count_ = 0;
+}
+
+uint64_t LatencyHistogram::GetCount() const
+{
+    return total_count_;
+}
+
+uint64_t LatencyHistogram::GetPercentile(double percentile) const
+{
+    if (total_count_ == 0U)
+    {
+        return 0;
+    }
+
+    const double rank = std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 *
+                                  static_cast<double>(total_count_));
+    const uint64_t target = std::max<uint64_t>(1U, static_cast<uint64_t>(rank));
+
+    uint64_t seen = 0;
+    for (size_t ii = 0; ii < BUCKET_COUNT; ++ii)
+    {
+        seen += counts_[ii];
+        if (seen >= target)
+        {
+            return GetBucketValue(ii);
+        }
+    }
+    return GetBucketValue(BUCKET_COUNT - 1);
+}
+
+size_t LatencyHistogram::GetBucketIndex(uint64_t value)
+{
+    if (value < SUB_BUCKET_COUNT)
+    {
+        return static_cast<size_t>(value);
+    }
+
+    unsigned highest_bit = 0;
+    for (uint64_t rest = value >> 1U; rest != 0U; rest >>= 1U)
+    {
+        ++highest_bit;
+    }
+    if (highest_bit >= MAX_VALUE_BITS)
+    {
+        return BUCKET_COUNT - 1;
+    }
+
+    const unsigned shift = highest_bit - SUB_BUCKET_BITS;
+    const uint64_t sub_bucket = (value >> shift) & (SUB_BUCKET_COUNT - 1);
+    return static_cast<size_t>((shift + 1) * SUB_BUCKET_COUNT + sub_bucket);
+}
+
+uint64_t LatencyHistogram::GetBucketValue(size_t index)
+{
+    if (index < SUB_BUCKET_COUNT)
+    {
+        return index;
+    }
+
+    const unsigned shift = static_cast<unsigned>(index / SUB_BUCKET_COUNT) - 1;
+    const uint64_t sub_bucket = index % SUB_BUCKET_COUNT;
+    const uint64_t lower = (SUB_BUCKET_COUNT + sub_bucket) << shift;
+    return lower + ((uint64_t{1} << shift) >> 1U);
+}
@@ -0,0 +1,45 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Log-linear histogram in the spirit of HdrHistogram: every power of two
+// is split into SUB_BUCKET_COUNT equal buckets, so a recorded value is
+// reported with a relative error below 1 / SUB_BUCKET_COUNT.
+class LatencyHistogram
+{
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 4;
+    static constexpr uint64_t SUB_BUCKET_COUNT = uint64_t{1} << SUB_BUCKET_BITS;
+    // Values from 2^MAX_VALUE_BITS on (about 4.9 hours in ns) share the last bucket
+    static constexpr unsigned MAX_VALUE_BITS = 44;
+    static constexpr size_t BUCKET_COUNT =
+            (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    void Record(uint64_t value, uint64_t count = 1);
+
+    void Add(const LatencyHistogram &other);
+
+    // other must have been added to this histogram before
+    void Subtract(const LatencyHistogram &other);
+
+    void Clear();
+
+    uint64_t GetCount() const;
+
+    // percentile in [0, 100]; 0 for an empty histogram
+    uint64_t GetPercentile(double percentile) const;
+
+private:
+    std::array<uint64_t, BUCKET_COUNT> counts_ = {};
+    uint64_t total_count_ = 0;
+
+    static size_t GetBucketIndex(uint64_t value);
+
+    // Middle of the bucket's value range
+    static uint64_t GetBucketValue(size_t index);
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,353 @@
+#include <sys/resource.h>
+
+#include <atomic>
+#include <chrono>
+#include <execution>
+#include <fstream>
+#include <iostream>
+#include <shared_mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "corpus_loader.h"
+#include "hashing.h"
+#include "latency_histogram.h"
+#include "read_input_functions.h"
+#include "search_server.h"
+#include "shard_coordinator.h"
+
+/**
+ * Replays a query log against a SearchServer loaded from a corpus file
+ * and reports sustained QPS, latency percentiles and CPU utilization as JSON.
+ *
+ * Corpus file: one document per line, either plain text (ids are assigned
+ * sequentially, status ACTUAL) or "id<TAB>status<TAB>r1,r2,...<TAB>text",
+ * where status is ACTUAL, IRRELEVANT, BANNED or REMOVED. With
+ * --corpus-format=records it holds binary ADD_DOCUMENT frames instead. The file
+ * is memory-mapped and parsed on a separate thread while documents are added.
+ * Query log: one raw query per line.
+ *
+ *  SearchServerLoadTest --corpus=docs.txt --queries=log.txt [--corpus-format=records]
+ *                       [--stop-words="a the"] [--threads=8] [--requests=100000]
+ *                       [--rate=5000] [--write-ratio=0.01] [--par]
+ *                       [--shards=unix:/tmp/shard0.sock,tcp:127.0.0.1:7001]
+ *
+ * --rate is the total open-loop arrival rate; latency is then measured from
+ * the scheduled arrival, so queueing delay is not hidden. Without --rate
+ * every client thread issues requests back to back. With --write-ratio,
+ * that share of requests adds or removes a document under an exclusive lock.
+ * With --shards, the corpus is loaded into running SearchServerShard
+ * processes and every request goes through a ShardCoordinator instead.
+ */
+
+using namespace std;
+
+namespace
+{
+using Clock = chrono::steady_clock;
+
+struct LoadTestOptions
+{
+    string corpus_path;
+    CorpusLoadOptions corpus_options;
+    string queries_path;
+    string stop_words;
+    size_t threads = max(1U, thread::hardware_concurrency());
+    size_t requests = 10000;
+    double rate = 0.0;
+    double write_ratio = 0.0;
+    bool parallel = false;
+    vector<string> shards;
+};
+
+struct ClientResult
+{
+    LatencyHistogram read_latency;
+    LatencyHistogram write_latency;
+    size_t reads = 0;
+    size_t writes = 0;
+    size_t errors = 0;
+};
+
+LoadTestOptions ParseOptions(int argc, char *argv[])
+{
+    LoadTestOptions options;
+    for (int ii = 1; ii < argc; ++ii)
+    {
+        const string argument = argv[ii];
+        const auto separator = argument.find('=');
+        const string name = argument.substr(0, separator);
+        const string value = separator == string::npos ? ""s : argument.substr(separator + 1);
+
+        if (name == "--corpus"s)
+        {
+            options.corpus_path = value;
+        }
+        else if (name == "--corpus-format"s)
+        {
+            if (value != "lines"s && value != "records"s)
+            {
+                throw invalid_argument("Unknown corpus format "s + value);
+            }
+            options.corpus_options.format = value == "lines"s ? CorpusFormat::LINES
+                                                              : CorpusFormat::RECORDS;
+        }
+        else if (name == "--queries"s)
+        {
+            options.queries_path = value;
+        }
+        else if (name == "--stop-words"s)
+        {
+            options.stop_words = value;
+        }
+        else if (name == "--threads"s)
+        {
+            options.threads = max<size_t>(1, stoull(value));
+        }
+        else if (name == "--requests"s)
+        {
+            options.requests = stoull(value);
+        }
+        else if (name == "--rate"s)
+        {
+            options.rate = stod(value);
+        }
+        else if (name == "--write-ratio"s)
+        {
+            options.write_ratio = stod(value);
+        }
+        else if (name == "--par"s)
+        {
+            options.parallel = true;
+        }
+        else if (name == "--shards"s)
+        {
+            istringstream addresses(value);
+            string address;
+            while (getline(addresses, address, ','))
+            {
+                options.shards.push_back(address);
+            }
+        }
+        else
+        {
+            throw invalid_argument("Unknown argument "s + argument);
+        }
+    }
+
+    if (options.corpus_path.empty() || options.queries_path.empty())
+    {
+        throw invalid_argument("--corpus and --queries are required"s);
+    }
+    return options;
+}
+
+vector<string> LoadQueries(const string &path)
+{
+    ifstream input(path);
+    if (!input)
+    {
+        throw invalid_argument("Cannot open query log "s + path);
+    }
+
+    vector<string> queries;
+    while (input.peek() != EOF)
+    {
+        queries.push_back(ReadLine(input));
+    }
+    if (queries.empty())
+    {
+        throw invalid_argument("Query log is empty"s);
+    }
+    return queries;
+}
+
+double GetCpuSeconds(const timeval &time)
+{
+    return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_usec) / 1e6;
+}
+
+void WriteLatency(ostream &output, const string &name, const LatencyHistogram &histogram)
+{
+    output << ",\n  \""s << name << "\": {\"count\": "s << histogram.GetCount()
+           << ", \"p50\": "s << histogram.GetPercentile(50.0)
+           << ", \"p90\": "s << histogram.GetPercentile(90.0)
+           << ", \"p99\": "s << histogram.GetPercentile(99.0)
+           << ", \"p999\": "s << histogram.GetPercentile(99.9) << "}"s;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        const LoadTestOptions options = ParseOptions(argc, argv);
+
+        SearchServer search_server(options.stop_words);
+        unique_ptr<ShardCoordinator> coordinator;
+        cerr << "loading corpus "s << options.corpus_path << endl;
+        int max_corpus_id = 0;
+        if (options.shards.empty())
+        {
+            max_corpus_id = LoadCorpus(search_server, options.corpus_path, options.corpus_options);
+        }
+        else
+        {
+            coordinator = make_unique<ShardCoordinator>(options.shards);
+            max_corpus_id = LoadCorpus(*coordinator, options.corpus_path, options.corpus_options);
+        }
+        const vector<string> queries = LoadQueries(options.queries_path);
+        cerr << (coordinator ? coordinator->GetDocumentCount() : search_server.GetDocumentCount())
+             << " documents, "s << queries.size() << " queries"s << endl;
+
+        shared_mutex index_mutex;
+        atomic<size_t> next_request{0};
+        atomic<int> next_write_id{max_corpus_id + 1};
+        vector<ClientResult> results(options.threads);
+
+        rusage usage_before{};
+        getrusage(RUSAGE_SELF, &usage_before);
+        const auto start = Clock::now();
+        const auto arrival_interval = options.rate > 0.0 ?
+                    chrono::duration_cast<Clock::duration>(chrono::duration<double>(1.0 / options.rate)) :
+                    Clock::duration::zero();
+
+        vector<thread> clients;
+        for (size_t client = 0; client < options.threads; ++client)
+        {
+            clients.emplace_back([&, client]()
+            {
+                ClientResult &result = results[client];
+                vector<int> added_ids;
+                for (size_t request = next_request++; request < options.requests;
+                     request = next_request++)
+                {
+                    auto issued_at = Clock::now();
+                    if (options.rate > 0.0)
+                    {
+                        issued_at = start + arrival_interval * static_cast<int64_t>(request);
+                        this_thread::sleep_until(issued_at);
+                    }
+
+                    const string &query = queries[request % queries.size()];
+                    const bool is_write = options.write_ratio > 0.0 &&
+                            static_cast<double>(MixHash(request) >> 11U) * 0x1.0p-53 < options.write_ratio;
+                    try
+                    {
+                        if (coordinator && is_write)
+                        {
+                            if (!added_ids.empty() && request % 2 == 0)
+                            {
+                                coordinator->RemoveDocument(added_ids.back());
+                                added_ids.pop_back();
+                            }
+                            else
+                            {
+                                added_ids.push_back(next_write_id++);
+                                coordinator->AddDocument(added_ids.back(), query,
+                                                         DocumentStatus::ACTUAL, {});
+                            }
+                        }
+                        else if (coordinator)
+                        {
+                            coordinator->FindTopDocuments(query);
+                        }
+                        else if (is_write)
+                        {
+                            unique_lock lock(index_mutex);
+                            if (!added_ids.empty() && request % 2 == 0)
+                            {
+                                search_server.RemoveDocument(added_ids.back());
+                                added_ids.pop_back();
+                            }
+                            else
+                            {
+                                added_ids.push_back(next_write_id++);
+                                search_server.AddDocument(added_ids.back(), query,
+                                                          DocumentStatus::ACTUAL, {});
+                            }
+                        }
+                        else
+                        {
+                            shared_lock lock(index_mutex);
+                            if (options.parallel)
+                            {
+                                search_server.FindTopDocuments(execution::par, query);
+                            }
+                            else
+                            {
+                                search_server.FindTopDocuments(query);
+                            }
+                        }
+                    }
+                    catch (const exception &)
+                    {
+                        ++result.errors;
+                    }
+
+                    const auto latency = chrono::duration_cast<chrono::nanoseconds>(
+                                Clock::now() - issued_at).count();
+                    if (is_write)
+                    {
+                        result.write_latency.Record(static_cast<uint64_t>(latency));
+                        ++result.writes;
+                    }
+                    else
+                    {
+                        result.read_latency.Record(static_cast<uint64_t>(latency));
+                        ++result.reads;
+                    }
+                }
+            });
+        }
+        for (thread &client : clients)
+        {
+            client.join();
+        }
+
+        const double elapsed = chrono::duration<double>(Clock::now() - start).count();
+        rusage usage_after{};
+        getrusage(RUSAGE_SELF, &usage_after);
+        const double user_seconds = GetCpuSeconds(usage_after.ru_utime) -
+                GetCpuSeconds(usage_before.ru_utime);
+        const double system_seconds = GetCpuSeconds(usage_after.ru_stime) -
+                GetCpuSeconds(usage_before.ru_stime);
+        const double cores_used = (user_seconds + system_seconds) / elapsed;
+
+        ClientResult total;
+        for (const ClientResult &result : results)
+        {
+            total.read_latency.Add(result.read_latency);
+            total.write_latency.Add(result.write_latency);
+            total.reads += result.reads;
+            total.writes += result.writes;
+            total.errors += result.errors;
+        }
+
+        cout << "{\n  \"threads\": "s << options.threads
+             << ",\n  \"shards\": "s << options.shards.size()
+             << ",\n  \"mode\": \""s << (options.rate > 0.0 ? "open"s : "closed"s)
+             << "\",\n  \"target_qps\": "s << options.rate
+             << ",\n  \"reads\": "s << total.reads
+             << ",\n  \"writes\": "s << total.writes
+             << ",\n  \"errors\": "s << total.errors
+             << ",\n  \"elapsed_s\": "s << elapsed
+             << ",\n  \"qps\": "s << static_cast<double>(total.reads + total.writes) / elapsed;
+        WriteLatency(cout, "read_latency_ns"s, total.read_latency);
+        WriteLatency(cout, "write_latency_ns"s, total.write_latency);
+        cout << ",\n  \"cpu\": {\"user_s\": "s << user_seconds
+             << ", \"system_s\": "s << system_seconds
+             << ", \"cores_used\": "s << cores_used
+             << ", \"utilization\": "s << cores_used / max(1U, thread::hardware_concurrency())
+             << "}\n}"s << endl;
+    }
+    catch (const exception &error)
+    {
+        cerr << error.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include "memory_stats.h"
+
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace
+{
+// Block header of glibc malloc; other allocators are in the same range
+constexpr size_t ESTIMATED_BLOCK_OVERHEAD = 16;
+}
+
+MemoryUsage MemoryStats::GetTotal() const
+{
+    MemoryUsage total;
+    for (const MemoryUsage &usage : {inverted_index, term_dictionary, forward_index, documents,
+                                     document_texts, document_words, impact_postings, positions,
+                                     duplicates})
+    {
+        total += usage;
+    }
+    return total;
+}
+
+double MemoryStats::GetAveragePostingListLength() const
+{
+    return term_count == 0U ? 0.0 : static_cast<double>(posting_count) / term_count;
+}
+
+void PrintMemoryStats(std::ostream &output, const MemoryStats &stats)
+{
+    using namespace std::literals::string_literals;
+
+    const auto print = [&output, &stats](std::string_view name, const MemoryUsage &usage)
+    {
+        output << name
+               << ": bytes = "s << usage.bytes
+               << ", allocations = "s << usage.live_allocations
+               << ", bytes per document = "s
+               << (stats.document_count == 0U ? 0U : usage.bytes / stats.document_count)
+               << std::endl;
+    };
+
+    const std::pair<std::string_view, const MemoryUsage&> structures[] = {
+        {"inverted index", stats.inverted_index},
+        {"term dictionary", stats.term_dictionary},
+        {"forward index", stats.forward_index},
+        {"documents", stats.documents},
+        {"document texts", stats.document_texts},
+        {"document words", stats.document_words},
+        {"impact postings", stats.impact_postings},
+        {"positions", stats.positions},
+        {"duplicates", stats.duplicates},
+    };
+    for (const auto &[name, usage] : structures)
+    {
+        print(name, usage);
+    }
+
+    const MemoryUsage total = stats.GetTotal();
+    print("total", total);
+    output << "allocator overhead: about "s << total.live_allocations * ESTIMATED_BLOCK_OVERHEAD
+           << " bytes"s << std::endl;
+    output << "documents = "s << stats.document_count
+           << ", terms = "s << stats.term_count
+           << ", postings = "s << stats.posting_count
+           << ", average posting list = "s << stats.GetAveragePostingListLength()
+           << std::endl;
+}
@@ -0,0 +1,54 @@
+#ifndef MEMORY_STATS_H
+#define MEMORY_STATS_H
+
+#include <iostream>
+
+// Memory of one index structure as its memory resource sees it. The
+// allocator adds its own header to every block on top of these bytes,
+// which live_allocations lets estimate.
+struct MemoryUsage
+{
+    size_t bytes = 0;
+    size_t live_allocations = 0;
+
+    MemoryUsage &operator+=(const MemoryUsage &other)
+    {
+        bytes += other.bytes;
+        live_allocations += other.live_allocations;
+        return *this;
+    }
+};
+
+// Snapshot of SearchServer::GetMemoryStats
+struct MemoryStats
+{
+    // word -> document -> term frequency
+    MemoryUsage inverted_index;
+    // Front-coded words of the inverted index
+    MemoryUsage term_dictionary;
+    // document -> word -> term frequency
+    MemoryUsage forward_index;
+    // Ratings, statuses and the id set
+    MemoryUsage documents;
+    MemoryUsage document_texts;
+    // Word sets of the documents
+    MemoryUsage document_words;
+    MemoryUsage impact_postings;
+    MemoryUsage positions;
+    // Documents grouped by word set
+    MemoryUsage duplicates;
+
+    size_t term_count = 0;
+    size_t posting_count = 0;
+    size_t document_count = 0;
+
+    MemoryUsage GetTotal() const;
+
+    double GetAveragePostingListLength() const;
+};
+
+// One structure per line with bytes per document, for projecting the
+// memory of a larger corpus
+void PrintMemoryStats(std::ostream &output, const MemoryStats &stats);
+
+#endif // MEMORY_STATS_H
@@ -0,0 +1,247 @@
+#include "near_duplicates.h"
+
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <stdexcept>
+
+using namespace std;
+
+namespace
+{
+class DisjointSets
+{
+public:
+    explicit DisjointSets(size_t size) :
+        parents_(size)
+    {
+        iota(parents_.begin(), parents_.end(), 0U);
+    }
+
+    size_t Find(size_t item)
+    {
+        while (parents_[item] != item)
+        {
+            parents_[item] = parents_[parents_[item]];
+            item = parents_[item];
+        }
+        return item;
+    }
+
+    void Unite(size_t lhs, size_t rhs)
+    {
+        lhs = Find(lhs);
+        rhs = Find(rhs);
+        if (lhs != rhs)
+        {
+            parents_[max(lhs, rhs)] = min(lhs, rhs);
+        }
+    }
+
+private:
+    vector<size_t> parents_;
+};
+
+using CandidatePair = pair<size_t, size_t>;
+
+// Hash of every band of the document's signature; the signature itself
+// is dropped, so only band_count keys per document stay in memory
+void ComputeBandKeys(const SearchServer &search_server,
+                     int document_id,
+                     const NearDuplicateOptions &options,
+                     uint64_t *band_keys)
+{
+    const vector<uint64_t> signature =
+            search_server.ComputeMinHashSignature(document_id, options.hash_count);
+    const size_t rows_per_band = options.hash_count / options.band_count;
+    for (size_t band = 0; band < options.band_count; ++band)
+    {
+        uint64_t hash = band;
+        for (size_t ii = 0; ii < rows_per_band; ++ii)
+        {
+            hash = MixHash(hash ^ signature[band * rows_per_band + ii]);
+        }
+        band_keys[band] = hash;
+    }
+}
+
+// Documents whose band keys collide become candidates. Each document of a
+// bucket is paired with the bucket's first document and its predecessor,
+// which keeps huge buckets linear instead of quadratic. bucket_keys is
+// scratch space reused between bands.
+void CollectBandCandidates(const vector<uint64_t> &band_keys,
+                           size_t band_count,
+                           size_t band,
+                           vector<pair<uint64_t, size_t>> &bucket_keys,
+                           vector<CandidatePair> &candidates)
+{
+    for (size_t index = 0; index < bucket_keys.size(); ++index)
+    {
+        bucket_keys[index] = {band_keys[index * band_count + band], index};
+    }
+    sort(execution::par, bucket_keys.begin(), bucket_keys.end());
+
+    size_t bucket_begin = 0;
+    for (size_t ii = 1; ii < bucket_keys.size(); ++ii)
+    {
+        if (bucket_keys[ii].first != bucket_keys[bucket_begin].first)
+        {
+            bucket_begin = ii;
+            continue;
+        }
+        candidates.emplace_back(bucket_keys[bucket_begin].second, bucket_keys[ii].second);
+        if (ii - 1 != bucket_begin)
+        {
+            candidates.emplace_back(bucket_keys[ii - 1].second, bucket_keys[ii].second);
+        }
+    }
+}
+
+void CheckOptions(const NearDuplicateOptions &options)
+{
+    if (options.hash_count == 0U || options.band_count == 0U ||
+            options.hash_count % options.band_count != 0U)
+    {
+        throw invalid_argument("hash_count must be a positive multiple of band_count"s);
+    }
+    if (!(options.jaccard_threshold > 0.0 && options.jaccard_threshold <= 1.0))
+    {
+        throw invalid_argument("jaccard_threshold must be in (0, 1]"s);
+    }
+}
+
+// Exact Jaccard similarity of the word sets, merged in word order
+bool IsSimilar(const SearchServer &search_server, int lhs, int rhs, double jaccard_threshold)
+{
+    const auto lhs_words = search_server.GetWordFrequencies(lhs);
+    const auto rhs_words = search_server.GetWordFrequencies(rhs);
+    const size_t lhs_size = distance(lhs_words.begin(), lhs_words.end());
+    const size_t rhs_size = distance(rhs_words.begin(), rhs_words.end());
+
+    size_t common = 0;
+    for (auto lhs_it = lhs_words.begin(), rhs_it = rhs_words.begin();
+         lhs_it != lhs_words.end() && rhs_it != rhs_words.end();)
+    {
+        if (lhs_it->first < rhs_it->first)
+        {
+            ++lhs_it;
+        }
+        else if (rhs_it->first < lhs_it->first)
+        {
+            ++rhs_it;
+        }
+        else
+        {
+            ++common;
+            ++lhs_it;
+            ++rhs_it;
+        }
+    }
+    const size_t united = lhs_size + rhs_size - common;
+    return united != 0U && static_cast<double>(common) >= jaccard_threshold * united;
+}
+}
+
+vector<vector<int>> FindNearDuplicateClusters(const SearchServer &search_server,
+                                              const NearDuplicateOptions &options)
+{
+    CheckOptions(options);
+
+    const vector<int> document_ids(search_server.begin(), search_server.end());
+    const size_t document_count = document_ids.size();
+    const size_t band_count = options.band_count;
+
+    vector<uint64_t> band_keys(document_count * band_count);
+    vector<size_t> indexes(document_count);
+    iota(indexes.begin(), indexes.end(), 0U);
+    for_each(execution::par, indexes.begin(), indexes.end(),
+             [&](size_t index)
+    {
+        ComputeBandKeys(search_server, document_ids[index], options,
+                        &band_keys[index * band_count]);
+    });
+
+    // Bands one after another, so only one bucketing array is alive
+    vector<CandidatePair> candidates;
+    vector<pair<uint64_t, size_t>> bucket_keys(document_count);
+    for (size_t band = 0; band < band_count; ++band)
+    {
+        CollectBandCandidates(band_keys, band_count, band, bucket_keys, candidates);
+    }
+    bucket_keys = {};
+    band_keys = {};
+    sort(execution::par, candidates.begin(), candidates.end());
+    candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+
+    vector<char> is_similar(candidates.size());
+    transform(execution::par, candidates.begin(), candidates.end(), is_similar.begin(),
+              [&](const CandidatePair &candidate)
+    {
+        return static_cast<char>(IsSimilar(search_server,
+                                           document_ids[candidate.first],
+                                           document_ids[candidate.second],
+                                           options.jaccard_threshold));
+    });
+
+    DisjointSets clusters(document_count);
+    for (size_t ii = 0; ii < candidates.size(); ++ii)
+    {
+        if (is_similar[ii])
+        {
+            clusters.Unite(candidates[ii].first, candidates[ii].second);
+        }
+    }
+
+    vector<size_t> roots(document_count);
+    vector<char> has_members(document_count, 0);
+    for (size_t index = 0; index < document_count; ++index)
+    {
+        roots[index] = clusters.Find(index);
+        if (roots[index] != index)
+        {
+            has_members[roots[index]] = 1;
+        }
+    }
+
+    // Roots are the smallest index of a cluster, so sorting by root
+    // keeps both the clusters and their members in id order
+    vector<pair<size_t, size_t>> members;
+    for (size_t index = 0; index < document_count; ++index)
+    {
+        if (roots[index] != index || has_members[index])
+        {
+            members.emplace_back(roots[index], index);
+        }
+    }
+    sort(members.begin(), members.end());
+
+    vector<vector<int>> result;
+    for (size_t ii = 0; ii < members.size(); ++ii)
+    {
+        if (ii == 0U || members[ii].first != members[ii - 1].first)
+        {
+            result.emplace_back();
+        }
+        result.back().push_back(document_ids[members[ii].second]);
+    }
+    return result;
+}
+
+void RemoveNearDuplicates(SearchServer &search_server,
+                          const NearDuplicateOptions &options)
+{
+    for (const vector<int> &cluster : FindNearDuplicateClusters(search_server, options))
+    {
+        // Clusters are transitive, so a member may only resemble the kept
+        // document through other members
+        for (auto it = next(cluster.begin()); it != cluster.end(); ++it)
+        {
+            if (!IsSimilar(search_server, cluster.front(), *it, options.jaccard_threshold))
+            {
+                continue;
+            }
+            cout << "Found near-duplicate document id "s << *it << endl;
+            search_server.RemoveDocument(*it);
+        }
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef NEAR_DUPLICATES_H
+#define NEAR_DUPLICATES_H
+
+#include <vector>
+
+#include "search_server.h"
+
+struct NearDuplicateOptions
+{
+    // hash_count must be a positive multiple of band_count
+    size_t hash_count = 128;
+    size_t band_count = 32;
+    // In (0, 1]
+    double jaccard_threshold = 0.8;
+};
+
+// Clusters of documents whose Jaccard similarity of word sets reaches the
+// threshold. MinHash bands propose candidate pairs, keeping band_count keys
+// per document, and the exact similarity confirms them. Clustering is transitive: documents A and C share
+// a cluster when A resembles B and B resembles C, even if A and C differ.
+// Ids inside a cluster and the clusters themselves are sorted ascending.
+// Throws std::invalid_argument for invalid options.
+std::vector<std::vector<int>>
+FindNearDuplicateClusters(const SearchServer &search_server,
+                          const NearDuplicateOptions &options = {});
+
+// Keeps the smallest id of every cluster and removes the members that
+// resemble it directly
+void RemoveNearDuplicates(SearchServer &search_server,
+                          const NearDuplicateOptions &options = {});
+
+#endif // NEAR_DUPLICATES_H
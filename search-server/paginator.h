@@ -1,92 +1,156 @@
 #pragma once
+#include <cstddef>
 #include <iostream>
+#include <iterator>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "iterator_range.h"
+#include "search_cursor.h"
+
 template <typename Iterator>
-class IteratorRange
+class Paginator
 {
 public:
-
-    IteratorRange<Iterator>(Iterator _range_begin, Iterator _range_end) :
-        range_begin_(_range_begin),
-        range_end_(_range_end)
+    Paginator<Iterator>(Iterator _it_begin, Iterator _it_end, size_t _page_size)
     {
+        while (distance(_it_begin, _it_end - 1) >= _page_size)
+        {
+            pages_.push_back({_it_begin, _it_begin + _page_size});
+            advance(_it_begin, _page_size);
+        }
 
+        if (distance(_it_begin, _it_end) > 0)
+        {
+            pages_.push_back({_it_begin, _it_end});
+        }
     }
 
-    Iterator begin() const
+    auto begin() const
     {
-        return range_begin_;
+        return pages_.begin();
     }
 
-    Iterator end() const
+    auto end() const
     {
-        return range_end_;
+        return pages_.end();
     }
 
-    auto size() const
+    size_t size() const
     {
-        return distance(range_begin_, range_end_);
+        return pages_.size();
     }
 
 private:
 
-    Iterator range_begin_;
-    Iterator range_end_;
-
+    std::vector<IteratorRange<Iterator>> pages_;
 };
 
-
-template <typename Iterator>
-std::ostream& operator<<(std::ostream& os, const IteratorRange<Iterator>& page)
+template <typename Container>
+auto Paginate(const Container& c, size_t page_size)
 {
-    for (auto it = page.begin(); it != page.end(); advance(it, 1))
-    {
-        os << *it;
-    }
-    return os;
+    return Paginator(begin(c), end(c), page_size);
 }
 
-template <typename Iterator>
-class Paginator
+// Pages that are fetched only when the iteration reaches them:
+// fetch(cursor) returns the SearchPage following the cursor.
+// Every begin() starts again from the first page.
+template <typename Fetch>
+class CursorPaginator
 {
 public:
-    Paginator<Iterator>(Iterator _it_begin, Iterator _it_end, size_t _page_size)
+    using Page = IteratorRange<std::vector<Document>::const_iterator>;
+
+    class Iterator
     {
-        while (distance(_it_begin, _it_end - 1) >= _page_size)
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Page;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Page*;
+        using reference = Page;
+
+        // The end of the pages
+        Iterator() = default;
+
+        explicit Iterator(const Fetch *fetch) :
+            fetch_(fetch),
+            page_((*fetch)(SearchCursor{}))
         {
-            pages_.push_back({_it_begin, _it_begin + _page_size});
-            advance(_it_begin, _page_size);
+            if (page_.documents.empty())
+            {
+                fetch_ = nullptr;
+            }
         }
 
-        if (distance(_it_begin, _it_end) > 0)
+        // Valid until the iterator is incremented
+        Page operator*() const
         {
-            pages_.push_back({_it_begin, _it_end});
+            return {page_.documents.begin(), page_.documents.end()};
         }
-    }
 
-    auto begin() const
+        Iterator &operator++()
+        {
+            if (page_.next)
+            {
+                page_ = (*fetch_)(*page_.next);
+                ++page_index_;
+            }
+            else
+            {
+                page_.documents.clear();
+            }
+            if (page_.documents.empty())
+            {
+                *this = Iterator();
+            }
+            return *this;
+        }
+
+        bool operator==(const Iterator &other) const
+        {
+            return fetch_ == other.fetch_ && page_index_ == other.page_index_;
+        }
+
+        bool operator!=(const Iterator &other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        const Fetch *fetch_ = nullptr;
+        SearchPage page_;
+        size_t page_index_ = 0;
+    };
+
+    explicit CursorPaginator(Fetch fetch) :
+        fetch_(std::move(fetch))
     {
-        return pages_.begin();
+
     }
 
-    auto end() const
+    Iterator begin() const
     {
-        return pages_.end();
+        return Iterator(&fetch_);
     }
 
-    size_t size() const
+    Iterator end() const
     {
-        return pages_.size();
+        return {};
     }
 
 private:
-
-    std::vector<IteratorRange<Iterator>> pages_;
+    Fetch fetch_;
 };
 
-template <typename Container>
-auto Paginate(const Container& c, size_t page_size)
+// Lazy pages of searcher.FindPage(raw_query, cursor, page_size)
+template <typename Searcher>
+auto Paginate(const Searcher &searcher, std::string raw_query, size_t page_size)
 {
-    return Paginator(begin(c), end(c), page_size);
+    return CursorPaginator([&searcher, raw_query = std::move(raw_query), page_size]
+                           (const SearchCursor &cursor)
+    {
+        return searcher.FindPage(raw_query, cursor, page_size);
+    });
 }
@@ -0,0 +1,162 @@
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+#endif
+
+namespace
+{
+const char *const EVENT_NAMES[PERF_EVENT_COUNT] =
+{
+    "cycles",
+    "instructions",
+    "l1d_misses",
+    "llc_misses",
+    "branch_misses",
+    "dtlb_misses",
+};
+
+#ifdef __linux__
+uint64_t MakeCacheConfig(uint64_t cache, uint64_t operation, uint64_t result)
+{
+    return cache | (operation << 8U) | (result << 16U);
+}
+
+int OpenCounter(PerfEvent event)
+{
+    perf_event_attr attributes;
+    std::memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.disabled = 1;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (event)
+    {
+    case PerfEvent::CYCLES:
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case PerfEvent::INSTRUCTIONS:
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case PerfEvent::L1D_MISSES:
+        attributes.type = PERF_TYPE_HW_CACHE;
+        attributes.config = MakeCacheConfig(PERF_COUNT_HW_CACHE_L1D,
+                                            PERF_COUNT_HW_CACHE_OP_READ,
+                                            PERF_COUNT_HW_CACHE_RESULT_MISS);
+        break;
+    case PerfEvent::LLC_MISSES:
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+    case PerfEvent::BRANCH_MISSES:
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    case PerfEvent::DTLB_MISSES:
+        attributes.type = PERF_TYPE_HW_CACHE;
+        attributes.config = MakeCacheConfig(PERF_COUNT_HW_CACHE_DTLB,
+                                            PERF_COUNT_HW_CACHE_OP_READ,
+                                            PERF_COUNT_HW_CACHE_RESULT_MISS);
+        break;
+    }
+
+    return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+}
+#endif
+}
+
+PerfCounters::PerfCounters()
+{
+    descriptors_.fill(-1);
+#ifdef __linux__
+    for (size_t ii = 0; ii < PERF_EVENT_COUNT; ++ii)
+    {
+        descriptors_[ii] = OpenCounter(static_cast<PerfEvent>(ii));
+    }
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+    for (const int descriptor : descriptors_)
+    {
+        if (descriptor >= 0)
+        {
+            close(descriptor);
+        }
+    }
+#endif
+}
+
+bool PerfCounters::IsAvailable() const
+{
+    for (const int descriptor : descriptors_)
+    {
+        if (descriptor >= 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PerfCounters::Start()
+{
+#ifdef __linux__
+    for (const int descriptor : descriptors_)
+    {
+        if (descriptor >= 0)
+        {
+            ioctl(descriptor, PERF_EVENT_IOC_RESET, 0);
+            ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+PerfCounterValues PerfCounters::Stop()
+{
+    PerfCounterValues values;
+#ifdef __linux__
+    for (const int descriptor : descriptors_)
+    {
+        if (descriptor >= 0)
+        {
+            ioctl(descriptor, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+
+    for (size_t ii = 0; ii < PERF_EVENT_COUNT; ++ii)
+    {
+        // value, time enabled, time running
+        uint64_t data[3] = {};
+        if (descriptors_[ii] < 0 ||
+                read(descriptors_[ii], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data)) ||
+                data[2] == 0U)
+        {
+            continue;
+        }
+        values[ii] = data[2] == data[1] ?
+                    data[0] :
+                    static_cast<uint64_t>(static_cast<double>(data[0]) *
+                                          static_cast<double>(data[1]) /
+                                          static_cast<double>(data[2]));
+    }
+#endif
+    return values;
+}
+
+const char *PerfCounters::GetEventName(PerfEvent event)
+{
+    return EVENT_NAMES[static_cast<size_t>(event)];
+}
@@ -0,0 +1,51 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+enum class PerfEvent
+{
+    CYCLES,
+    INSTRUCTIONS,
+    L1D_MISSES,
+    LLC_MISSES,
+    BRANCH_MISSES,
+    DTLB_MISSES,
+};
+
+constexpr size_t PERF_EVENT_COUNT = 6;
+
+// Empty values are counters the kernel or CPU did not provide
+using PerfCounterValues = std::array<std::optional<uint64_t>, PERF_EVENT_COUNT>;
+
+// Hardware counters of the calling thread read through Linux perf_event_open.
+// Every counter is opened on its own, so an unsupported event (common on
+// virtual machines) or a restrictive perf_event_paranoid only disables that
+// counter. On other platforms no counter is available.
+class PerfCounters
+{
+public:
+    PerfCounters();
+
+    PerfCounters(const PerfCounters &other) = delete;
+
+    PerfCounters &operator=(const PerfCounters &other) = delete;
+
+    ~PerfCounters();
+
+    bool IsAvailable() const;
+
+    void Start();
+
+    // Values are scaled up if the kernel multiplexed a counter
+    PerfCounterValues Stop();
+
+    static const char *GetEventName(PerfEvent event);
+
+private:
+    std::array<int, PERF_EVENT_COUNT> descriptors_;
+};
+
+#endif // PERF_COUNTERS_H
@@ -0,0 +1,233 @@
+#include "positional_index.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+void AppendVarint(std::pmr::string &output, uint32_t value)
+{
+    while (value >= 0x80U)
+    {
+        output.push_back(static_cast<char>((value & 0x7FU) | 0x80U));
+        value >>= 7U;
+    }
+    output.push_back(static_cast<char>(value));
+}
+
+uint32_t ReadVarint(std::string_view input, size_t &position)
+{
+    uint32_t value = 0;
+    for (uint32_t shift = 0;; shift += 7U)
+    {
+        const auto bits = static_cast<uint32_t>(static_cast<unsigned char>(input[position++]));
+        value |= (bits & 0x7FU) << shift;
+        if ((bits & 0x80U) == 0U)
+        {
+            return value;
+        }
+    }
+}
+
+// End of the count and the gaps starting at begin
+size_t SkipPositions(std::string_view input, size_t begin)
+{
+    for (uint32_t count = ReadVarint(input, begin); count != 0U; --count)
+    {
+        ReadVarint(input, begin);
+    }
+    return begin;
+}
+
+template <typename Postings>
+auto FindPosting(Postings &postings, int document_id)
+{
+    return std::lower_bound(postings.begin(), postings.end(), document_id,
+                            [](const auto &posting, int id)
+    {
+        return posting.document_id < id;
+    });
+}
+}
+
+PositionalIndex::WordPositions::WordPositions(std::pmr::memory_resource *resource) :
+    postings(resource),
+    encoded(resource)
+{
+
+}
+
+PositionalIndex::PositionalIndex(std::pmr::memory_resource *resource) :
+    word_to_positions_(resource)
+{
+
+}
+
+void PositionalIndex::AddDocument(int document_id,
+                                  const std::map<std::string_view, std::vector<uint32_t>> &word_positions)
+{
+    for (const auto &[word, positions] : word_positions)
+    {
+        WordPositions &stored = word_to_positions_.try_emplace(
+                                    word, word_to_positions_.get_allocator().resource()).first->second;
+
+        stored.postings.insert(FindPosting(stored.postings, document_id),
+                               {document_id, static_cast<uint32_t>(stored.encoded.size())});
+        AppendVarint(stored.encoded, static_cast<uint32_t>(positions.size()));
+        uint32_t previous = 0;
+        for (const uint32_t position : positions)
+        {
+            AppendVarint(stored.encoded, position - previous);
+            previous = position;
+        }
+    }
+}
+
+void PositionalIndex::RemovePosting(std::string_view word, int document_id, std::string_view key)
+{
+    const auto word_positions = word_to_positions_.find(word);
+    if (word_positions == word_to_positions_.end())
+    {
+        return;
+    }
+    WordPositions &stored = word_positions->second;
+    const auto posting = FindPosting(stored.postings, document_id);
+    if (posting == stored.postings.end() || posting->document_id != document_id)
+    {
+        return;
+    }
+
+    stored.removed_bytes += SkipPositions(stored.encoded, posting->begin) - posting->begin;
+    stored.postings.erase(posting);
+    if (stored.postings.empty())
+    {
+        word_to_positions_.erase(word_positions);
+        return;
+    }
+    if (stored.removed_bytes * 2U > stored.encoded.size())
+    {
+        Compact(stored);
+    }
+    if (!key.empty() && key.data() != word_positions->first.data())
+    {
+        auto node = word_to_positions_.extract(word_positions);
+        node.key() = key;
+        word_to_positions_.insert(std::move(node));
+    }
+}
+
+bool PositionalIndex::ContainsPhrase(int document_id, const std::vector<PhraseTerm> &terms) const
+{
+    std::vector<std::vector<uint32_t>> positions;
+    positions.reserve(terms.size());
+    for (const auto &term : terms)
+    {
+        positions.push_back(DecodePositions(term.word, document_id));
+        if (positions.back().empty())
+        {
+            return false;
+        }
+    }
+
+    // Candidate starts come from the rarest term, the rest are looked up
+    const size_t anchor = std::min_element(positions.begin(), positions.end(),
+                                           [](const auto &lhs, const auto &rhs)
+    {
+        return lhs.size() < rhs.size();
+    }) - positions.begin();
+
+    for (const uint32_t anchor_position : positions[anchor])
+    {
+        if (anchor_position < terms[anchor].offset)
+        {
+            continue;
+        }
+        const uint32_t start = anchor_position - terms[anchor].offset;
+
+        bool matches = true;
+        for (size_t ii = 0; ii < terms.size() && matches; ++ii)
+        {
+            matches = ii == anchor ||
+                    std::binary_search(positions[ii].begin(), positions[ii].end(),
+                                       start + terms[ii].offset);
+        }
+        if (matches)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PositionalIndex::ContainsNear(int document_id,
+                                   std::string_view lhs,
+                                   std::string_view rhs,
+                                   uint32_t distance) const
+{
+    const auto lhs_positions = DecodePositions(lhs, document_id);
+    if (lhs == rhs)
+    {
+        // The same word twice needs two different occurrences
+        return std::adjacent_find(lhs_positions.begin(), lhs_positions.end(),
+                                  [distance](uint32_t previous, uint32_t next)
+        {
+            return next - previous <= distance;
+        }) != lhs_positions.end();
+    }
+    const auto rhs_positions = DecodePositions(rhs, document_id);
+
+    auto lhs_it = lhs_positions.begin();
+    auto rhs_it = rhs_positions.begin();
+    while (lhs_it != lhs_positions.end() && rhs_it != rhs_positions.end())
+    {
+        if (std::max(*lhs_it, *rhs_it) - std::min(*lhs_it, *rhs_it) <= distance)
+        {
+            return true;
+        }
+        ++(*lhs_it < *rhs_it ? lhs_it : rhs_it);
+    }
+    return false;
+}
+
+std::vector<uint32_t> PositionalIndex::DecodePositions(std::string_view word,
+                                                       int document_id) const
+{
+    std::vector<uint32_t> positions;
+
+    const auto word_positions = word_to_positions_.find(word);
+    if (word_positions == word_to_positions_.end())
+    {
+        return positions;
+    }
+    const WordPositions &stored = word_positions->second;
+    const auto posting = FindPosting(stored.postings, document_id);
+    if (posting == stored.postings.end() || posting->document_id != document_id)
+    {
+        return positions;
+    }
+
+    size_t offset = posting->begin;
+    positions.resize(ReadVarint(stored.encoded, offset));
+    uint32_t position = 0;
+    for (uint32_t &decoded : positions)
+    {
+        position += ReadVarint(stored.encoded, offset);
+        decoded = position;
+    }
+    return positions;
+}
+
+void PositionalIndex::Compact(WordPositions &positions)
+{
+    std::pmr::string encoded(positions.encoded.get_allocator());
+    encoded.reserve(positions.encoded.size() - positions.removed_bytes);
+    for (Posting &posting : positions.postings)
+    {
+        const size_t end = SkipPositions(positions.encoded, posting.begin);
+        const auto begin = static_cast<uint32_t>(encoded.size());
+        encoded.append(positions.encoded, posting.begin, end - posting.begin);
+        posting.begin = begin;
+    }
+    positions.encoded = std::move(encoded);
+    positions.removed_bytes = 0;
+}
@@ -0,0 +1,73 @@
+#ifndef POSITIONAL_INDEX_H
+#define POSITIONAL_INDEX_H
+
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Word positions of every document, kept apart from the term frequency
+// postings so that ordinary queries never read them. The positions of a
+// word in a document are stored as varint-encoded gaps and decoded only
+// when a phrase or proximity check reaches that document. All documents
+// of a word share one buffer, and the words are views the caller keeps
+// alive, as SearchServer does with its other dictionaries.
+class PositionalIndex
+{
+public:
+    explicit PositionalIndex(std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+    struct PhraseTerm
+    {
+        std::string_view word;
+        // Position relative to the first term of the phrase
+        uint32_t offset;
+    };
+
+    // Positions of each word must be ascending; the words must outlive
+    // the document in the index
+    void AddDocument(int document_id,
+                     const std::map<std::string_view, std::vector<uint32_t>> &word_positions);
+
+    // A non-empty key replaces the stored view of a word that other
+    // documents still contain
+    void RemovePosting(std::string_view word, int document_id, std::string_view key);
+
+    bool ContainsPhrase(int document_id, const std::vector<PhraseTerm> &terms) const;
+
+    // Both words occur at most distance positions apart, in any order
+    bool ContainsNear(int document_id,
+                      std::string_view lhs,
+                      std::string_view rhs,
+                      uint32_t distance) const;
+
+private:
+    struct Posting
+    {
+        int document_id;
+        // Start of the position count and the gaps in encoded
+        uint32_t begin;
+    };
+
+    struct WordPositions
+    {
+        explicit WordPositions(std::pmr::memory_resource *resource);
+
+        // Sorted by document id
+        std::pmr::vector<Posting> postings;
+        std::pmr::string encoded;
+        // Bytes of removed documents, dropped once they outweigh the rest
+        size_t removed_bytes = 0;
+    };
+
+    // Empty if the document does not contain the word
+    std::vector<uint32_t> DecodePositions(std::string_view word, int document_id) const;
+
+    static void Compact(WordPositions &positions);
+
+    std::pmr::map<std::string_view, WordPositions> word_to_positions_;
+};
+
+#endif // POSITIONAL_INDEX_H
@@ -0,0 +1,317 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+const uint32_t NO_PARENT = UINT32_MAX;
+
+struct ProfileEvent
+{
+    const char *name;
+    uint32_t path_id;
+    uint32_t depth;
+    uint64_t start_ns;
+    uint64_t end_ns;
+};
+
+// Written only by its owning thread, read by anyone: an event becomes
+// visible once size_ is published with release ordering
+class ThreadEventBuffer
+{
+public:
+    explicit ThreadEventBuffer(uint32_t thread_index) :
+        events_(std::make_unique<ProfileEvent[]>(Profiler::EVENTS_PER_THREAD)),
+        thread_index_(thread_index)
+    {
+
+    }
+
+    void Append(const ProfileEvent &event)
+    {
+        const size_t index = size_.load(std::memory_order_relaxed);
+        if (index == Profiler::EVENTS_PER_THREAD)
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        events_[index] = event;
+        size_.store(index + 1, std::memory_order_release);
+    }
+
+    template <typename Callback>
+    void ForEach(Callback callback) const
+    {
+        const size_t size = size_.load(std::memory_order_acquire);
+        for (size_t ii = 0; ii < size; ++ii)
+        {
+            callback(events_[ii]);
+        }
+    }
+
+    uint32_t GetThreadIndex() const
+    {
+        return thread_index_;
+    }
+
+    uint64_t GetDropped() const
+    {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    void Clear()
+    {
+        size_.store(0, std::memory_order_relaxed);
+        dropped_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::unique_ptr<ProfileEvent[]> events_;
+    std::atomic<size_t> size_{0};
+    std::atomic<uint64_t> dropped_{0};
+    uint32_t thread_index_;
+};
+
+struct Registry
+{
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadEventBuffer>> buffers;
+    std::vector<std::string> paths;
+    std::map<std::pair<uint32_t, std::string>, uint32_t> path_ids;
+};
+
+Registry &GetRegistry()
+{
+    static Registry registry;
+    return registry;
+}
+
+struct PathKeyHasher
+{
+    size_t operator()(const std::pair<uint32_t, const char*> &key) const
+    {
+        return std::hash<const char*>{}(key.second) ^ (static_cast<size_t>(key.first) << 1U);
+    }
+};
+
+struct ThreadState
+{
+    std::shared_ptr<ThreadEventBuffer> buffer;
+    std::vector<uint32_t> open_paths;
+    std::unordered_map<std::pair<uint32_t, const char*>, uint32_t, PathKeyHasher> path_cache;
+
+    ThreadEventBuffer &GetBuffer()
+    {
+        if (!buffer)
+        {
+            Registry &registry = GetRegistry();
+            std::lock_guard guard(registry.mutex);
+            buffer = std::make_shared<ThreadEventBuffer>(
+                        static_cast<uint32_t>(registry.buffers.size()));
+            registry.buffers.push_back(buffer);
+        }
+        return *buffer;
+    }
+
+    uint32_t InternPath(const char *name)
+    {
+        const uint32_t parent = open_paths.empty() ? NO_PARENT : open_paths.back();
+        const auto key = std::make_pair(parent, name);
+        if (const auto it = path_cache.find(key); it != path_cache.end())
+        {
+            return it->second;
+        }
+
+        Registry &registry = GetRegistry();
+        std::lock_guard guard(registry.mutex);
+        const auto [it, inserted] = registry.path_ids.emplace(
+                    std::make_pair(parent, std::string{name}),
+                    static_cast<uint32_t>(registry.paths.size()));
+        if (inserted)
+        {
+            registry.paths.push_back(parent == NO_PARENT ?
+                                         std::string{name} :
+                                         registry.paths[parent] + "/" + name);
+        }
+        path_cache.emplace(key, it->second);
+        return it->second;
+    }
+};
+
+ThreadState &GetThreadState()
+{
+    thread_local ThreadState state;
+    return state;
+}
+
+uint64_t NowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void WriteJsonString(std::ostream &output, const std::string &text)
+{
+    output << '"';
+    for (const char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            output << '\\';
+        }
+        output << c;
+    }
+    output << '"';
+}
+}
+
+ProfileScope::ProfileScope(const char *name) :
+    name_(name)
+{
+    ThreadState &state = GetThreadState();
+    path_id_ = state.InternPath(name);
+    state.open_paths.push_back(path_id_);
+    start_ns_ = NowNs();
+}
+
+ProfileScope::~ProfileScope()
+{
+    const uint64_t end_ns = NowNs();
+    ThreadState &state = GetThreadState();
+    state.open_paths.pop_back();
+    state.GetBuffer().Append({name_,
+                              path_id_,
+                              static_cast<uint32_t>(state.open_paths.size()),
+                              start_ns_,
+                              end_ns});
+}
+
+std::vector<ScopeStats> Profiler::GetScopeStats()
+{
+    Registry &registry = GetRegistry();
+    std::lock_guard guard(registry.mutex);
+
+    std::vector<std::vector<uint64_t>> durations(registry.paths.size());
+    for (const auto &buffer : registry.buffers)
+    {
+        buffer->ForEach([&durations](const ProfileEvent &event)
+        {
+            durations[event.path_id].push_back(event.end_ns - event.start_ns);
+        });
+    }
+
+    std::vector<ScopeStats> result;
+    for (size_t path_id = 0; path_id < durations.size(); ++path_id)
+    {
+        auto &path_durations = durations[path_id];
+        if (path_durations.empty())
+        {
+            continue;
+        }
+        std::sort(path_durations.begin(), path_durations.end());
+
+        const auto percentile = [&path_durations](double fraction)
+        {
+            const auto index = static_cast<size_t>(fraction * (path_durations.size() - 1));
+            return std::chrono::nanoseconds{path_durations[index]};
+        };
+
+        ScopeStats stats;
+        stats.path = registry.paths[path_id];
+        stats.count = path_durations.size();
+        for (const uint64_t duration : path_durations)
+        {
+            stats.total += std::chrono::nanoseconds{duration};
+        }
+        stats.min = std::chrono::nanoseconds{path_durations.front()};
+        stats.max = std::chrono::nanoseconds{path_durations.back()};
+        stats.p50 = percentile(0.5);
+        stats.p90 = percentile(0.9);
+        stats.p99 = percentile(0.99);
+        result.push_back(std::move(stats));
+    }
+
+    std::sort(result.begin(), result.end(), [](const ScopeStats &lhs, const ScopeStats &rhs)
+    {
+        return lhs.path < rhs.path;
+    });
+    return result;
+}
+
+void Profiler::PrintScopeStats(std::ostream &output)
+{
+    using namespace std::literals::string_literals;
+
+    for (const ScopeStats &stats : GetScopeStats())
+    {
+        output << stats.path
+               << ": count = "s << stats.count
+               << ", total = "s << stats.total.count()
+               << " ns, min = "s << stats.min.count()
+               << " ns, max = "s << stats.max.count()
+               << " ns, p50 = "s << stats.p50.count()
+               << " ns, p90 = "s << stats.p90.count()
+               << " ns, p99 = "s << stats.p99.count()
+               << " ns"s << std::endl;
+    }
+}
+
+void Profiler::WriteChromeTrace(std::ostream &output)
+{
+    Registry &registry = GetRegistry();
+    std::lock_guard guard(registry.mutex);
+
+    output << "{\"traceEvents\":[";
+    bool is_first = true;
+    for (const auto &buffer : registry.buffers)
+    {
+        const uint32_t thread_index = buffer->GetThreadIndex();
+        buffer->ForEach([&output, &is_first, thread_index](const ProfileEvent &event)
+        {
+            if (!is_first)
+            {
+                output << ',';
+            }
+            is_first = false;
+            output << "{\"name\":";
+            WriteJsonString(output, event.name);
+            output << ",\"cat\":\"search-server\",\"ph\":\"X\""
+                   << ",\"ts\":" << event.start_ns / 1000 << '.'
+                   << (event.start_ns % 1000) / 100
+                   << ",\"dur\":" << (event.end_ns - event.start_ns) / 1000 << '.'
+                   << ((event.end_ns - event.start_ns) % 1000) / 100
+                   << ",\"pid\":1,\"tid\":" << thread_index
+                   << ",\"args\":{\"depth\":" << event.depth << "}}";
+        });
+    }
+    output << "],\"displayTimeUnit\":\"ns\"}" << std::endl;
+}
+
+uint64_t Profiler::GetDroppedEventCount()
+{
+    Registry &registry = GetRegistry();
+    std::lock_guard guard(registry.mutex);
+
+    uint64_t dropped = 0;
+    for (const auto &buffer : registry.buffers)
+    {
+        dropped += buffer->GetDropped();
+    }
+    return dropped;
+}
+
+void Profiler::Reset()
+{
+    Registry &registry = GetRegistry();
+    std::lock_guard guard(registry.mutex);
+
+    for (const auto &buffer : registry.buffers)
+    {
+        buffer->Clear();
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define PROFILER_CONCAT_INTERNAL(X, Y) X##Y
+#define PROFILER_CONCAT(X, Y) PROFILER_CONCAT_INTERNAL(X, Y)
+
+/**
+ * Replacement for LOG_DURATION that does not touch a stream on the hot path.
+ * Records the time from its call to the end of the enclosing block into a
+ * buffer of the current thread. Nested scopes are aggregated by their path,
+ * e.g. "FindTopDocuments/ParseQuery".
+ *
+ * The name must be a string literal. Without SEARCH_SERVER_PROFILING
+ * defined the macro expands to nothing.
+ *
+ *  void Task() {
+ *      PROFILE_SCOPE("Task");
+ *      ...
+ *  }
+ *
+ *  Profiler::PrintScopeStats(std::cerr);
+ *  Profiler::WriteChromeTrace(trace_file); // open in chrome://tracing
+ */
+#ifdef SEARCH_SERVER_PROFILING
+#define PROFILE_SCOPE(name) ProfileScope PROFILER_CONCAT(profileScope, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name) static_cast<void>(0)
+#endif
+
+struct ScopeStats
+{
+    std::string path;
+    uint64_t count = 0;
+    std::chrono::nanoseconds total{0};
+    std::chrono::nanoseconds min{0};
+    std::chrono::nanoseconds max{0};
+    std::chrono::nanoseconds p50{0};
+    std::chrono::nanoseconds p90{0};
+    std::chrono::nanoseconds p99{0};
+};
+
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char *name);
+
+    ProfileScope(const ProfileScope &other) = delete;
+
+    ProfileScope &operator=(const ProfileScope &other) = delete;
+
+    ~ProfileScope();
+
+private:
+    const char *name_;
+    uint32_t path_id_;
+    uint64_t start_ns_;
+};
+
+// Readers take a registry lock, writers never do after a thread's first
+// event of a given path. Events are read while other threads keep
+// profiling; Reset must only run when no scope is open.
+class Profiler
+{
+public:
+    // Per-thread event limit; later events are counted as dropped
+    static constexpr size_t EVENTS_PER_THREAD = size_t{1} << 15U;
+
+    static std::vector<ScopeStats> GetScopeStats();
+
+    static void PrintScopeStats(std::ostream &output);
+
+    // Chrome trace-event JSON, loadable by chrome://tracing and Perfetto
+    static void WriteChromeTrace(std::ostream &output);
+
+    static uint64_t GetDroppedEventCount();
+
+    static void Reset();
+};
+
+#endif // PROFILER_H
@@ -0,0 +1,107 @@
+#ifndef QUERY_CONTROL_H
+#define QUERY_CONTROL_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+
+class QueryCancelled : public std::runtime_error
+{
+public:
+    QueryCancelled() :
+        std::runtime_error("query was cancelled")
+    {
+
+    }
+};
+
+class QueryDeadlineExceeded : public std::runtime_error
+{
+public:
+    QueryDeadlineExceeded() :
+        std::runtime_error("query deadline exceeded")
+    {
+
+    }
+};
+
+// Copies share the same flag: keep one copy to cancel, pass another with the query
+class CancellationToken
+{
+public:
+    CancellationToken() :
+        cancelled_(std::make_shared<std::atomic<bool>>(false))
+    {
+
+    }
+
+    void Cancel() const
+    {
+        cancelled_->store(true, std::memory_order_relaxed);
+    }
+
+    bool IsCancelled() const
+    {
+        return cancelled_->load(std::memory_order_relaxed);
+    }
+
+private:
+    std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+struct QueryOptions
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::optional<Clock::time_point> deadline;
+    std::optional<CancellationToken> cancellation;
+};
+
+// Non-owning view of QueryOptions checked by the evaluation loop
+class QueryControl
+{
+public:
+    using Clock = QueryOptions::Clock;
+
+    // Number of postings processed between two checks
+    static const size_t CHECK_INTERVAL = 256;
+
+    QueryControl() = default;
+
+    explicit QueryControl(const QueryOptions &options) :
+        deadline_(options.deadline.value_or(NO_DEADLINE)),
+        cancellation_(options.cancellation ? &*options.cancellation : nullptr)
+    {
+
+    }
+
+    void Check() const
+    {
+        if (cancellation_ != nullptr && cancellation_->IsCancelled())
+        {
+            throw QueryCancelled();
+        }
+
+        if (deadline_ != NO_DEADLINE && Clock::now() >= deadline_)
+        {
+            throw QueryDeadlineExceeded();
+        }
+    }
+
+    bool IsUnlimited() const
+    {
+        return deadline_ == NO_DEADLINE && cancellation_ == nullptr;
+    }
+
+private:
+    static constexpr Clock::time_point NO_DEADLINE = Clock::time_point::max();
+
+    // A plain time point: an optional here trips -Wmaybe-uninitialized
+    // wherever Check is inlined
+    Clock::time_point deadline_ = NO_DEADLINE;
+    const CancellationToken *cancellation_ = nullptr;
+};
+
+#endif // QUERY_CONTROL_H
@@ -0,0 +1,679 @@
+#include "query_server.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <system_error>
+
+using namespace std::literals::string_literals;
+
+namespace
+{
+// Requests a connection may have in flight before its input is left unread
+const size_t MAX_PIPELINED_REQUESTS = 64;
+const size_t MAX_IOVECS = 64;
+const size_t READ_CHUNK_SIZE = 64U << 10U;
+// A client that keeps sending while its responses pile up is cut off
+const size_t MAX_BUFFERED_INPUT = 128U << 20U;
+const int MAX_EVENTS = 128;
+
+[[noreturn]] void ThrowSystemError(const std::string &what)
+{
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+void AddToEpoll(int epoll_fd, int fd, uint32_t events)
+{
+    epoll_event event{};
+    event.events = events;
+    event.data.fd = fd;
+    if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0)
+    {
+        ThrowSystemError("epoll_ctl"s);
+    }
+}
+
+const std::string &GetParameter(const HttpRequest &request, const std::string &name)
+{
+    const auto parameter = request.parameters.find(name);
+    if (parameter == request.parameters.end())
+    {
+        throw std::invalid_argument("Missing parameter "s + name);
+    }
+    return parameter->second;
+}
+
+int ParseInt(std::string_view text)
+{
+    int value = 0;
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc{} || end != text.data() + text.size())
+    {
+        throw std::invalid_argument("Invalid number "s + std::string{text});
+    }
+    return value;
+}
+
+void AppendJsonNumber(std::string &output, double value)
+{
+    char buffer[32];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    output.append(buffer, result.ptr);
+}
+
+std::string MakeErrorBody(std::string_view message)
+{
+    std::string body = "{\"error\": "s;
+    AppendJsonString(body, message);
+    body += "}"s;
+    return body;
+}
+}
+
+QueryServer::QueryServer(SearchServer &search_server, QueryServerOptions options)
+    : service_(search_server)
+    , options_(std::move(options))
+    , workers_(std::max<size_t>(1U, options_.worker_count))
+{
+    if (options_.http_address.empty() && options_.binary_address.empty())
+    {
+        throw std::invalid_argument("At least one listen address is required"s);
+    }
+
+    for (size_t ii = 0; ii < std::max<size_t>(1U, options_.io_thread_count); ++ii)
+    {
+        auto io_thread = std::make_unique<IoThread>();
+        io_thread->epoll = SocketHandle(::epoll_create1(EPOLL_CLOEXEC));
+        io_thread->wake_event = SocketHandle(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+        if (!io_thread->epoll.IsValid() || !io_thread->wake_event.IsValid())
+        {
+            ThrowSystemError("epoll"s);
+        }
+        AddToEpoll(io_thread->epoll.Get(), io_thread->wake_event.Get(), EPOLLIN | EPOLLET);
+        io_threads_.push_back(std::move(io_thread));
+    }
+
+    // Listeners live on IO thread 0, which hands connections out round-robin
+    for (auto [address, listener] : {std::pair{&options_.http_address, &http_listener_},
+                                     std::pair{&options_.binary_address, &binary_listener_}})
+    {
+        if (!address->empty())
+        {
+            *listener = ListenOn(*address);
+            SetNonBlocking(listener->Get());
+            AddToEpoll(io_threads_.front()->epoll.Get(), listener->Get(), EPOLLIN | EPOLLET);
+        }
+    }
+}
+
+QueryServer::~QueryServer()
+{
+    for (const std::string &address : {options_.http_address, options_.binary_address})
+    {
+        if (!address.empty())
+        {
+            RemoveSocketFile(address);
+        }
+    }
+}
+
+void QueryServer::Run()
+{
+    std::vector<std::thread> threads;
+    for (size_t ii = 1; ii < io_threads_.size(); ++ii)
+    {
+        threads.emplace_back([this, ii]()
+        {
+            RunIoLoop(ii);
+        });
+    }
+    RunIoLoop(0);
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+}
+
+void QueryServer::Stop()
+{
+    stopping_.store(true);
+    for (const auto &io_thread : io_threads_)
+    {
+        Wake(*io_thread);
+    }
+}
+
+void QueryServer::RunIoLoop(size_t index)
+{
+    IoThread &io_thread = *io_threads_[index];
+    epoll_event events[MAX_EVENTS];
+
+    while (!stopping_.load())
+    {
+        const int event_count = ::epoll_wait(io_thread.epoll.Get(), events, MAX_EVENTS, -1);
+        if (event_count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            ThrowSystemError("epoll_wait"s);
+        }
+
+        for (int ii = 0; ii < event_count; ++ii)
+        {
+            const int fd = events[ii].data.fd;
+            if (fd == io_thread.wake_event.Get())
+            {
+                uint64_t counter = 0;
+                [[maybe_unused]] const ssize_t count = ::read(fd, &counter, sizeof(counter));
+
+                std::vector<std::shared_ptr<Connection>> accepted;
+                std::vector<std::shared_ptr<Connection>> completed;
+                {
+                    std::lock_guard guard(io_thread.mutex);
+                    accepted.swap(io_thread.accepted);
+                    completed.swap(io_thread.completed);
+                }
+                for (const auto &connection : accepted)
+                {
+                    const int connection_fd = connection->socket.Get();
+                    io_thread.connections.emplace(connection_fd, connection);
+                    AddToEpoll(io_thread.epoll.Get(), connection_fd,
+                               EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET);
+                }
+                for (const auto &connection : completed)
+                {
+                    if (!connection->closed)
+                    {
+                        Flush(io_thread, connection);
+                    }
+                }
+                continue;
+            }
+            if (fd == http_listener_.Get())
+            {
+                AcceptConnections(fd, Protocol::HTTP);
+                continue;
+            }
+            if (fd == binary_listener_.Get())
+            {
+                AcceptConnections(fd, Protocol::BINARY);
+                continue;
+            }
+
+            const auto found = io_thread.connections.find(fd);
+            if (found == io_thread.connections.end())
+            {
+                continue;
+            }
+            // Keeps the connection alive while Close erases it from the map
+            const std::shared_ptr<Connection> connection = found->second;
+            if ((events[ii].events & (EPOLLERR | EPOLLHUP)) != 0U)
+            {
+                Close(io_thread, connection);
+                continue;
+            }
+            if ((events[ii].events & (EPOLLIN | EPOLLRDHUP)) != 0U)
+            {
+                ReadInput(io_thread, connection);
+            }
+            if (!connection->closed && (events[ii].events & EPOLLOUT) != 0U)
+            {
+                Flush(io_thread, connection);
+            }
+        }
+    }
+
+    // Queued work may still complete; its responses are simply dropped
+    for (auto [fd, connection] : std::unordered_map(io_thread.connections))
+    {
+        Close(io_thread, connection);
+    }
+}
+
+void QueryServer::AcceptConnections(int listener_fd, Protocol protocol)
+{
+    // Edge-triggered: drain the backlog
+    while (true)
+    {
+        SocketHandle socket = AcceptConnection(listener_fd, true);
+        if (!socket.IsValid())
+        {
+            return;
+        }
+
+        auto connection = std::make_shared<Connection>();
+        connection->socket = std::move(socket);
+        connection->protocol = protocol;
+        connection->io_thread = next_io_thread_++ % io_threads_.size();
+
+        IoThread &io_thread = *io_threads_[connection->io_thread];
+        {
+            std::lock_guard guard(io_thread.mutex);
+            io_thread.accepted.push_back(std::move(connection));
+        }
+        Wake(io_thread);
+    }
+}
+
+void QueryServer::Wake(IoThread &io_thread)
+{
+    const uint64_t one = 1;
+    [[maybe_unused]] const ssize_t count = ::write(io_thread.wake_event.Get(), &one, sizeof(one));
+}
+
+void QueryServer::ReadInput(IoThread &io_thread, const std::shared_ptr<Connection> &connection)
+{
+    // Edge-triggered: read until the socket is drained
+    while (true)
+    {
+        const size_t old_size = connection->input.size();
+        connection->input.resize(old_size + READ_CHUNK_SIZE);
+        const ssize_t count = ::recv(connection->socket.Get(), connection->input.data() + old_size,
+                                     READ_CHUNK_SIZE, 0);
+        connection->input.resize(old_size + static_cast<size_t>(std::max<ssize_t>(count, 0)));
+
+        if (count > 0)
+        {
+            if (connection->input.size() > MAX_BUFFERED_INPUT)
+            {
+                Close(io_thread, connection);
+                return;
+            }
+            continue;
+        }
+        if (count == 0)
+        {
+            connection->input_finished = true;
+            break;
+        }
+        if (errno == EINTR)
+        {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            break;
+        }
+        Close(io_thread, connection);
+        return;
+    }
+
+    ProcessInput(io_thread, connection);
+    Flush(io_thread, connection);
+}
+
+void QueryServer::ProcessInput(IoThread &io_thread, const std::shared_ptr<Connection> &connection)
+{
+    if (connection->ignore_input)
+    {
+        connection->input.clear();
+        return;
+    }
+
+    size_t consumed = 0;
+    while (consumed < connection->input.size())
+    {
+        PendingResponse *response = nullptr;
+        {
+            std::lock_guard guard(connection->mutex);
+            if (connection->responses.size() >= MAX_PIPELINED_REQUESTS)
+            {
+                break;
+            }
+            response = &connection->responses.emplace_back();
+        }
+        const std::string_view input = std::string_view{connection->input}.substr(consumed);
+
+        if (connection->protocol == Protocol::HTTP)
+        {
+            HttpRequest request;
+            size_t request_size = 0;
+            try
+            {
+                request_size = ParseHttpRequest(input, request);
+            }
+            catch (const HttpError &error)
+            {
+                // The rest of the stream cannot be parsed, answer and hang up
+                response->body = MakeErrorBody(error.what());
+                response->head = FormatHttpResponseHead(error.status, response->body.size(), false);
+                response->close_after = true;
+                connection->input_finished = true;
+                connection->ignore_input = true;
+                consumed = connection->input.size();
+                Complete(connection, *response);
+                break;
+            }
+            if (request_size == 0U)
+            {
+                std::lock_guard guard(connection->mutex);
+                connection->responses.pop_back();
+                break;
+            }
+            consumed += request_size;
+            if (!request.keep_alive)
+            {
+                // Anything pipelined after "Connection: close" is ignored
+                connection->input_finished = true;
+                connection->ignore_input = true;
+                consumed = connection->input.size();
+            }
+
+            response->close_after = !request.keep_alive;
+            Schedule(connection, [this, response, request = std::move(request)]
+                     (const std::shared_ptr<Connection> &connection)
+            {
+                const auto [status, body] = HandleHttp(request);
+                response->head = FormatHttpResponseHead(status, body.size(), request.keep_alive);
+                response->body = body;
+                Complete(connection, *response);
+            });
+            continue;
+        }
+
+        FrameHeader header;
+        try
+        {
+            if (input.size() >= FrameHeader::SIZE)
+            {
+                header = DecodeFrameHeader(input);
+            }
+        }
+        catch (const ProtocolError &)
+        {
+            // Framing is lost, so there is no way to answer
+            Close(io_thread, connection);
+            return;
+        }
+        if (input.size() < FrameHeader::SIZE || input.size() - FrameHeader::SIZE < header.payload_size)
+        {
+            std::lock_guard guard(connection->mutex);
+            connection->responses.pop_back();
+            break;
+        }
+
+        std::string payload{input.substr(FrameHeader::SIZE, header.payload_size)};
+        consumed += FrameHeader::SIZE + header.payload_size;
+        Schedule(connection, [this, response, header, payload = std::move(payload)]
+                 (const std::shared_ptr<Connection> &connection)
+        {
+            response->head = service_.Handle(header, payload);
+            Complete(connection, *response);
+        });
+    }
+    connection->input.erase(0, consumed);
+}
+
+void QueryServer::Schedule(const std::shared_ptr<Connection> &connection,
+                           std::function<void(const std::shared_ptr<Connection>&)> task)
+{
+    {
+        std::lock_guard guard(connection->mutex);
+        connection->tasks.push_back(std::move(task));
+        if (connection->is_running)
+        {
+            return;
+        }
+        connection->is_running = true;
+    }
+    workers_.Post([this, connection]()
+    {
+        RunTasks(connection);
+    });
+}
+
+void QueryServer::RunTasks(const std::shared_ptr<Connection> &connection)
+{
+    while (true)
+    {
+        std::function<void(const std::shared_ptr<Connection>&)> task;
+        {
+            std::lock_guard guard(connection->mutex);
+            if (connection->tasks.empty())
+            {
+                connection->is_running = false;
+                return;
+            }
+            task = std::move(connection->tasks.front());
+            connection->tasks.pop_front();
+        }
+        task(connection);
+    }
+}
+
+void QueryServer::Complete(const std::shared_ptr<Connection> &connection,
+                           PendingResponse &response)
+{
+    {
+        std::lock_guard guard(connection->mutex);
+        response.ready = true;
+    }
+
+    IoThread &io_thread = *io_threads_[connection->io_thread];
+    {
+        std::lock_guard guard(io_thread.mutex);
+        io_thread.completed.push_back(connection);
+    }
+    Wake(io_thread);
+}
+
+void QueryServer::Flush(IoThread &io_thread, const std::shared_ptr<Connection> &connection)
+{
+    bool close_after = false;
+    while (!close_after)
+    {
+        // Only ready responses are read here, and workers never touch
+        // a response once it is ready
+        iovec iovecs[MAX_IOVECS];
+        size_t iovec_count = 0;
+        {
+            std::lock_guard guard(connection->mutex);
+            size_t skip = connection->front_written;
+            for (const PendingResponse &response : connection->responses)
+            {
+                if (!response.ready || iovec_count + 2 > MAX_IOVECS)
+                {
+                    break;
+                }
+                for (const std::string *part : {&response.head, &response.body})
+                {
+                    if (skip >= part->size())
+                    {
+                        skip -= part->size();
+                        continue;
+                    }
+                    iovecs[iovec_count++] = {const_cast<char*>(part->data()) + skip,
+                                             part->size() - skip};
+                    skip = 0;
+                }
+                if (response.close_after)
+                {
+                    break;
+                }
+            }
+        }
+        if (iovec_count == 0U)
+        {
+            break;
+        }
+
+        // sendmsg is writev for sockets, and MSG_NOSIGNAL avoids SIGPIPE
+        msghdr message{};
+        message.msg_iov = iovecs;
+        message.msg_iovlen = iovec_count;
+        const ssize_t written = ::sendmsg(connection->socket.Get(), &message, MSG_NOSIGNAL);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                // EPOLLOUT resumes the flush
+                return;
+            }
+            Close(io_thread, connection);
+            return;
+        }
+
+        std::lock_guard guard(connection->mutex);
+        size_t remaining = connection->front_written + static_cast<size_t>(written);
+        while (!connection->responses.empty())
+        {
+            const PendingResponse &front = connection->responses.front();
+            if (!front.ready || remaining < front.head.size() + front.body.size())
+            {
+                break;
+            }
+            remaining -= front.head.size() + front.body.size();
+            close_after = front.close_after;
+            connection->responses.pop_front();
+            if (close_after)
+            {
+                break;
+            }
+        }
+        connection->front_written = remaining;
+    }
+
+    if (close_after)
+    {
+        Close(io_thread, connection);
+        return;
+    }
+
+    // Input held back by the pipelining limit can go now
+    if (!connection->input.empty())
+    {
+        ProcessInput(io_thread, connection);
+    }
+
+    bool idle = false;
+    {
+        std::lock_guard guard(connection->mutex);
+        idle = connection->responses.empty();
+    }
+    // Whatever input is left after end of stream is an incomplete request
+    if (!connection->closed && connection->input_finished && idle)
+    {
+        Close(io_thread, connection);
+    }
+}
+
+void QueryServer::Close(IoThread &io_thread, const std::shared_ptr<Connection> &connection)
+{
+    if (connection->closed)
+    {
+        return;
+    }
+    connection->closed = true;
+
+    const int fd = connection->socket.Get();
+    ::epoll_ctl(io_thread.epoll.Get(), EPOLL_CTL_DEL, fd, nullptr);
+    io_thread.connections.erase(fd);
+    connection->socket.Reset();
+}
+
+std::pair<int, std::string> QueryServer::HandleHttp(const HttpRequest &request)
+{
+    try
+    {
+        std::string body;
+        if (request.path == "/search"s && request.method == "GET"s)
+        {
+            const auto status = request.parameters.count("status"s) != 0U
+                    ? ParseDocumentStatus(request.parameters.at("status"s))
+                    : DocumentStatus::ACTUAL;
+            body = "["s;
+            for (const Document &document :
+                 service_.FindTopDocuments(GetParameter(request, "query"s), status))
+            {
+                body += body.size() > 1U ? ", {\"id\": "s : "{\"id\": "s;
+                body += std::to_string(document.id);
+                body += ", \"relevance\": "s;
+                AppendJsonNumber(body, document.relevance);
+                body += ", \"rating\": "s + std::to_string(document.rating) + "}"s;
+            }
+            body += "]"s;
+        }
+        else if (request.path == "/match"s && request.method == "GET"s)
+        {
+            const auto [words, status] = service_.MatchDocument(GetParameter(request, "query"s),
+                                                                ParseInt(GetParameter(request,
+                                                                                      "id"s)));
+            body = "{\"words\": ["s;
+            for (size_t ii = 0; ii < words.size(); ++ii)
+            {
+                if (ii > 0U)
+                {
+                    body += ", "s;
+                }
+                AppendJsonString(body, words[ii]);
+            }
+            body += "], \"status\": "s;
+            AppendJsonString(body, GetDocumentStatusName(status));
+            body += "}"s;
+        }
+        else if (request.path == "/count"s && request.method == "GET"s)
+        {
+            body = "{\"document_count\": "s + std::to_string(service_.GetDocumentCount()) + "}"s;
+        }
+        else if (request.path == "/documents"s && request.method == "POST"s)
+        {
+            const int document_id = ParseInt(GetParameter(request, "id"s));
+            const auto status = request.parameters.count("status"s) != 0U
+                    ? ParseDocumentStatus(request.parameters.at("status"s))
+                    : DocumentStatus::ACTUAL;
+            std::vector<int> ratings;
+            if (const auto found = request.parameters.find("ratings"s);
+                    found != request.parameters.end() && !found->second.empty())
+            {
+                std::string_view ratings_text = found->second;
+                while (true)
+                {
+                    const auto comma = ratings_text.find(',');
+                    ratings.push_back(ParseInt(ratings_text.substr(0, comma)));
+                    if (comma == std::string_view::npos)
+                    {
+                        break;
+                    }
+                    ratings_text.remove_prefix(comma + 1);
+                }
+            }
+            service_.AddDocument(document_id, request.body, status, ratings);
+            body = "{\"added\": "s + std::to_string(document_id) + "}"s;
+        }
+        else if (request.path == "/documents"s && request.method == "DELETE"s)
+        {
+            const int document_id = ParseInt(GetParameter(request, "id"s));
+            service_.RemoveDocument(document_id);
+            body = "{\"removed\": "s + std::to_string(document_id) + "}"s;
+        }
+        else
+        {
+            return {404, MakeErrorBody("Unknown endpoint "s + request.method + " "s + request.path)};
+        }
+        return {200, body};
+    }
+    catch (const std::invalid_argument &error)
+    {
+        return {400, MakeErrorBody(error.what())};
+    }
+    catch (const std::out_of_range &error)
+    {
+        return {404, MakeErrorBody(error.what())};
+    }
+    catch (const std::exception &error)
+    {
+        return {500, MakeErrorBody(error.what())};
+    }
+}
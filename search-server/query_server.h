@@ -0,0 +1,142 @@
+#ifndef QUERY_SERVER_H
+#define QUERY_SERVER_H
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "http_protocol.h"
+#include "search_server.h"
+#include "search_service.h"
+#include "socket_io.h"
+#include "thread_pool.h"
+
+struct QueryServerOptions
+{
+    // Either address may be empty to disable that protocol
+    std::string http_address;
+    std::string binary_address;
+    size_t io_thread_count = 2;
+    size_t worker_count = std::thread::hardware_concurrency();
+};
+
+/**
+ * Network front-end of a SearchServer, speaking HTTP/1.1 and the binary
+ * protocol on separate listeners.
+ *
+ *  GET    /search?query=...[&status=ACTUAL]
+ *  GET    /match?query=...&id=N
+ *  GET    /count
+ *  POST   /documents?id=N[&status=ACTUAL][&ratings=1,2,3]   body: text
+ *  DELETE /documents?id=N
+ *
+ * A few IO threads each run an edge-triggered epoll loop; parsed requests
+ * run on a worker pool. The requests of one connection run one after
+ * another and their responses are sent in request order, so clients may
+ * pipeline a search after a write. Ready responses are written with one
+ * scatter/gather call.
+ */
+class QueryServer
+{
+public:
+    QueryServer(SearchServer &search_server, QueryServerOptions options);
+
+    ~QueryServer();
+
+    // Serves until Stop; IO thread 0 runs on the calling thread
+    void Run();
+
+    // Async-signal-safe, may be called from any thread
+    void Stop();
+
+private:
+    enum class Protocol
+    {
+        HTTP,
+        BINARY,
+    };
+
+    struct PendingResponse
+    {
+        bool ready = false;
+        bool close_after = false;
+        std::string head;
+        std::string body;
+    };
+
+    struct Connection
+    {
+        SocketHandle socket;
+        Protocol protocol = Protocol::HTTP;
+        size_t io_thread = 0;
+
+        // Touched by the owning IO thread only
+        std::string input;
+        bool input_finished = false;
+        // Set once the client asked to close or sent a malformed request
+        bool ignore_input = false;
+        bool closed = false;
+        size_t front_written = 0;
+
+        // Workers fill their responses under the mutex; the deque keeps
+        // element addresses stable while the IO thread appends and pops
+        std::mutex mutex;
+        std::deque<PendingResponse> responses;
+
+        // Parsed requests waiting for the worker that runs this connection,
+        // also under the mutex. At most one worker runs them at a time.
+        std::deque<std::function<void(const std::shared_ptr<Connection>&)>> tasks;
+        bool is_running = false;
+    };
+
+    struct IoThread
+    {
+        SocketHandle epoll;
+        SocketHandle wake_event;
+        std::unordered_map<int, std::shared_ptr<Connection>> connections;
+
+        std::mutex mutex;
+        std::vector<std::shared_ptr<Connection>> accepted;
+        std::vector<std::shared_ptr<Connection>> completed;
+    };
+
+    void RunIoLoop(size_t index);
+    void AcceptConnections(int listener_fd, Protocol protocol);
+    void Wake(IoThread &io_thread);
+    void ReadInput(IoThread &io_thread, const std::shared_ptr<Connection> &connection);
+    void ProcessInput(IoThread &io_thread, const std::shared_ptr<Connection> &connection);
+    void Flush(IoThread &io_thread, const std::shared_ptr<Connection> &connection);
+    void Close(IoThread &io_thread, const std::shared_ptr<Connection> &connection);
+
+    // Queues a request of the connection behind the ones parsed before it
+    void Schedule(const std::shared_ptr<Connection> &connection,
+                  std::function<void(const std::shared_ptr<Connection>&)> task);
+
+    void RunTasks(const std::shared_ptr<Connection> &connection);
+
+    // Called on a worker once the response is filled in
+    void Complete(const std::shared_ptr<Connection> &connection, PendingResponse &response);
+
+    // Returns the status code and the JSON body
+    std::pair<int, std::string> HandleHttp(const HttpRequest &request);
+
+    SearchService service_;
+    const QueryServerOptions options_;
+    SocketHandle http_listener_;
+    SocketHandle binary_listener_;
+    std::vector<std::unique_ptr<IoThread>> io_threads_;
+    std::atomic<bool> stopping_ = false;
+    std::atomic<size_t> next_io_thread_ = 0;
+
+    // Declared last: destroyed first, so no task outlives the IO threads
+    ThreadPool workers_;
+};
+
+#endif // QUERY_SERVER_H
@@ -0,0 +1,130 @@
+#include <csignal>
+#include <iostream>
+#include <string>
+
+#include "corpus_loader.h"
+#include "query_server.h"
+#include "search_server.h"
+
+/**
+ * Standalone search server. Documents are added and queried over HTTP/1.1
+ * or the binary protocol; runs until SIGINT or SIGTERM.
+ *
+ *  SearchServerDaemon --http=tcp:127.0.0.1:8080 [--binary=unix:/tmp/search.sock]
+ *                     [--stop-words="a the"] [--io-threads=2] [--workers=8]
+ *                     [--corpus=docs.txt] [--corpus-format=records] [--memory-stats]
+ *
+ *  curl -X POST 'http://127.0.0.1:8080/documents?id=1&ratings=5,3' -d 'fluffy cat'
+ *  curl 'http://127.0.0.1:8080/search?query=cat'
+ *
+ * --corpus preloads documents in the SearchServerLoadTest corpus format.
+ * --memory-stats prints the memory of every index structure once the
+ * corpus is loaded and exits; loading growing slices of a corpus shows
+ * how the memory scales with its size.
+ */
+
+using namespace std;
+
+namespace
+{
+QueryServer *running_server = nullptr;
+
+void HandleStopSignal(int /*unused*/)
+{
+    if (running_server != nullptr)
+    {
+        running_server->Stop();
+    }
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QueryServerOptions options;
+    string stop_words;
+    string corpus_path;
+    CorpusLoadOptions corpus_options;
+    bool memory_stats = false;
+    try
+    {
+        for (int ii = 1; ii < argc; ++ii)
+        {
+            const string argument = argv[ii];
+            const auto separator = argument.find('=');
+            const string name = argument.substr(0, separator);
+            const string value = separator == string::npos ? ""s : argument.substr(separator + 1);
+
+            if (name == "--http"s)
+            {
+                options.http_address = value;
+            }
+            else if (name == "--binary"s)
+            {
+                options.binary_address = value;
+            }
+            else if (name == "--stop-words"s)
+            {
+                stop_words = value;
+            }
+            else if (name == "--corpus"s)
+            {
+                corpus_path = value;
+            }
+            else if (name == "--corpus-format"s)
+            {
+                if (value != "lines"s && value != "records"s)
+                {
+                    throw invalid_argument("Unknown corpus format "s + value);
+                }
+                corpus_options.format = value == "lines"s ? CorpusFormat::LINES
+                                                          : CorpusFormat::RECORDS;
+            }
+            else if (name == "--memory-stats"s)
+            {
+                memory_stats = true;
+            }
+            else if (name == "--io-threads"s)
+            {
+                options.io_thread_count = stoull(value);
+            }
+            else if (name == "--workers"s)
+            {
+                options.worker_count = stoull(value);
+            }
+            else
+            {
+                throw invalid_argument("Unknown option "s + argument);
+            }
+        }
+
+        SearchServer search_server(stop_words);
+        if (!corpus_path.empty())
+        {
+            LoadCorpus(search_server, corpus_path, corpus_options);
+            cerr << search_server.GetDocumentCount() << " documents loaded"s << endl;
+        }
+        if (memory_stats)
+        {
+            PrintMemoryStats(cout, search_server.GetMemoryStats());
+            return 0;
+        }
+        QueryServer server(search_server, options);
+
+        running_server = &server;
+        signal(SIGINT, HandleStopSignal);
+        signal(SIGTERM, HandleStopSignal);
+
+        cerr << "Serving"s
+             << (options.http_address.empty() ? ""s : " HTTP on "s + options.http_address)
+             << (options.binary_address.empty() ? ""s : " binary on "s + options.binary_address)
+             << endl;
+        server.Run();
+        running_server = nullptr;
+    }
+    catch (const exception &error)
+    {
+        cerr << error.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -1,18 +1,26 @@
 #include "read_input_functions.h"
 
-#include <iostream>
-
 std::string ReadLine()
+{
+    return ReadLine(std::cin);
+}
+
+int ReadLineWithNumber()
+{
+    return ReadLineWithNumber(std::cin);
+}
+
+std::string ReadLine(std::istream& input)
 {
     std::string s;
-    getline(std::cin, s);
+    getline(input, s);
     return s;
 }
 
-int ReadLineWithNumber()
+int ReadLineWithNumber(std::istream& input)
 {
     int result = 0;
-    std::cin >> result;
-    ReadLine();
+    input >> result;
+    ReadLine(input);
     return result;
 }
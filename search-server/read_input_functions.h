@@ -1,6 +1,11 @@
 #pragma once
+#include <iostream>
 #include <string>
 
 std::string ReadLine();
 
 int ReadLineWithNumber();
+
+std::string ReadLine(std::istream& input);
+
+int ReadLineWithNumber(std::istream& input);
@@ -2,7 +2,8 @@
 
 RequestQueue::RequestQueue(const SearchServer& search_server) :
     search_server_(search_server),
-    counter_id_(0)
+    counter_id_(0),
+    no_result_requests_(0)
 {
 
 }
@@ -26,17 +27,43 @@ std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query)
 
 int RequestQueue::GetNoResultRequests() const
 {
-    return count_if(requests_.begin(), requests_.end(),
-                    [](const QueryResult &result)
+    return no_result_requests_;
+}
+
+void RequestQueue::RecordRequest(RequestStatistics::Clock::time_point finished_at,
+                                 RequestStatistics::Clock::duration latency,
+                                 size_t founded_docs)
+{
+    ++counter_id_;
+    requests_.push_back({counter_id_, static_cast<uint32_t>(founded_docs)});
+    if (founded_docs == 0U)
     {
-        return result.founded_docs_ == 0;
-    });
+        ++no_result_requests_;
+    }
+    CheckEndOfDay();
+
+    statistics_.Record(finished_at, latency, founded_docs == 0U);
+}
+
+LatencyStats RequestQueue::GetLatencyStats(StatsWindow window) const
+{
+    return GetLatencyStats(window, RequestStatistics::Clock::now());
+}
+
+LatencyStats RequestQueue::GetLatencyStats(StatsWindow window,
+                                           RequestStatistics::Clock::time_point now) const
+{
+    return statistics_.GetStats(window, now);
 }
 
 void RequestQueue::CheckEndOfDay()
 {
     if (requests_.size() > min_in_day_)
     {
+        if (requests_.front().founded_docs_ == 0)
+        {
+            --no_result_requests_;
+        }
         requests_.pop_front();
     }
 }
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <chrono>
 #include <queue>
 
+#include "request_statistics.h"
 #include "search_server.h"
 
 class RequestQueue
@@ -20,6 +22,16 @@ public:
     std::vector<Document> AddFindRequest(const std::string& raw_query);
 
     int GetNoResultRequests() const;
+
+    // Records a request whose search ran outside of AddFindRequest
+    void RecordRequest(RequestStatistics::Clock::time_point finished_at,
+                       RequestStatistics::Clock::duration latency,
+                       size_t founded_docs);
+
+    LatencyStats GetLatencyStats(StatsWindow window) const;
+
+    LatencyStats GetLatencyStats(StatsWindow window,
+                                 RequestStatistics::Clock::time_point now) const;
 private:
 
     const static size_t min_in_day_ = 1440;
@@ -36,6 +48,10 @@ private:
 
     uint64_t counter_id_;
 
+    int no_result_requests_;
+
+    RequestStatistics statistics_;
+
     void CheckEndOfDay();
 
 };
@@ -44,10 +60,10 @@ template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query,
                                                    DocumentPredicate document_predicate)
 {
+    const auto start_time = RequestStatistics::Clock::now();
     std::vector<Document> result =
             search_server_.FindTopDocuments(raw_query, document_predicate);
-    ++counter_id_;
-    requests_.push_back({counter_id_, static_cast<uint32_t>(result.size())});
-    CheckEndOfDay();
+    const auto finish_time = RequestStatistics::Clock::now();
+    RecordRequest(finish_time, finish_time - start_time, result.size());
     return result;
 }
@@ -0,0 +1,132 @@
+#include "request_statistics.h"
+
+#include <algorithm>
+
+using namespace std::chrono;
+
+RequestStatistics::RequestStatistics() :
+    windows_{SlidingWindow{Clock::duration{minutes{1}} / SLOT_COUNT},
+             SlidingWindow{Clock::duration{minutes{5}} / SLOT_COUNT},
+             SlidingWindow{Clock::duration{hours{1}} / SLOT_COUNT}}
+{
+
+}
+
+void RequestStatistics::Record(Clock::time_point finished_at,
+                               Clock::duration latency,
+                               bool is_zero_result)
+{
+    if (!has_records_)
+    {
+        first_record_ = finished_at;
+        has_records_ = true;
+    }
+
+    const auto latency_ns =
+            static_cast<uint64_t>(std::max<int64_t>(0, duration_cast<nanoseconds>(latency).count()));
+    for (SlidingWindow &window : windows_)
+    {
+        window.Record(finished_at, latency_ns, is_zero_result);
+    }
+}
+
+LatencyStats RequestStatistics::GetStats(StatsWindow window, Clock::time_point now) const
+{
+    if (!has_records_)
+    {
+        return {};
+    }
+    return windows_[static_cast<size_t>(window)].GetStats(now, first_record_);
+}
+
+RequestStatistics::SlidingWindow::SlidingWindow(Clock::duration slot_width) :
+    slot_width_(slot_width),
+    slots_(SLOT_COUNT)
+{
+
+}
+
+void RequestStatistics::SlidingWindow::Record(Clock::time_point finished_at,
+                                              uint64_t latency_ns,
+                                              bool is_zero_result)
+{
+    const int64_t slot_number = GetSlotNumber(finished_at);
+    Advance(slot_number);
+
+    // Records that are late by more than the window are dropped
+    if (slot_number <= newest_slot_ - static_cast<int64_t>(SLOT_COUNT))
+    {
+        return;
+    }
+
+    Slot &slot = slots_[static_cast<size_t>(slot_number) % SLOT_COUNT];
+    slot.latency.Record(latency_ns);
+    total_.latency.Record(latency_ns);
+    if (is_zero_result)
+    {
+        ++slot.zero_results;
+        ++total_.zero_results;
+    }
+}
+
+LatencyStats RequestStatistics::SlidingWindow::GetStats(Clock::time_point now,
+                                                        Clock::time_point first_record) const
+{
+    // Slots that fell out of the window since the last Record are
+    // subtracted from a copy, so reading never mutates the window
+    const int64_t now_slot = std::max(GetSlotNumber(now), newest_slot_);
+    const int64_t expired = std::min<int64_t>(now_slot - newest_slot_,
+                                              static_cast<int64_t>(SLOT_COUNT));
+    Slot window = total_;
+    for (int64_t ii = 1; ii <= expired; ++ii)
+    {
+        const Slot &slot = slots_[static_cast<size_t>(newest_slot_ + ii) % SLOT_COUNT];
+        window.latency.Subtract(slot.latency);
+        window.zero_results -= slot.zero_results;
+    }
+
+    LatencyStats stats;
+    stats.request_count = window.latency.GetCount();
+    if (stats.request_count == 0U)
+    {
+        return stats;
+    }
+
+    const auto observed = std::clamp<Clock::duration>(now - first_record,
+                                                      slot_width_,
+                                                      slot_width_ * SLOT_COUNT);
+    stats.queries_per_second = static_cast<double>(stats.request_count) /
+            duration_cast<duration<double>>(observed).count();
+    stats.zero_result_rate = static_cast<double>(window.zero_results) /
+            static_cast<double>(stats.request_count);
+    stats.p50 = nanoseconds{window.latency.GetPercentile(50.0)};
+    stats.p90 = nanoseconds{window.latency.GetPercentile(90.0)};
+    stats.p99 = nanoseconds{window.latency.GetPercentile(99.0)};
+    stats.p999 = nanoseconds{window.latency.GetPercentile(99.9)};
+    return stats;
+}
+
+int64_t RequestStatistics::SlidingWindow::GetSlotNumber(Clock::time_point time) const
+{
+    return time.time_since_epoch() / slot_width_;
+}
+
+void RequestStatistics::SlidingWindow::Advance(int64_t slot_number)
+{
+    if (newest_slot_ < 0)
+    {
+        newest_slot_ = slot_number;
+        return;
+    }
+
+    const int64_t last = std::min(slot_number, newest_slot_ + static_cast<int64_t>(SLOT_COUNT));
+    for (int64_t number = newest_slot_ + 1; number <= last; ++number)
+    {
+        Slot &slot = slots_[static_cast<size_t>(number) % SLOT_COUNT];
+        total_.latency.Subtract(slot.latency);
+        total_.zero_results -= slot.zero_results;
+        slot.latency.Clear();
+        slot.zero_results = 0;
+    }
+    newest_slot_ = std::max(newest_slot_, slot_number);
+}
@@ -0,0 +1,82 @@
+#ifndef REQUEST_STATISTICS_H
+#define REQUEST_STATISTICS_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "latency_histogram.h"
+
+enum class StatsWindow
+{
+    MINUTE,
+    FIVE_MINUTES,
+    HOUR,
+};
+
+struct LatencyStats
+{
+    uint64_t request_count = 0;
+    double queries_per_second = 0.0;
+    double zero_result_rate = 0.0;
+    std::chrono::nanoseconds p50{0};
+    std::chrono::nanoseconds p90{0};
+    std::chrono::nanoseconds p99{0};
+    std::chrono::nanoseconds p999{0};
+};
+
+// Latency and zero-result statistics over sliding wall-clock windows.
+// Every window is a ring of time slots plus a running total, so recording
+// is O(1) and reading is O(histogram buckets) regardless of traffic.
+class RequestStatistics
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    RequestStatistics();
+
+    void Record(Clock::time_point finished_at,
+                Clock::duration latency,
+                bool is_zero_result);
+
+    LatencyStats GetStats(StatsWindow window, Clock::time_point now) const;
+
+private:
+    // Number of slots each window is divided into
+    static constexpr size_t SLOT_COUNT = 60;
+
+    struct Slot
+    {
+        LatencyHistogram latency;
+        uint64_t zero_results = 0;
+    };
+
+    class SlidingWindow
+    {
+    public:
+        explicit SlidingWindow(Clock::duration slot_width);
+
+        void Record(Clock::time_point finished_at, uint64_t latency_ns, bool is_zero_result);
+
+        LatencyStats GetStats(Clock::time_point now,
+                              Clock::time_point first_record) const;
+
+    private:
+        Clock::duration slot_width_;
+        std::vector<Slot> slots_;
+        Slot total_;
+        // Absolute number of the newest slot, counted from the clock epoch
+        int64_t newest_slot_ = -1;
+
+        int64_t GetSlotNumber(Clock::time_point time) const;
+
+        void Advance(int64_t slot_number);
+    };
+
+    std::array<SlidingWindow, 3> windows_;
+    Clock::time_point first_record_;
+    bool has_records_ = false;
+};
+
+#endif // REQUEST_STATISTICS_H
@@ -0,0 +1,25 @@
+#ifndef SEARCH_BUDGET_H
+#define SEARCH_BUDGET_H
+
+#include <chrono>
+#include <optional>
+#include <vector>
+
+#include "document.h"
+
+// Limits for anytime ranking; an empty budget processes every posting
+struct SearchBudget
+{
+    std::optional<std::chrono::steady_clock::duration> time;
+    std::optional<size_t> max_postings;
+};
+
+struct BudgetedSearchResult
+{
+    std::vector<Document> documents;
+    // False when the budget ran out before every posting was scored
+    bool is_exact = true;
+    size_t processed_postings = 0;
+};
+
+#endif // SEARCH_BUDGET_H
@@ -0,0 +1,109 @@
+#include "search_cursor.h"
+
+#include <array>
+#include <cstring>
+
+using namespace std::literals::string_literals;
+
+namespace
+{
+constexpr size_t TOKEN_FIELD_COUNT = 4;
+constexpr size_t HEX_DIGITS_PER_FIELD = 16;
+constexpr std::string_view HEX_DIGITS = "0123456789abcdef";
+
+uint64_t GetRelevanceBits(double relevance)
+{
+    uint64_t bits = 0;
+    std::memcpy(&bits, &relevance, sizeof(bits));
+    return bits;
+}
+
+double GetRelevance(uint64_t bits)
+{
+    double relevance = 0.0;
+    std::memcpy(&relevance, &bits, sizeof(relevance));
+    return relevance;
+}
+}
+
+SearchCursor::SearchCursor(const Document &last, uint64_t generation, uint64_t query_hash) :
+    last_(last),
+    generation_(generation),
+    query_hash_(query_hash)
+{
+
+}
+
+bool SearchCursor::IsStart() const
+{
+    return !last_.has_value();
+}
+
+const Document &SearchCursor::GetLast() const
+{
+    return *last_;
+}
+
+uint64_t SearchCursor::GetGeneration() const
+{
+    return generation_;
+}
+
+uint64_t SearchCursor::GetQueryHash() const
+{
+    return query_hash_;
+}
+
+std::string SearchCursor::ToToken() const
+{
+    if (IsStart())
+    {
+        return {};
+    }
+
+    const std::array<uint64_t, TOKEN_FIELD_COUNT> fields = {
+        GetRelevanceBits(last_->relevance),
+        static_cast<uint64_t>(static_cast<uint32_t>(last_->rating)) << 32U |
+        static_cast<uint32_t>(last_->id),
+        generation_,
+        query_hash_,
+    };
+    std::string token;
+    token.reserve(TOKEN_FIELD_COUNT * HEX_DIGITS_PER_FIELD);
+    for (const uint64_t field : fields)
+    {
+        for (size_t shift = HEX_DIGITS_PER_FIELD * 4U; shift != 0U; shift -= 4U)
+        {
+            token.push_back(HEX_DIGITS[field >> (shift - 4U) & 0xFU]);
+        }
+    }
+    return token;
+}
+
+SearchCursor SearchCursor::FromToken(std::string_view token)
+{
+    if (token.empty())
+    {
+        return {};
+    }
+    if (token.size() != TOKEN_FIELD_COUNT * HEX_DIGITS_PER_FIELD)
+    {
+        throw std::invalid_argument("Invalid search cursor"s);
+    }
+
+    std::array<uint64_t, TOKEN_FIELD_COUNT> fields{};
+    for (size_t ii = 0; ii < token.size(); ++ii)
+    {
+        const size_t digit = HEX_DIGITS.find(token[ii]);
+        if (digit == std::string_view::npos)
+        {
+            throw std::invalid_argument("Invalid search cursor"s);
+        }
+        fields[ii / HEX_DIGITS_PER_FIELD] = fields[ii / HEX_DIGITS_PER_FIELD] << 4U | digit;
+    }
+
+    const Document last(static_cast<int>(static_cast<uint32_t>(fields[1])),
+                        GetRelevance(fields[0]),
+                        static_cast<int>(static_cast<uint32_t>(fields[1] >> 32U)));
+    return {last, fields[2], fields[3]};
+}
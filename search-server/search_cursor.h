@@ -0,0 +1,64 @@
+#ifndef SEARCH_CURSOR_H
+#define SEARCH_CURSOR_H
+
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+
+// The index changed since the cursor was issued, so the pages that follow
+// would no longer line up with the ones already served
+class StaleCursorError : public std::runtime_error
+{
+public:
+    StaleCursorError() :
+        std::runtime_error("search cursor is stale")
+    {
+
+    }
+};
+
+// Position in the ranked results of one query: the last document served
+// and the index generation it was ranked in. The server keeps nothing
+// between pages, the cursor carries all it needs.
+class SearchCursor
+{
+public:
+    // Cursor of the first page
+    SearchCursor() = default;
+
+    SearchCursor(const Document &last, uint64_t generation, uint64_t query_hash);
+
+    bool IsStart() const;
+
+    // Only for a cursor that is not the start
+    const Document &GetLast() const;
+
+    uint64_t GetGeneration() const;
+
+    uint64_t GetQueryHash() const;
+
+    // Printable token to hand to a client; empty for the start
+    std::string ToToken() const;
+
+    // Throws std::invalid_argument for a malformed token
+    static SearchCursor FromToken(std::string_view token);
+
+private:
+    std::optional<Document> last_;
+    uint64_t generation_ = 0;
+    uint64_t query_hash_ = 0;
+};
+
+struct SearchPage
+{
+    std::vector<Document> documents;
+    // Empty after the last page
+    std::optional<SearchCursor> next;
+};
+
+#endif // SEARCH_CURSOR_H
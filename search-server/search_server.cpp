@@ -1,19 +1,29 @@
 #include "search_server.h"
 
 #include <algorithm>
+#include <charconv>
 #include <cmath>
+#include <limits>
+#include <optional>
 
-SearchServer::SearchServer(const std::string& stop_words_text)
-    : SearchServer(SplitIntoWords(stop_words_text))
+SearchServer::SearchServer(const std::string& stop_words_text,
+                           std::pmr::memory_resource *resource)
+    : SearchServer(SplitIntoWords(stop_words_text), resource)
 {
 
 }
 
+std::pmr::memory_resource *SearchServer::GetMemoryResource() const
+{
+    return resource_;
+}
+
 void SearchServer::AddDocument(int document_id,
                                std::string_view document,
                                DocumentStatus status,
                                const std::vector<int>& ratings)
 {
+    PROFILE_SCOPE("AddDocument");
     using namespace std::literals::string_literals;
     if ((document_id < 0) || (documents_.count(document_id) > 0))
     {
@@ -22,24 +32,64 @@ void SearchServer::AddDocument(int document_id,
 
     DocumentData doc_data = {ComputeAverageRating(ratings),
                              status,
-                             std::string{document},
+                             std::pmr::string(document, &document_texts_memory_),
+                             std::pmr::set<std::string_view>(&document_words_memory_),
                              {}};
 
-    documents_.emplace(document_id, std::move(doc_data));
+    auto &stored = documents_.emplace(document_id, std::move(doc_data)).first->second;
+
+    std::vector<std::string_view> splited_words;
+    try
+    {
+        splited_words = SplitIntoWordsNoStop(std::string_view{stored.text});
+    }
+    catch (...)
+    {
+        documents_.erase(document_id);
+        throw;
+    }
+
+    stored.view = {splited_words.begin(), splited_words.end()};
+    for (const std::string_view word : stored.view)
+    {
+        stored.fingerprint.AddWord(word);
+    }
 
-    const std::vector<std::string_view> splited_words =
-            SplitIntoWordsNoStop(std::string_view{documents_.at(document_id).text});
+    auto &same_fingerprint = fingerprint_to_documents_[stored.fingerprint];
+    if (!same_fingerprint.empty())
+    {
+        if (duplicate_policy_ == DuplicatePolicy::REJECT)
+        {
+            documents_.erase(document_id);
+            throw std::invalid_argument("Document "s + std::to_string(document_id) +
+                                        " is a duplicate"s);
+        }
+    }
+    same_fingerprint.insert(document_id);
 
     const double inv_word_count = 1.0 / splited_words.size();
     for (const auto &word : splited_words)
     {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
+        const auto [postings, is_new_word] = word_to_document_freqs_.try_emplace(word);
+        if (is_new_word)
+        {
+            term_dictionary_.Insert(word);
+        }
+        postings->second[document_id] += inv_word_count;
         document_to_word_freqs_[document_id][word] += inv_word_count;
     }
     document_ids_.insert(document_id);
+    posting_count_ += document_to_word_freqs_[document_id].size();
+    ++generation_;
 
-    documents_.at(document_id).view = {std::make_move_iterator(splited_words.begin()),
-            std::make_move_iterator(splited_words.end())};
+    if (impact_ordered_)
+    {
+        AddImpactPostings(document_id);
+    }
+    if (positional_)
+    {
+        AddPositions(document_id);
+    }
 }
 
 std::vector<Document>
@@ -77,6 +127,28 @@ std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query,
     return FindTopDocuments(std::execution::seq, raw_query, status);
 }
 
+const std::vector<Document> &
+SearchServer::FindTopDocuments(QueryContext &context,
+                               std::string_view raw_query,
+                               DocumentStatus status) const
+{
+    return FindTopDocuments(context,
+                            raw_query,
+                            [status](int /*unused*/,
+                            DocumentStatus document_status,
+                            int /*unused*/)
+    {
+        return document_status == status;
+    });
+}
+
+const std::vector<Document> &
+SearchServer::FindTopDocuments(QueryContext &context,
+                               std::string_view raw_query) const
+{
+    return FindTopDocuments(context, raw_query, DocumentStatus::ACTUAL);
+}
+
 std::vector<Document>
 SearchServer::FindTopDocuments(std::execution::sequenced_policy /*unused*/,
                                std::string_view raw_query) const
@@ -97,17 +169,230 @@ SearchServer::FindTopDocuments(std::string_view raw_query) const
     return FindTopDocuments(std::execution::seq, raw_query, DocumentStatus::ACTUAL);
 }
 
+BudgetedSearchResult SearchServer::FindTopDocuments(std::string_view raw_query,
+                                                    const SearchBudget &budget) const
+{
+    return FindTopDocuments(raw_query,
+                            budget,
+                            [](int /*unused*/,
+                            DocumentStatus document_status,
+                            int /*unused*/)
+    {
+        return document_status == DocumentStatus::ACTUAL;
+    });
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query,
+                                                     const CorpusStatistics &statistics,
+                                                     DocumentStatus status) const
+{
+    return FindTopDocuments(raw_query,
+                            statistics,
+                            [status](int /*unused*/,
+                            DocumentStatus document_status,
+                            int /*unused*/)
+    {
+        return document_status == status;
+    });
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query,
+                                                     const CorpusStatistics &statistics) const
+{
+    return FindTopDocuments(raw_query, statistics, DocumentStatus::ACTUAL);
+}
+
+SearchPage SearchServer::FindPage(std::string_view raw_query,
+                                  const SearchCursor &cursor,
+                                  size_t page_size,
+                                  DocumentStatus status) const
+{
+    return FindPage(raw_query, cursor, page_size, StatusFilter{status});
+}
+
+SearchPage SearchServer::FindPage(std::string_view raw_query,
+                                  const SearchCursor &cursor,
+                                  size_t page_size) const
+{
+    return FindPage(raw_query, cursor, page_size, DocumentStatus::ACTUAL);
+}
+
+CorpusStatistics SearchServer::CollectQueryStatistics(std::string_view raw_query) const
+{
+    const Query query = ParseQuery(raw_query, true);
+
+    CorpusStatistics statistics;
+    statistics.document_count = GetDocumentCount();
+    const auto add_word = [this, &statistics](std::string_view word)
+    {
+        const auto postings = word_to_document_freqs_.find(word);
+        statistics.document_freqs.emplace(word, postings == word_to_document_freqs_.end()
+                                          ? 0 : static_cast<int>(postings->second.size()));
+    };
+    for (const std::string_view word : query.plus_words)
+    {
+        add_word(word);
+    }
+
+    // The local top expansions may not be the global ones, so all of them go
+    std::vector<std::string_view> expansions;
+    for (const std::string_view prefix : query.plus_prefixes)
+    {
+        statistics.prefixes.emplace(prefix);
+        expansions.clear();
+        ExpandPrefix(prefix, std::numeric_limits<size_t>::max(), expansions);
+        for (const std::string_view word : expansions)
+        {
+            add_word(word);
+        }
+    }
+    return statistics;
+}
+
+std::vector<Document>
+SearchServer::MergeTopDocuments(const std::vector<std::vector<Document>> &results)
+{
+    std::vector<Document> merged;
+    for (const auto &documents : results)
+    {
+        merged.insert(merged.end(), documents.begin(), documents.end());
+    }
+
+    std::sort(merged.begin(), merged.end(), IsMoreRelevant);
+    if (merged.size() > MAX_RESULT_DOCUMENT_COUNT)
+    {
+        merged.resize(MAX_RESULT_DOCUMENT_COUNT);
+    }
+    return merged;
+}
+
+void SearchServer::EnableImpactOrderedPostings()
+{
+    if (impact_ordered_)
+    {
+        return;
+    }
+
+    impact_ordered_ = true;
+    for (const int document_id : document_ids_)
+    {
+        AddImpactPostings(document_id);
+    }
+}
+
+bool SearchServer::HasImpactOrderedPostings() const
+{
+    return impact_ordered_;
+}
+
+void SearchServer::EnablePositionalIndex()
+{
+    if (positional_)
+    {
+        return;
+    }
+
+    positional_ = true;
+    for (const int document_id : document_ids_)
+    {
+        AddPositions(document_id);
+    }
+}
+
+bool SearchServer::HasPositionalIndex() const
+{
+    return positional_;
+}
+
+std::future<std::vector<Document>>
+SearchServer::SubmitQuery(std::string raw_query,
+                          DocumentStatus status,
+                          QueryOptions options) const
+{
+    return SubmitQuery(std::move(raw_query),
+                       [status](int /*unused*/,
+                       DocumentStatus document_status,
+                       int /*unused*/)
+    {
+        return document_status == status;
+    },
+    std::move(options));
+}
+
+std::future<std::vector<Document>>
+SearchServer::SubmitQuery(std::string raw_query,
+                          QueryOptions options) const
+{
+    return SubmitQuery(std::move(raw_query),
+                       DocumentStatus::ACTUAL,
+                       std::move(options));
+}
+
+#ifdef SEARCH_SERVER_HAS_COROUTINES
+SearchServer::QueryAwaitable
+SearchServer::AwaitQuery(std::string raw_query,
+                         QueryOptions options) const
+{
+    return AwaitQuery(std::move(raw_query),
+                      [](int /*unused*/,
+                      DocumentStatus document_status,
+                      int /*unused*/)
+    {
+        return document_status == DocumentStatus::ACTUAL;
+    },
+    std::move(options));
+}
+#endif
+
 int SearchServer::GetDocumentCount() const
 {
     return documents_.size();
 }
 
-std::set<int>::iterator SearchServer::begin()
+uint64_t SearchServer::GetGeneration() const
+{
+    return generation_;
+}
+
+MemoryStats SearchServer::GetMemoryStats() const
+{
+    const auto usage = [](const CountingMemoryResource &memory)
+    {
+        return MemoryUsage{memory.GetAllocatedBytes(), memory.GetLiveAllocationCount()};
+    };
+
+    MemoryStats stats;
+    stats.inverted_index = usage(inverted_index_memory_);
+    stats.term_dictionary = usage(term_dictionary_memory_);
+    stats.forward_index = usage(forward_index_memory_);
+    stats.documents = usage(documents_memory_);
+    stats.document_texts = usage(document_texts_memory_);
+    stats.document_words = usage(document_words_memory_);
+    stats.impact_postings = usage(impact_postings_memory_);
+    stats.positions = usage(positions_memory_);
+    stats.duplicates = usage(duplicates_memory_);
+    stats.term_count = word_to_document_freqs_.size();
+    stats.posting_count = posting_count_;
+    stats.document_count = documents_.size();
+    return stats;
+}
+
+std::pmr::set<int>::iterator SearchServer::begin()
+{
+    return document_ids_.begin();
+}
+
+std::pmr::set<int>::iterator SearchServer::end()
+{
+    return document_ids_.end();
+}
+
+std::pmr::set<int>::const_iterator SearchServer::begin() const
 {
     return document_ids_.begin();
 }
 
-std::set<int>::iterator SearchServer::end()
+std::pmr::set<int>::const_iterator SearchServer::end() const
 {
     return document_ids_.end();
 }
@@ -117,6 +402,7 @@ SearchServer::MatchDocument(std::execution::sequenced_policy /*unused*/,
                             std::string_view raw_query,
                             int document_id) const
 {
+    PROFILE_SCOPE("MatchDocument");
     using namespace std;
 
     if (documents_.count(document_id) == 0)
@@ -124,165 +410,529 @@ SearchServer::MatchDocument(std::execution::sequenced_policy /*unused*/,
         throw std::out_of_range("there is no such id");
     }
 
-    Query query = ParseQuery(raw_query, true);
+    return MatchParsedQuery(ParseQuery(raw_query, true), document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus>
+SearchServer::MatchDocument(std::execution::parallel_policy /*unused*/,
+                            std::string_view raw_query,
+                            int document_id) const
+{
+    // The sorted merge is linear in the document size at worst,
+    // a parallel scan of a single document does not pay off
+    return MatchDocument(std::execution::seq, raw_query, document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus>
+SearchServer::MatchDocument(std::string_view raw_query,
+                            int document_id) const
+{
+    return MatchDocument(std::execution::seq, raw_query, document_id);
+}
 
-    for (const auto& word : query.minus_words)
+std::tuple<const std::vector<std::string_view>&, DocumentStatus>
+SearchServer::MatchDocument(QueryContext &context,
+                            std::string_view raw_query,
+                            int document_id) const
+{
+    PROFILE_SCOPE("MatchDocument");
+    if (documents_.count(document_id) == 0)
     {
-        if ( auto search = documents_.at(document_id).view.find(word);
-             search != documents_.at(document_id).view.end() )
-        {
-            return {std::vector<std::string_view>{},
-                documents_.at(document_id).status};
-        }
+        throw std::out_of_range("there is no such id");
     }
 
-    std::vector<std::string_view> matched_words;
+    ParseQuery(raw_query, true, context.tokens_, context.query_);
+    const DocumentStatus status = MatchParsedQuery(context.query_, document_id,
+                                                   context.matched_words_);
+    return {context.matched_words_, status};
+}
+
+std::vector<SearchServer::MatchResult>
+SearchServer::MatchDocuments(std::execution::sequenced_policy policy,
+                             std::string_view raw_query,
+                             const std::vector<int> &document_ids) const
+{
+    return MatchParsedQuery(policy, raw_query, document_ids);
+}
+
+std::vector<SearchServer::MatchResult>
+SearchServer::MatchDocuments(std::execution::parallel_policy policy,
+                             std::string_view raw_query,
+                             const std::vector<int> &document_ids) const
+{
+    return MatchParsedQuery(policy, raw_query, document_ids);
+}
+
+std::vector<SearchServer::MatchResult>
+SearchServer::MatchDocuments(std::string_view raw_query,
+                             const std::vector<int> &document_ids) const
+{
+    return MatchDocuments(std::execution::seq, raw_query, document_ids);
+}
+
+SearchServer::WordFrequencies SearchServer::GetWordFrequencies(int document_id) const
+{
+    static const std::pmr::map<std::string_view, double> empty_frequencies;
 
-    for (const auto& word : query.plus_words)
+    const auto frequencies = document_to_word_freqs_.find(document_id);
+    if (frequencies == document_to_word_freqs_.end())
     {
-        if ( auto search = documents_.at(document_id).view.find(word);
-             search != documents_.at(document_id).view.end() )
-        {
-            matched_words.emplace_back(*search);
-        }
+        return {empty_frequencies.begin(), empty_frequencies.end()};
     }
 
-    return {matched_words, documents_.at(document_id).status};
+    return {frequencies->second.begin(), frequencies->second.end()};
 }
 
-std::tuple<std::vector<std::string_view>, DocumentStatus>
-SearchServer::MatchDocument(std::execution::parallel_policy /*unused*/,
-                            std::string_view raw_query,
-                            int document_id) const
+void SearchServer::RemoveDocument(const std::execution::sequenced_policy /*unused*/,
+                                  int document_id)
 {
-    using namespace std;
+    EraseDocument(document_id);
+}
 
-    if (document_to_word_freqs_.count(document_id) == 0U)
+// The postings of one document are too few to split between threads
+void SearchServer::RemoveDocument(const std::execution::parallel_policy /*unused*/,
+                                  int document_id)
+{
+    EraseDocument(document_id);
+}
+
+void SearchServer::RemoveDocument(int document_id)
+{
+    RemoveDocument(std::execution::seq, document_id);
+}
+
+void SearchServer::RemoveDocuments(std::execution::sequenced_policy policy,
+                                   const std::vector<int> &document_ids)
+{
+    EraseDocuments(policy, document_ids);
+}
+
+void SearchServer::RemoveDocuments(std::execution::parallel_policy policy,
+                                   const std::vector<int> &document_ids)
+{
+    EraseDocuments(policy, document_ids);
+}
+
+void SearchServer::RemoveDocuments(const std::vector<int> &document_ids)
+{
+    EraseDocuments(std::execution::seq, document_ids);
+}
+
+void SearchServer::SetDuplicatePolicy(DuplicatePolicy policy)
+{
+    duplicate_policy_ = policy;
+}
+
+bool SearchServer::IsFlaggedDuplicate(int document_id) const
+{
+    if (duplicate_policy_ != DuplicatePolicy::FLAG)
+    {
+        return false;
+    }
+    const auto document = documents_.find(document_id);
+    if (document == documents_.end())
     {
-        throw out_of_range("there is no such id");
+        return false;
     }
+    // Groups are sorted, the smallest id is the original
+    return *fingerprint_to_documents_.at(document->second.fingerprint).begin() != document_id;
+}
+
+std::vector<int> SearchServer::FindDuplicates(std::execution::sequenced_policy policy) const
+{
+    return CollectDuplicates(policy);
+}
+
+std::vector<int> SearchServer::FindDuplicates(std::execution::parallel_policy policy) const
+{
+    return CollectDuplicates(policy);
+}
+
+std::vector<int> SearchServer::FindDuplicates() const
+{
+    return FindDuplicates(std::execution::seq);
+}
 
-    const Query query = ParseQuery(raw_query);
+std::vector<uint64_t> SearchServer::ComputeMinHashSignature(int document_id,
+                                                           size_t hash_count) const
+{
+    std::vector<uint64_t> signature(hash_count, std::numeric_limits<uint64_t>::max());
 
-    bool result = any_of(execution::par,
-                         query.minus_words.begin(), query.minus_words.end(),
-                         [this, document_id](const auto &word)
+    const auto words = document_to_word_freqs_.find(document_id);
+    if (words == document_to_word_freqs_.end())
     {
-        return document_to_word_freqs_.at(document_id).count(word) != 0U;
-    });
+        return signature;
+    }
 
-    if (result)
+    // Double hashing: the i-th hash function is Mix(h1 + i * h2)
+    for (const auto &[word, term_freq] : words->second)
     {
-        return {vector<string_view>{}, documents_.at(document_id).status};
+        const uint64_t first_hash = HashWord(word, 0x3c6ef372fe94f82bULL);
+        const uint64_t second_hash = HashWord(word, 0xa54ff53a5f1d36f1ULL) | 1U;
+        for (size_t ii = 0; ii < hash_count; ++ii)
+        {
+            signature[ii] = std::min(signature[ii], MixHash(first_hash + ii * second_hash));
+        }
     }
 
-    vector<string_view> matched_words(document_to_word_freqs_.at(document_id).size());
+    return signature;
+}
 
-    transform(execution::par,
-              document_to_word_freqs_.at(document_id).begin(),
-              document_to_word_freqs_.at(document_id).end(),
-              matched_words.begin(),
-              [query](const auto& item)
+namespace
+{
+// Calls on_common for every word of the sorted query found in the sorted
+// document, until it returns true. Looks query words up one by one when
+// the query is much shorter than the document, otherwise merges both.
+template <typename Callback>
+void IntersectSorted(const std::vector<std::string_view> &query_words,
+                     const std::pmr::map<std::string_view, double> &document_words,
+                     Callback on_common)
+{
+    if (query_words.empty() || document_words.empty())
     {
-        return find(query.plus_words.begin(),
-                    query.plus_words.end(),
-                    item.first) != query.plus_words.end() ? item.first : "";
-    });
+        return;
+    }
 
-    sort(std::execution::par,
-         matched_words.begin(), matched_words.end());
+    size_t log_size = 1;
+    while ((size_t{1} << log_size) < document_words.size())
+    {
+        ++log_size;
+    }
 
-    auto start = upper_bound(matched_words.begin(), matched_words.end(), ""s);
+    if (query_words.size() * log_size < document_words.size())
+    {
+        for (const std::string_view word : query_words)
+        {
+            if (const auto it = document_words.find(word); it != document_words.end())
+            {
+                if (on_common(it->first))
+                {
+                    return;
+                }
+            }
+        }
+        return;
+    }
 
-    return {{std::make_move_iterator(start),
-                    std::make_move_iterator(matched_words.end())},
-        documents_.at(document_id).status};
+    auto query_it = query_words.begin();
+    auto document_it = document_words.begin();
+    while (query_it != query_words.end() && document_it != document_words.end())
+    {
+        if (*query_it < document_it->first)
+        {
+            ++query_it;
+        }
+        else if (document_it->first < *query_it)
+        {
+            ++document_it;
+        }
+        else
+        {
+            if (on_common(document_it->first))
+            {
+                return;
+            }
+            ++query_it;
+            ++document_it;
+        }
+    }
+}
 }
 
-std::tuple<std::vector<std::string_view>, DocumentStatus>
-SearchServer::MatchDocument(std::string_view raw_query,
-                            int document_id) const
+SearchServer::MatchResult SearchServer::MatchParsedQuery(const Query &query,
+                                                         int document_id) const
 {
-    return MatchDocument(std::execution::seq, raw_query, document_id);
+    std::vector<std::string_view> matched_words;
+    const DocumentStatus status = MatchParsedQuery(query, document_id, matched_words);
+    return {std::move(matched_words), status};
 }
 
-const std::map<std::string_view, double>
-&SearchServer::GetWordFrequencies(int document_id) const
+DocumentStatus SearchServer::MatchParsedQuery(const Query &query,
+                                              int document_id,
+                                              std::vector<std::string_view> &matched_words) const
 {
-    static std::map<std::string_view, double> result = {};
+    const DocumentStatus status = documents_.at(document_id).status;
+    matched_words.clear();
 
-    if (document_to_word_freqs_.count(document_id) != 0U)
+    const auto words = document_to_word_freqs_.find(document_id);
+    if (words == document_to_word_freqs_.end())
     {
-        result = document_to_word_freqs_.at(document_id);
+        return status;
     }
 
-    return result;
+    bool has_minus_word = false;
+    IntersectSorted(query.minus_words, words->second, [&has_minus_word](std::string_view)
+    {
+        has_minus_word = true;
+        return true;
+    });
+    if (has_minus_word || !MatchesPositions(query, document_id))
+    {
+        return status;
+    }
+
+    IntersectSorted(query.plus_words, words->second, [&matched_words](std::string_view word)
+    {
+        matched_words.push_back(word);
+        return false;
+    });
+
+    return status;
 }
 
-void SearchServer::RemoveDocument(const std::execution::sequenced_policy policy,
-                                  int document_id)
+namespace
+{
+// Map keys are views into the text of the document that brought the word in.
+// Once that document goes away the key has to borrow another document's text.
+template <typename Index>
+void RepointKey(Index &index, typename Index::iterator it, std::string_view key)
+{
+    auto node = index.extract(it);
+    node.key() = key;
+    index.insert(std::move(node));
+}
+}
+
+template <typename ExecutionPolicy>
+void SearchServer::EraseDocuments(ExecutionPolicy policy,
+                                  const std::vector<int> &document_ids)
 {
-    if (documents_.count(document_id) == 0U)
+    PROFILE_SCOPE("RemoveDocuments");
+    using namespace std;
+
+    vector<int> removed_ids;
+    removed_ids.reserve(document_ids.size());
+    for (const int document_id : document_ids)
     {
-        return;
+        if (documents_.count(document_id) != 0U)
+        {
+            removed_ids.push_back(document_id);
+        }
+    }
+    sort(removed_ids.begin(), removed_ids.end());
+    removed_ids.erase(unique(removed_ids.begin(), removed_ids.end()), removed_ids.end());
+
+    struct WordRemoval
+    {
+        // Points into a removed document, which is still alive here
+        string_view word;
+        size_t first = 0;
+        size_t last = 0;
+        decltype(word_to_document_freqs_)::iterator documents{};
+        decltype(word_to_impact_postings_)::iterator impact_postings{};
+        bool documents_key_removed = false;
+        bool impact_key_removed = false;
+    };
+
+    struct RemovedPosting
+    {
+        size_t removal = 0;
+        string_view word;
+        int document_id = 0;
+    };
+
+    // Hashing groups the postings by word without comparing words
+    // against each other or walking the dictionary once per posting
+    unordered_map<string_view, size_t> word_to_removal;
+    vector<WordRemoval> removals;
+    vector<RemovedPosting> collected;
+    for (const int document_id : removed_ids)
+    {
+        const auto words = document_to_word_freqs_.find(document_id);
+        if (words == document_to_word_freqs_.end())
+        {
+            continue;
+        }
+        for (const auto &[word, _] : words->second)
+        {
+            const auto [it, inserted] = word_to_removal.emplace(word, removals.size());
+            if (inserted)
+            {
+                removals.emplace_back().word = word;
+            }
+            ++removals[it->second].last;
+            collected.push_back({it->second, word, document_id});
+        }
+    }
+
+    size_t offset = 0;
+    for (WordRemoval &removal : removals)
+    {
+        removal.first = offset;
+        offset += removal.last;
+        removal.last = removal.first;
     }
 
-    const auto &items =
-            document_to_word_freqs_[document_id];
+    // A stable scatter keeps ids ascending inside every word
+    vector<RemovedPosting> postings(collected.size());
+    for (const RemovedPosting &posting : collected)
+    {
+        postings[removals[posting.removal].last++] = posting;
+    }
 
-    std::for_each(policy, items.begin(), items.end(),
-                  [this, document_id](const auto &word)
+    // Tasks only extract postings: the nodes are freed after the parallel
+    // part, so the memory resource is never used from several threads
+    using PostingNode = decltype(word_to_document_freqs_)::mapped_type::node_type;
+    vector<PostingNode> extracted(postings.size());
+
+    // Only lookups on the dictionaries, each word's postings belong to one task
+    for_each(policy, removals.begin(), removals.end(),
+             [this, &postings, &removed_ids, &extracted](WordRemoval &removal)
     {
-        word_to_document_freqs_[word.first].erase(document_id);
-        if (word_to_document_freqs_[word.first].empty())
+        const auto first = postings.begin() + removal.first;
+        const auto last = postings.begin() + removal.last;
+        const auto is_key_owner = [first, last](string_view key)
+        {
+            return any_of(first, last, [key](const RemovedPosting &posting)
+            {
+                return posting.word.data() == key.data();
+            });
+        };
+
+        removal.documents = word_to_document_freqs_.find(removal.word);
+        for (auto it = first; it != last; ++it)
+        {
+            extracted[it - postings.begin()] = removal.documents->second.extract(it->document_id);
+        }
+        removal.documents_key_removed = is_key_owner(removal.documents->first);
+
+        if (!impact_ordered_)
         {
-            word_to_document_freqs_.erase(word.first);
+            return;
         }
+        removal.impact_postings = word_to_impact_postings_.find(removal.word);
+        auto &impact = removal.impact_postings->second;
+        impact.erase(remove_if(impact.begin(), impact.end(),
+                               [&removed_ids](const pair<int, double> &posting)
+        {
+            return binary_search(removed_ids.begin(), removed_ids.end(), posting.first);
+        }), impact.end());
+        removal.impact_key_removed = is_key_owner(removal.impact_postings->first);
     });
 
-    documents_.erase(document_id);
-    document_ids_.erase(document_id);
-    document_to_word_freqs_.erase(document_id);
+    extracted.clear();
+
+    const auto surviving_key = [this](int document_id, string_view word)
+    {
+        return document_to_word_freqs_.at(document_id).find(word)->first;
+    };
+    for (const WordRemoval &removal : removals)
+    {
+        const auto documents = removal.documents;
+        const string_view word = removal.word;
+
+        if (documents->second.empty())
+        {
+            term_dictionary_.Erase(word);
+            word_to_document_freqs_.erase(documents);
+        }
+        else if (removal.documents_key_removed)
+        {
+            RepointKey(word_to_document_freqs_, documents,
+                       surviving_key(documents->second.begin()->first, word));
+        }
+
+        if (!impact_ordered_)
+        {
+            continue;
+        }
+        if (removal.impact_postings->second.empty())
+        {
+            word_to_impact_postings_.erase(removal.impact_postings);
+        }
+        else if (removal.impact_key_removed)
+        {
+            RepointKey(word_to_impact_postings_, removal.impact_postings,
+                       surviving_key(removal.impact_postings->second.front().first, word));
+        }
+    }
+
+    // All positions go before any text, as the positional keys of a word
+    // that only removed documents contain point into their texts
+    for (const int document_id : removed_ids)
+    {
+        RemovePositions(document_id);
+    }
+    for (const int document_id : removed_ids)
+    {
+        ForgetDocument(document_id);
+    }
 }
 
-void SearchServer::RemoveDocument(const std::execution::parallel_policy policy,
-                                  int document_id)
+void SearchServer::EraseDocument(int document_id)
 {
-    using namespace std;
-
-    auto it = document_ids_.find(document_id);
-    if (it == document_ids_.end())
+    const auto document = documents_.find(document_id);
+    if (document == documents_.end())
     {
         return;
     }
 
-    auto &items = document_to_word_freqs_.at(document_id);
-
-    vector<const string_view *> words(items.size());
-    transform(policy, items.begin(), items.end(), words.begin(),
-              [](const auto &word_doc)
+    const std::string_view text = document->second.text;
+    const auto is_removed_key = [text](std::string_view key)
     {
-        return &word_doc.first;
-    });
+        return key.data() >= text.data() && key.data() < text.data() + text.size();
+    };
+    const auto surviving_key = [this](int surviving_id, std::string_view word)
+    {
+        return document_to_word_freqs_.at(surviving_id).find(word)->first;
+    };
 
-    for_each(policy, words.begin(), words.end(),
-             [this, document_id](const auto *word)
+    for (const auto &[word, _] : document_to_word_freqs_.at(document_id))
     {
-        word_to_document_freqs_.at(*word).erase(document_id);
-        if (word_to_document_freqs_[*word].empty())
+        const auto documents = word_to_document_freqs_.find(word);
+        documents->second.erase(document_id);
+        if (documents->second.empty())
         {
-            word_to_document_freqs_.erase(*word);
+            term_dictionary_.Erase(word);
+            word_to_document_freqs_.erase(documents);
+        }
+        else if (is_removed_key(documents->first))
+        {
+            RepointKey(word_to_document_freqs_, documents,
+                       surviving_key(documents->second.begin()->first, word));
         }
-    });
 
-    document_ids_.erase(document_id);
-    documents_.erase(document_id);
-    document_to_word_freqs_.erase(document_id);
+        if (!impact_ordered_)
+        {
+            continue;
+        }
+        const auto impact_postings = word_to_impact_postings_.find(word);
+        auto &impact = impact_postings->second;
+        impact.erase(std::find_if(impact.begin(), impact.end(),
+                                  [document_id](const std::pair<int, double> &posting)
+        {
+            return posting.first == document_id;
+        }));
+        if (impact.empty())
+        {
+            word_to_impact_postings_.erase(impact_postings);
+        }
+        else if (is_removed_key(impact_postings->first))
+        {
+            RepointKey(word_to_impact_postings_, impact_postings,
+                       surviving_key(impact.front().first, word));
+        }
+    }
+
+    RemovePositions(document_id);
+    ForgetDocument(document_id);
 }
 
-void SearchServer::RemoveDocument(int document_id)
+void SearchServer::ForgetDocument(int document_id)
 {
-    RemoveDocument(std::execution::seq, document_id);
+    const auto &fingerprint = documents_.at(document_id).fingerprint;
+    auto same_fingerprint = fingerprint_to_documents_.find(fingerprint);
+    same_fingerprint->second.erase(document_id);
+    if (same_fingerprint->second.empty())
+    {
+        fingerprint_to_documents_.erase(same_fingerprint);
+    }
+
+    posting_count_ -= document_to_word_freqs_.at(document_id).size();
+    documents_.erase(document_id);
+    document_ids_.erase(document_id);
+    document_to_word_freqs_.erase(document_id);
+    ++generation_;
 }
 
 void SearchServer::RemoveWordDuplecates(std::vector<std::string_view> &sourse)
@@ -295,7 +945,7 @@ void SearchServer::RemoveWordDuplecates(std::vector<std::string_view> &sourse)
 
 bool SearchServer::IsStopWord(std::string_view word) const
 {
-    return stop_words_.count(word) > 0;
+    return stop_words_.Contains(word);
 }
 
 bool SearchServer::IsValidWord(std::string_view word)
@@ -360,12 +1010,148 @@ int SearchServer::ComputeAverageRating(const std::vector<int>& ratings)
 }
 
 // Existence required
-double SearchServer::ComputeWordInverseDocumentFreq(std::string_view word) const
+double SearchServer::ComputeWordInverseDocumentFreq(std::string_view word,
+                                                    const CorpusStatistics *statistics) const
 {
+    if (statistics != nullptr)
+    {
+        const auto document_freq = statistics->document_freqs.find(word);
+        if (document_freq != statistics->document_freqs.end() && document_freq->second > 0)
+        {
+            return log(statistics->document_count * 1.0 / document_freq->second);
+        }
+    }
     return log(GetDocumentCount() * 1.0 /
                word_to_document_freqs_.at(word).size());
 }
 
+ThreadPool &SearchServer::GetThreadPool() const
+{
+    std::lock_guard guard(thread_pool_mutex_);
+    if (!thread_pool_)
+    {
+        thread_pool_ = std::make_unique<ThreadPool>();
+    }
+    return *thread_pool_;
+}
+
+bool SearchServer::IsMoreRelevant(const Document &lhs, const Document &rhs)
+{
+    if (std::abs(lhs.relevance - rhs.relevance) < EPSILON)
+    {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.relevance > rhs.relevance;
+}
+
+bool SearchServer::IsRankedBefore(const Document &lhs, const Document &rhs)
+{
+    // Exact, unlike IsMoreRelevant: a tolerance is not transitive, and the
+    // cursor keeps the exact relevance anyway
+    if (lhs.relevance != rhs.relevance)
+    {
+        return lhs.relevance > rhs.relevance;
+    }
+    if (lhs.rating != rhs.rating)
+    {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.id < rhs.id;
+}
+
+namespace
+{
+bool IsHigherImpact(const std::pair<int, double> &lhs,
+                    const std::pair<int, double> &rhs)
+{
+    if (lhs.second != rhs.second)
+    {
+        return lhs.second > rhs.second;
+    }
+    return lhs.first < rhs.first;
+}
+}
+
+void SearchServer::AddImpactPostings(int document_id)
+{
+    if (document_to_word_freqs_.count(document_id) == 0U)
+    {
+        return;
+    }
+
+    for (const auto &[word, term_freq] : document_to_word_freqs_.at(document_id))
+    {
+        auto &postings = word_to_impact_postings_[word];
+        const std::pair<int, double> posting{document_id, term_freq};
+        postings.insert(std::upper_bound(postings.begin(), postings.end(),
+                                         posting, IsHigherImpact),
+                        posting);
+    }
+}
+
+void SearchServer::AddPositions(int document_id)
+{
+    // Stop words are not stored but still take up a position
+    std::map<std::string_view, std::vector<uint32_t>> word_positions;
+    uint32_t position = 0;
+    for (const std::string_view word : SplitIntoWords(std::string_view{documents_.at(document_id).text}))
+    {
+        if (!IsStopWord(word))
+        {
+            word_positions[word].push_back(position);
+        }
+        ++position;
+    }
+    positional_index_.AddDocument(document_id, word_positions);
+}
+
+void SearchServer::RemovePositions(int document_id)
+{
+    if (!positional_)
+    {
+        return;
+    }
+
+    for (const auto &[word, _] : document_to_word_freqs_.at(document_id))
+    {
+        // The inverted index already holds the view of a surviving document
+        const auto documents = word_to_document_freqs_.find(word);
+        positional_index_.RemovePosting(word, document_id,
+                                        documents == word_to_document_freqs_.end() ?
+                                        std::string_view{} : documents->first);
+    }
+}
+
+bool SearchServer::MatchesPositions(const Query &query, int document_id) const
+{
+    return std::all_of(query.phrases.begin(), query.phrases.end(),
+                       [this, document_id](const auto &phrase)
+    {
+        return positional_index_.ContainsPhrase(document_id, phrase);
+    }) &&
+    std::all_of(query.proximities.begin(), query.proximities.end(),
+                [this, document_id](const Proximity &proximity)
+    {
+        return positional_index_.ContainsNear(document_id, proximity.lhs,
+                                              proximity.rhs, proximity.distance);
+    });
+}
+
+void SearchServer::RemovePositionalMismatches(const Query &query,
+                                              std::map<int, double> &document_to_relevance) const
+{
+    if (query.phrases.empty() && query.proximities.empty())
+    {
+        return;
+    }
+
+    PROFILE_SCOPE("MatchPositions");
+    for (auto it = document_to_relevance.begin(); it != document_to_relevance.end();)
+    {
+        it = MatchesPositions(query, it->first) ? std::next(it) : document_to_relevance.erase(it);
+    }
+}
+
 SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) const
 {
     using namespace std::literals::string_literals;
@@ -391,38 +1177,263 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) cons
     return {word, is_minus, IsStopWord(word)};
 }
 
-SearchServer::Query SearchServer::ParseQuery(std::string_view text,
-                                             bool need_remove_duplecates) const
+namespace
 {
-    using namespace std;
+constexpr std::string_view NEAR_OPERATOR = "NEAR/";
 
-    if (text.empty())
+bool IsNearOperator(std::string_view token)
+{
+    return token.substr(0, NEAR_OPERATOR.size()) == NEAR_OPERATOR;
+}
+
+uint32_t ParseNearDistance(std::string_view token)
+{
+    using namespace std::literals::string_literals;
+    const auto digits = token.substr(NEAR_OPERATOR.size());
+    uint32_t distance = 0;
+    const auto [end, error] = std::from_chars(digits.data(), digits.data() + digits.size(),
+                                              distance);
+    if (digits.empty() || error != std::errc{} || end != digits.data() + digits.size())
+    {
+        throw std::invalid_argument("Operator "s + std::string{token} + " is invalid"s);
+    }
+    return distance;
+}
+
+// Appends the max_count expansions found in the most documents, the
+// smaller word first among equally frequent ones
+void AppendMostFrequent(std::vector<std::pair<size_t, std::string_view>> &expansions,
+                        size_t max_count,
+                        std::vector<std::string_view> &words)
+{
+    if (expansions.size() > max_count)
+    {
+        std::nth_element(expansions.begin(), expansions.begin() + max_count, expansions.end(),
+                         [](const auto &lhs, const auto &rhs)
+        {
+            return lhs.first != rhs.first ? lhs.first > rhs.first : lhs.second < rhs.second;
+        });
+        expansions.resize(max_count);
+    }
+
+    for (const auto &[document_freq, word] : expansions)
+    {
+        words.push_back(word);
+    }
+}
+}
+
+void SearchServer::ExpandPrefix(std::string_view prefix,
+                                size_t max_count,
+                                std::vector<std::string_view> &words) const
+{
+    // The index key outlives the dictionary's view of the word
+    std::vector<std::pair<size_t, std::string_view>> expansions;
+    term_dictionary_.ForEachWithPrefix(prefix, [this, &expansions](std::string_view word)
+    {
+        const auto postings = word_to_document_freqs_.find(word);
+        expansions.emplace_back(postings->second.size(), postings->first);
+    });
+    AppendMostFrequent(expansions, max_count, words);
+}
+
+void SearchServer::ExpandPrefix(const CorpusStatistics &statistics,
+                                std::string_view prefix,
+                                size_t max_count,
+                                std::vector<std::string_view> &words)
+{
+    std::vector<std::pair<size_t, std::string_view>> expansions;
+    for (auto it = statistics.document_freqs.lower_bound(prefix);
+         it != statistics.document_freqs.end() &&
+         std::string_view{it->first}.substr(0, prefix.size()) == prefix;
+         ++it)
     {
-        return Query{};
+        if (it->second > 0)
+        {
+            expansions.emplace_back(it->second, it->first);
+        }
     }
+    AppendMostFrequent(expansions, max_count, words);
+}
 
+SearchServer::Query SearchServer::ParseQuery(std::string_view text,
+                                             bool need_remove_duplecates) const
+{
+    std::vector<std::string_view> tokens;
     Query result;
+    ParseQuery(text, need_remove_duplecates, tokens, result);
+    return result;
+}
 
-    for (const auto& word : SplitIntoWords(text))
+void SearchServer::ParseQuery(std::string_view text,
+                              bool need_remove_duplecates,
+                              std::vector<std::string_view> &tokens,
+                              Query &result,
+                              const CorpusStatistics *statistics) const
+{
+    PROFILE_SCOPE("ParseQuery");
+    using namespace std;
+
+    result.plus_words.clear();
+    result.minus_words.clear();
+    result.plus_prefixes.clear();
+    result.phrases.clear();
+    result.proximities.clear();
+    SplitIntoWords(text, tokens);
+
+    // A phrase is open from a token starting with a quote to one ending with it
+    bool in_phrase = false;
+    uint32_t phrase_position = 0;
+    // Operand of a pending NEAR/k, empty for a stop word
+    optional<string_view> near_lhs;
+    uint32_t near_distance = 0;
+    // The previous token was a plain word that may start NEAR/k
+    optional<string_view> previous_word;
+
+    for (auto token : tokens)
     {
-        const auto query_word = ParseQueryWord(word);
-        if (!query_word.is_stop)
+        if (!in_phrase && IsNearOperator(token))
+        {
+            if (!previous_word || near_lhs)
+            {
+                throw invalid_argument("Operator "s + string{token} + " needs a word on each side"s);
+            }
+            near_lhs = previous_word;
+            near_distance = ParseNearDistance(token);
+            previous_word.reset();
+            continue;
+        }
+
+        const bool opens_phrase = !in_phrase && token.front() == '"';
+        if (opens_phrase)
         {
-            if (query_word.is_minus)
+            token.remove_prefix(1);
+            in_phrase = true;
+            phrase_position = 0;
+            result.phrases.emplace_back();
+        }
+        const bool closes_phrase = in_phrase && !token.empty() && token.back() == '"';
+        if (closes_phrase)
+        {
+            token.remove_suffix(1);
+        }
+
+        if (in_phrase)
+        {
+            if (near_lhs)
+            {
+                throw invalid_argument("NEAR/k needs a plain word on each side"s);
+            }
+            previous_word.reset();
+            if (!token.empty())
+            {
+                const auto query_word = ParseQueryWord(token);
+                if (query_word.is_minus || query_word.data.back() == '*')
+                {
+                    throw invalid_argument("Phrase word "s + string{token} + " is invalid"s);
+                }
+                if (!query_word.is_stop)
+                {
+                    result.phrases.back().push_back({query_word.data, phrase_position});
+                    result.plus_words.emplace_back(query_word.data);
+                }
+                ++phrase_position;
+            }
+            if (closes_phrase)
+            {
+                in_phrase = false;
+            }
+            continue;
+        }
+
+        const auto query_word = ParseQueryWord(token);
+        const bool is_prefix = query_word.data.back() == '*';
+        if (query_word.is_minus || is_prefix)
+        {
+            if (near_lhs)
+            {
+                throw invalid_argument("NEAR/k needs a plain word on each side"s);
+            }
+            previous_word.reset();
+            if (is_prefix)
+            {
+                const auto prefix = query_word.data.substr(0, query_word.data.size() - 1U);
+                if (prefix.empty())
+                {
+                    throw invalid_argument("Query word "s + string{token} + " is invalid"s);
+                }
+                if (query_word.is_minus)
+                {
+                    // Every expansion of a minus prefix has to go, or it
+                    // would let documents through
+                    ExpandPrefix(prefix, numeric_limits<size_t>::max(), result.minus_words);
+                }
+                else if (statistics != nullptr && statistics->prefixes.count(prefix) != 0U)
+                {
+                    result.plus_prefixes.push_back(prefix);
+                    ExpandPrefix(*statistics, prefix, MAX_PREFIX_EXPANSION_COUNT,
+                                 result.plus_words);
+                }
+                else
+                {
+                    result.plus_prefixes.push_back(prefix);
+                    ExpandPrefix(prefix, MAX_PREFIX_EXPANSION_COUNT, result.plus_words);
+                }
+            }
+            else if (!query_word.is_stop)
             {
                 result.minus_words.emplace_back(query_word.data);
-                continue;
             }
+            continue;
+        }
 
-            result.plus_words.emplace_back(query_word.data);
+        const string_view word = query_word.is_stop ? string_view{} : query_word.data;
+        if (near_lhs)
+        {
+            // A stop word has no positions, so the proximity is dropped like the word
+            if (!near_lhs->empty() && !word.empty())
+            {
+                result.proximities.push_back({*near_lhs, word, near_distance});
+            }
+            near_lhs.reset();
+        }
+        previous_word = word;
+        if (!word.empty())
+        {
+            result.plus_words.emplace_back(word);
         }
     }
 
+    if (in_phrase)
+    {
+        throw invalid_argument("Phrase is not closed"s);
+    }
+    if (near_lhs)
+    {
+        throw invalid_argument("NEAR/k needs a word on each side"s);
+    }
+
+    result.phrases.erase(remove_if(result.phrases.begin(), result.phrases.end(),
+                                   [](const auto &phrase)
+    {
+        return phrase.empty();
+    }), result.phrases.end());
+    for (auto &phrase : result.phrases)
+    {
+        const uint32_t first_position = phrase.front().offset;
+        for (auto &term : phrase)
+        {
+            term.offset -= first_position;
+        }
+    }
+    if (!positional_ && (!result.phrases.empty() || !result.proximities.empty()))
+    {
+        throw invalid_argument("Phrase and NEAR/k queries need the positional index"s);
+    }
+
     if (need_remove_duplecates)
     {
         RemoveWordDuplecates(result.plus_words);
         RemoveWordDuplecates(result.minus_words);
     }
-
-    return result;
 }
@@ -1,24 +1,85 @@
 #pragma once
 #include <algorithm>
 #include <execution>
+#include <chrono>
 #include <functional>
+#include <future>
+#include <memory_resource>
+#include <memory>
+#include <mutex>
+#include <numeric>
 #include <set>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define SEARCH_SERVER_HAS_COROUTINES 1
+#endif
+
 #include "concurrent_map.h"
+#include "corpus_statistics.h"
+#include "counting_memory_resource.h"
 #include "document.h"
+#include "document_filter.h"
+#include "document_fingerprint.h"
+#include "iterator_range.h"
+#include "memory_stats.h"
+#include "positional_index.h"
+#include "profiler.h"
+#include "query_control.h"
+#include "search_budget.h"
+#include "search_cursor.h"
+#include "stop_word_set.h"
 #include "string_processing.h"
+#include "term_dictionary.h"
+#include "thread_pool.h"
 
+enum class DuplicatePolicy
+{
+    ALLOW,
+    // Duplicates are added and reported by IsFlaggedDuplicate
+    FLAG,
+    // AddDocument throws std::invalid_argument for a duplicate
+    REJECT,
+};
+
+// Neither copyable nor movable: the dictionaries hold views into the
+// document texts, and queued asynchronous queries hold a pointer to the
+// server. Several servers are kept behind std::unique_ptr, as in
+// ShardedSearchServer.
 class SearchServer {
 public:
 
-    explicit SearchServer(const std::string& stop_words_text);
+    // View of a document's entry in the forward index, valid until the
+    // document is removed
+    using WordFrequencies =
+    IteratorRange<std::pmr::map<std::string_view, double>::const_iterator>;
+
+    // Every index container and the document texts allocate from resource,
+    // which must outlive the server. Only the thread changing the server
+    // allocates and frees, even in the parallel RemoveDocuments, so the
+    // resource need not be thread-safe.
+    explicit SearchServer(const std::string& stop_words_text,
+                          std::pmr::memory_resource *resource = std::pmr::get_default_resource());
 
     template <typename stringContainer>
-    explicit SearchServer(const stringContainer& stop_words);
+    explicit SearchServer(const stringContainer& stop_words,
+                          std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+    // Stop words hashed at compile time, see MakeStopWordTable
+    template <size_t N>
+    explicit SearchServer(const StaticStopWordTable<N> &stop_words,
+                          std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+    SearchServer(const SearchServer &other) = delete;
+
+    SearchServer &operator=(const SearchServer &other) = delete;
+
+    std::pmr::memory_resource *GetMemoryResource() const;
 
     void AddDocument(int document_id,
                      const std::string_view document,
@@ -57,11 +118,130 @@ public:
 
     std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
 
+    // Buffers reused by the queries of one thread
+    class QueryContext;
+
+    // Like FindTopDocuments, but every buffer lives in the context: once it
+    // has grown to fit, a query of plain and minus words makes no heap
+    // allocations. The result is valid until the context is used again.
+    template <typename DocumentPredicate>
+    const std::vector<Document> &FindTopDocuments(QueryContext &context,
+                                                  std::string_view raw_query,
+                                                  DocumentPredicate document_predicate) const;
+
+    const std::vector<Document> &FindTopDocuments(QueryContext &context,
+                                                  std::string_view raw_query,
+                                                  DocumentStatus status) const;
+
+    const std::vector<Document> &FindTopDocuments(QueryContext &context,
+                                                  std::string_view raw_query) const;
+
+    // Scores the highest-impact posting segments first and stops when
+    // the budget runs out, so the result may be approximate
+    template <typename DocumentPredicate>
+    BudgetedSearchResult FindTopDocuments(std::string_view raw_query,
+                                          const SearchBudget &budget,
+                                          DocumentPredicate document_predicate) const;
+
+    BudgetedSearchResult FindTopDocuments(std::string_view raw_query,
+                                          const SearchBudget &budget) const;
+
+    // Ranks with the given statistics instead of this server's own,
+    // when the server holds one part of a larger corpus
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query,
+                                           const CorpusStatistics &statistics,
+                                           DocumentPredicate document_predicate) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query,
+                                           const CorpusStatistics &statistics,
+                                           DocumentStatus status) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query,
+                                           const CorpusStatistics &statistics) const;
+
+    // Document count and frequencies of the query's plus words,
+    // to be merged across the servers sharing a corpus
+    CorpusStatistics CollectQueryStatistics(std::string_view raw_query) const;
+
+    // Combines the top documents found by servers holding parts of one corpus
+    static std::vector<Document> MergeTopDocuments(const std::vector<std::vector<Document>> &results);
+
+    // The page_size results following the cursor, ranked like
+    // FindTopDocuments but without its cap, and with relevance compared
+    // exactly instead of within EPSILON. Every page scores the query
+    // again, then selects its documents past the cursor without sorting the
+    // rest. Throws StaleCursorError if documents were added or removed since
+    // the cursor was issued, std::invalid_argument if it is another query's.
+    template <typename DocumentPredicate>
+    SearchPage FindPage(std::string_view raw_query,
+                        const SearchCursor &cursor,
+                        size_t page_size,
+                        DocumentPredicate document_predicate) const;
+
+    SearchPage FindPage(std::string_view raw_query,
+                        const SearchCursor &cursor,
+                        size_t page_size,
+                        DocumentStatus status) const;
+
+    SearchPage FindPage(std::string_view raw_query,
+                        const SearchCursor &cursor,
+                        size_t page_size) const;
+
+    // Changes whenever a document is added or removed
+    uint64_t GetGeneration() const;
+
+    // Bytes held by each index structure and the sizes of the index,
+    // read from counters kept up to date by every change
+    MemoryStats GetMemoryStats() const;
+
+    // Keeps an extra copy of every posting list sorted by term frequency,
+    // used by the budgeted FindTopDocuments
+    void EnableImpactOrderedPostings();
+
+    bool HasImpactOrderedPostings() const;
+
+    // Records word positions, so queries may contain "quoted phrases" and
+    // word NEAR/k word. Without it such queries throw std::invalid_argument.
+    void EnablePositionalIndex();
+
+    bool HasPositionalIndex() const;
+
+    // Runs the query on the internal thread pool. The future rethrows
+    // QueryCancelled or QueryDeadlineExceeded if the query was abandoned.
+    template <typename DocumentPredicate>
+    std::future<std::vector<Document>> SubmitQuery(std::string raw_query,
+                                                   DocumentPredicate document_predicate,
+                                                   QueryOptions options = {}) const;
+
+    std::future<std::vector<Document>> SubmitQuery(std::string raw_query,
+                                                   DocumentStatus status,
+                                                   QueryOptions options = {}) const;
+
+    std::future<std::vector<Document>> SubmitQuery(std::string raw_query,
+                                                   QueryOptions options = {}) const;
+
+#ifdef SEARCH_SERVER_HAS_COROUTINES
+    class QueryAwaitable;
+
+    template <typename DocumentPredicate>
+    QueryAwaitable AwaitQuery(std::string raw_query,
+                              DocumentPredicate document_predicate,
+                              QueryOptions options = {}) const;
+
+    QueryAwaitable AwaitQuery(std::string raw_query,
+                              QueryOptions options = {}) const;
+#endif
+
     int GetDocumentCount() const;
 
-    std::set<int>::iterator begin();
+    std::pmr::set<int>::iterator begin();
+
+    std::pmr::set<int>::iterator end();
+
+    std::pmr::set<int>::const_iterator begin() const;
 
-    std::set<int>::iterator end();
+    std::pmr::set<int>::const_iterator end() const;
 
     std::tuple<std::vector<std::string_view>, DocumentStatus>
     MatchDocument(std::execution::sequenced_policy,
@@ -77,7 +257,30 @@ public:
     MatchDocument(std::string_view raw_query,
                   int document_id) const;
 
-    const std::map<std::string_view, double> &GetWordFrequencies(int document_id) const;
+    using MatchResult = std::tuple<std::vector<std::string_view>, DocumentStatus>;
+
+    // Parses the query once and matches it against every document.
+    // Throws std::out_of_range if any id is unknown.
+    std::vector<MatchResult> MatchDocuments(std::execution::sequenced_policy,
+                                            std::string_view raw_query,
+                                            const std::vector<int> &document_ids) const;
+
+    std::vector<MatchResult> MatchDocuments(std::execution::parallel_policy,
+                                            std::string_view raw_query,
+                                            const std::vector<int> &document_ids) const;
+
+    std::vector<MatchResult> MatchDocuments(std::string_view raw_query,
+                                            const std::vector<int> &document_ids) const;
+
+    // The words are valid until the context is used again
+    std::tuple<const std::vector<std::string_view>&, DocumentStatus>
+    MatchDocument(QueryContext &context,
+                  std::string_view raw_query,
+                  int document_id) const;
+
+    // Empty for an unknown document_id. Safe to call concurrently with
+    // other const methods.
+    WordFrequencies GetWordFrequencies(int document_id) const;
 
     void RemoveDocument(const std::execution::sequenced_policy policy,
                         int document_id);
@@ -87,25 +290,97 @@ public:
 
     void RemoveDocument(int document_id);
 
+    // Removes several documents at once, unknown ids are ignored. Postings are
+    // grouped by word, so the parallel version updates each word from one
+    // thread and only touches the shared dictionaries afterwards.
+    void RemoveDocuments(std::execution::sequenced_policy policy,
+                         const std::vector<int> &document_ids);
+
+    void RemoveDocuments(std::execution::parallel_policy policy,
+                         const std::vector<int> &document_ids);
+
+    void RemoveDocuments(const std::vector<int> &document_ids);
+
     static void RemoveWordDuplecates(std::vector<std::string_view> &sourse);
 
+    // A duplicate has the same set of words as a document with a smaller id
+    void SetDuplicatePolicy(DuplicatePolicy policy);
+
+    // True under DuplicatePolicy::FLAG for a duplicate, by the same rule as
+    // FindDuplicates: of the documents with one set of words, all but the
+    // smallest id are flagged, whichever arrived first. Removing the
+    // smallest one unflags the next.
+    bool IsFlaggedDuplicate(int document_id) const;
+
+    // Ids of all duplicates in ascending order, found via the fingerprint index
+    std::vector<int> FindDuplicates(std::execution::sequenced_policy) const;
+
+    std::vector<int> FindDuplicates(std::execution::parallel_policy) const;
+
+    std::vector<int> FindDuplicates() const;
+
+    // Minimum of each of hash_count word hash functions over the document's
+    // word set; the fraction of equal positions estimates Jaccard similarity
+    std::vector<uint64_t> ComputeMinHashSignature(int document_id,
+                                                  size_t hash_count) const;
+
 private:
-    const double EPSILON = 1e-6;
-    const size_t MAX_RESULT_DOCUMENT_COUNT = 5;
+    static constexpr double EPSILON = 1e-6;
+    static constexpr size_t MAX_RESULT_DOCUMENT_COUNT = 5;
+    // A plus word* keeps only its most frequent expansions
+    static constexpr size_t MAX_PREFIX_EXPANSION_COUNT = 64;
+    static constexpr size_t IMPACT_SEGMENT_SIZE = 64;
 
     struct DocumentData
     {
         int rating;
         DocumentStatus status;
-        std::string text;
-        std::set<std::string_view> view;
+        std::pmr::string text;
+        std::pmr::set<std::string_view> view;
+        DocumentFingerprint fingerprint;
     };
 
-    const std::set<std::string, std::less<>> stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, std::map<std::string_view, double>> document_to_word_freqs_;
-    std::map<int, DocumentData> documents_;
-    std::set<int> document_ids_;
+    const StopWordSet stop_words_;
+    // Declared before the containers, which are initialized with it;
+    // nested containers get it through uses-allocator construction
+    std::pmr::memory_resource *const resource_;
+    // Every structure allocates through its own counter, for GetMemoryStats
+    CountingMemoryResource inverted_index_memory_{resource_};
+    CountingMemoryResource term_dictionary_memory_{resource_};
+    CountingMemoryResource forward_index_memory_{resource_};
+    CountingMemoryResource documents_memory_{resource_};
+    CountingMemoryResource document_texts_memory_{resource_};
+    CountingMemoryResource document_words_memory_{resource_};
+    CountingMemoryResource impact_postings_memory_{resource_};
+    CountingMemoryResource positions_memory_{resource_};
+    CountingMemoryResource duplicates_memory_{resource_};
+
+    std::pmr::map<std::string_view, std::pmr::map<int, double>>
+    word_to_document_freqs_{&inverted_index_memory_};
+    // The words of word_to_document_freqs_, compact, for prefix expansion
+    TermDictionary term_dictionary_{&term_dictionary_memory_};
+    std::pmr::map<int, std::pmr::map<std::string_view, double>>
+    document_to_word_freqs_{&forward_index_memory_};
+    std::pmr::map<int, DocumentData> documents_{&documents_memory_};
+    std::pmr::set<int> document_ids_{&documents_memory_};
+    size_t posting_count_ = 0;
+    uint64_t generation_ = 0;
+
+    bool impact_ordered_ = false;
+    // Postings sorted by descending term frequency, then by id
+    std::pmr::map<std::string_view, std::pmr::vector<std::pair<int, double>>>
+    word_to_impact_postings_{&impact_postings_memory_};
+
+    bool positional_ = false;
+    PositionalIndex positional_index_{&positions_memory_};
+
+    DuplicatePolicy duplicate_policy_ = DuplicatePolicy::ALLOW;
+    std::pmr::unordered_map<DocumentFingerprint, std::pmr::set<int>, DocumentFingerprintHasher>
+    fingerprint_to_documents_{&duplicates_memory_};
+
+    // Declared last: destroyed first, so queued queries never outlive the index
+    mutable std::mutex thread_pool_mutex_;
+    mutable std::unique_ptr<ThreadPool> thread_pool_;
 
     struct QueryWord
     {
@@ -114,10 +389,22 @@ private:
         bool is_stop;
     };
 
+    struct Proximity
+    {
+        std::string_view lhs;
+        std::string_view rhs;
+        uint32_t distance;
+    };
+
     struct Query
     {
         std::vector<std::string_view> plus_words;
         std::vector<std::string_view> minus_words;
+        // Plus word* without the asterisk, already expanded into plus_words
+        std::vector<std::string_view> plus_prefixes;
+        // Every phrase and proximity must hold; their words are plus words too
+        std::vector<std::vector<PositionalIndex::PhraseTerm>> phrases;
+        std::vector<Proximity> proximities;
     };
 
 private:
@@ -136,27 +423,154 @@ private:
     Query ParseQuery(std::string_view text,
                      bool need_remove_duplecates = false) const;
 
-    // Existence required
-    double ComputeWordInverseDocumentFreq(std::string_view word) const;
+    // Reuses the capacity of tokens and of the vectors in result. Plus
+    // prefixes known to statistics are expanded from them.
+    void ParseQuery(std::string_view text,
+                    bool need_remove_duplecates,
+                    std::vector<std::string_view> &tokens,
+                    Query &result,
+                    const CorpusStatistics *statistics = nullptr) const;
+
+    // Appends up to max_count indexed words starting with prefix,
+    // the ones found in the most documents first
+    void ExpandPrefix(std::string_view prefix,
+                      size_t max_count,
+                      std::vector<std::string_view> &words) const;
+
+    // The same over the words of statistics, for a corpus split between servers
+    static void ExpandPrefix(const CorpusStatistics &statistics,
+                             std::string_view prefix,
+                             size_t max_count,
+                             std::vector<std::string_view> &words);
+
+    // Existence required. Uses statistics if they know the word.
+    double ComputeWordInverseDocumentFreq(std::string_view word,
+                                          const CorpusStatistics *statistics = nullptr) const;
+
+    ThreadPool &GetThreadPool() const;
+
+    static bool IsMoreRelevant(const Document &lhs, const Document &rhs);
+
+    // Strict total order by exact relevance, rating and id, so a cursor
+    // has one position
+    static bool IsRankedBefore(const Document &lhs, const Document &rhs);
+
+    // query must be parsed with duplicates removed, so its words are sorted
+    MatchResult MatchParsedQuery(const Query &query, int document_id) const;
+
+    DocumentStatus MatchParsedQuery(const Query &query,
+                                    int document_id,
+                                    std::vector<std::string_view> &matched_words) const;
 
+    template <typename ExecutionPolicy>
+    std::vector<MatchResult> MatchParsedQuery(ExecutionPolicy policy,
+                                              std::string_view raw_query,
+                                              const std::vector<int> &document_ids) const;
+
+    template <typename ExecutionPolicy>
+    void EraseDocuments(ExecutionPolicy policy, const std::vector<int> &document_ids);
+
+    // One document needs none of the grouping of EraseDocuments
+    void EraseDocument(int document_id);
+
+    // Drops everything but the inverted, impact-ordered and positional
+    // indexes, which EraseDocuments and EraseDocument clean up themselves
+    void ForgetDocument(int document_id);
+
+    template <typename ExecutionPolicy>
+    std::vector<int> CollectDuplicates(ExecutionPolicy policy) const;
+
+    void AddImpactPostings(int document_id);
+
+    void AddPositions(int document_id);
+
+    // Once the inverted index no longer refers to the document
+    void RemovePositions(int document_id);
+
+    bool MatchesPositions(const Query &query, int document_id) const;
+
+    void RemovePositionalMismatches(const Query &query,
+                                    std::map<int, double> &document_to_relevance) const;
+
+    // Loads the document only for a predicate that looks past the id
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(std::execution::sequenced_policy /*unused*/,
-                                           const Query& query,
-                                           DocumentPredicate document_predicate) const;
+    bool AcceptsDocument(const DocumentPredicate &document_predicate, int document_id) const;
+
+    template <typename PostingIterator>
+    struct PostingCursor
+    {
+        PostingIterator next;
+        PostingIterator end;
+        double inverse_document_freq;
+        double bound;
+    };
+
+    template <typename PostingIterator, typename DocumentPredicate>
+    BudgetedSearchResult
+    FindBudgetedDocuments(const Query &query,
+                          std::vector<PostingCursor<PostingIterator>> cursors,
+                          const SearchBudget &budget,
+                          std::chrono::steady_clock::time_point start_time,
+                          DocumentPredicate document_predicate) const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> RunQuery(std::string_view raw_query,
+                                   DocumentPredicate document_predicate,
+                                   const QueryControl &control,
+                                   const CorpusStatistics *statistics = nullptr) const;
+
+    template <typename DocumentPredicate>
+    const std::vector<Document> &RunQuery(QueryContext &context,
+                                          std::string_view raw_query,
+                                          DocumentPredicate document_predicate,
+                                          const QueryControl &control,
+                                          const CorpusStatistics *statistics = nullptr) const;
+
+    // Fills context with the unsorted matches of the query parsed into it
+    template <typename DocumentPredicate>
+    void FindAllDocuments(QueryContext &context,
+                          DocumentPredicate document_predicate,
+                          const QueryControl &control,
+                          const CorpusStatistics *statistics) const;
 
     template <typename DocumentPredicate>
     std::vector<Document> FindAllDocuments(std::execution::parallel_policy /*unused*/,
                                            const Query& query,
                                            DocumentPredicate document_predicate) const;
+};
 
-    template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const Query& query /*unused*/,
-                                           DocumentPredicate document_predicate) const;
+class SearchServer::QueryContext
+{
+private:
+    friend class SearchServer;
+
+    std::vector<std::string_view> tokens_;
+    Query query_;
+    // Scored postings of the plus words, summed per document after sorting
+    std::vector<std::pair<int, double>> postings_;
+    std::vector<const std::pmr::map<int, double>*> minus_postings_;
+    std::vector<Document> documents_;
+    std::vector<std::string_view> matched_words_;
 };
 
 template <typename stringContainer>
-SearchServer::SearchServer(const stringContainer &stop_words)
-    : stop_words_(MakeUniqueNonEmptyStrings(stop_words))
+SearchServer::SearchServer(const stringContainer &stop_words,
+                           std::pmr::memory_resource *resource)
+    : stop_words_(MakeUniqueNonEmptyStrings(stop_words)),
+      resource_(resource)
+{
+    using namespace std::literals::string_literals;
+    if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord))
+    {
+        throw std::invalid_argument("Some of stop words are invalid"s);
+    }
+}
+
+template <size_t N>
+SearchServer::SearchServer(const StaticStopWordTable<N> &stop_words,
+                           std::pmr::memory_resource *resource)
+    : stop_words_(stop_words),
+      resource_(resource)
 {
     using namespace std::literals::string_literals;
     if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord))
@@ -171,49 +585,138 @@ SearchServer::FindTopDocuments(std::execution::sequenced_policy /*unused*/,
                                std::string_view raw_query,
                                DocumentPredicate document_predicate) const
 {
-    const auto query = ParseQuery(raw_query, true);
+    return RunQuery(raw_query, document_predicate, QueryControl{});
+}
 
-    auto matched_documents = FindAllDocuments(query, document_predicate);
+template<typename DocumentPredicate>
+std::vector<Document>
+SearchServer::RunQuery(std::string_view raw_query,
+                       DocumentPredicate document_predicate,
+                       const QueryControl &control,
+                       const CorpusStatistics *statistics) const
+{
+    QueryContext context;
+    RunQuery(context, raw_query, document_predicate, control, statistics);
+    return std::move(context.documents_);
+}
 
-    sort(matched_documents.begin(), matched_documents.end(),
-         [this](const Document& lhs, const Document& rhs)
+template <typename DocumentPredicate>
+SearchPage SearchServer::FindPage(std::string_view raw_query,
+                                  const SearchCursor &cursor,
+                                  size_t page_size,
+                                  DocumentPredicate document_predicate) const
+{
+    PROFILE_SCOPE("FindPage");
+    using namespace std::literals::string_literals;
+    if (page_size == 0U)
     {
-        if (std::abs(lhs.relevance - rhs.relevance) < SearchServer::EPSILON)
+        throw std::invalid_argument("Page size must be positive"s);
+    }
+    const uint64_t query_hash = HashWord(raw_query);
+    if (!cursor.IsStart())
+    {
+        if (cursor.GetQueryHash() != query_hash)
         {
-            return lhs.rating > rhs.rating;
+            throw std::invalid_argument("The cursor belongs to another query"s);
         }
-        return lhs.relevance > rhs.relevance;
-    });
+        if (cursor.GetGeneration() != generation_)
+        {
+            throw StaleCursorError();
+        }
+    }
 
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT)
+    QueryContext context;
+    ParseQuery(raw_query, true, context.tokens_, context.query_);
+    FindAllDocuments(context, document_predicate, QueryControl{}, nullptr);
+
+    // The cursor is a lower bound: everything ranked up to it was served
+    auto &matched_documents = context.documents_;
+    if (!cursor.IsStart())
     {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+        matched_documents.erase(std::remove_if(matched_documents.begin(),
+                                               matched_documents.end(),
+                                               [&cursor](const Document &document)
+        {
+            return !IsRankedBefore(cursor.GetLast(), document);
+        }), matched_documents.end());
+    }
+
+    SearchPage page;
+    {
+        PROFILE_SCOPE("SortDocuments");
+        const size_t page_count = std::min(matched_documents.size(), page_size);
+        std::partial_sort(matched_documents.begin(),
+                          matched_documents.begin() + page_count,
+                          matched_documents.end(),
+                          IsRankedBefore);
+        page.documents.assign(matched_documents.begin(),
+                              matched_documents.begin() + page_count);
+    }
+    if (matched_documents.size() > page_size)
+    {
+        page.next = SearchCursor(page.documents.back(), generation_, query_hash);
+    }
+    return page;
+}
+
+template<typename DocumentPredicate>
+const std::vector<Document> &
+SearchServer::RunQuery(QueryContext &context,
+                       std::string_view raw_query,
+                       DocumentPredicate document_predicate,
+                       const QueryControl &control,
+                       const CorpusStatistics *statistics) const
+{
+    PROFILE_SCOPE("FindTopDocuments");
+    ParseQuery(raw_query, true, context.tokens_, context.query_, statistics);
+
+    FindAllDocuments(context, document_predicate, control, statistics);
+    control.Check();
+
+    auto &matched_documents = context.documents_;
+    {
+        PROFILE_SCOPE("SortDocuments");
+        const size_t top_count = std::min(matched_documents.size(), MAX_RESULT_DOCUMENT_COUNT);
+        std::partial_sort(matched_documents.begin(),
+                          matched_documents.begin() + top_count,
+                          matched_documents.end(),
+                          IsMoreRelevant);
+        matched_documents.resize(top_count);
     }
 
     return matched_documents;
 }
 
+template <typename DocumentPredicate>
+const std::vector<Document> &
+SearchServer::FindTopDocuments(QueryContext &context,
+                               std::string_view raw_query,
+                               DocumentPredicate document_predicate) const
+{
+    return RunQuery(context, raw_query, document_predicate, QueryControl{});
+}
+
 template<typename DocumentPredicate>
 std::vector<Document>
 SearchServer::FindTopDocuments(std::execution::parallel_policy /*unused*/,
                                std::string_view raw_query,
                                DocumentPredicate document_predicate) const
 {
+    PROFILE_SCOPE("FindTopDocuments");
     const auto query = ParseQuery(raw_query, true);
 
     auto matched_documents = FindAllDocuments(std::execution::par,
                                               query,
                                               document_predicate);
 
-    sort(std::execution::par, matched_documents.begin(), matched_documents.end(),
-         [this](const Document& lhs, const Document& rhs)
     {
-        if (std::abs(lhs.relevance - rhs.relevance) < SearchServer::EPSILON)
+        PROFILE_SCOPE("SortDocuments");
+        sort(std::execution::par, matched_documents.begin(), matched_documents.end(),
+             [this](const Document& lhs, const Document& rhs)
         {
-            return lhs.rating > rhs.rating;
-        }
-        return lhs.relevance > rhs.relevance;
-    });
+            return IsMoreRelevant(lhs, rhs);
+        });
+    }
 
     if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT)
     {
@@ -231,50 +734,402 @@ SearchServer::FindTopDocuments(std::string_view raw_query,
     return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
 }
 
-template<typename DocumentPredicate>
-std::vector<Document>
-SearchServer::FindAllDocuments(std::execution::sequenced_policy /*unused*/,
-                               const Query &query,
+template <typename DocumentPredicate>
+BudgetedSearchResult
+SearchServer::FindTopDocuments(std::string_view raw_query,
+                               const SearchBudget &budget,
                                DocumentPredicate document_predicate) const
 {
-    std::map<int, double> document_to_relevance;
+    PROFILE_SCOPE("FindTopDocuments");
+    const auto start_time = std::chrono::steady_clock::now();
+    const auto query = ParseQuery(raw_query, true);
+
+    if (impact_ordered_)
+    {
+        using Iterator = std::pmr::vector<std::pair<int, double>>::const_iterator;
+        std::vector<PostingCursor<Iterator>> cursors;
+        for (const auto word : query.plus_words)
+        {
+            const auto postings = word_to_impact_postings_.find(word);
+            if (postings == word_to_impact_postings_.end())
+            {
+                continue;
+            }
+            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
+            cursors.push_back({postings->second.begin(),
+                               postings->second.end(),
+                               inverse_document_freq,
+                               inverse_document_freq * postings->second.front().second});
+        }
+        return FindBudgetedDocuments(query, std::move(cursors), budget,
+                                     start_time, document_predicate);
+    }
+
+    // Without the impact layout, the rarest terms are scored first in id order
+    using Iterator = std::pmr::map<int, double>::const_iterator;
+    std::vector<PostingCursor<Iterator>> cursors;
     for (const auto word : query.plus_words)
     {
-        if (word_to_document_freqs_.count(word) == 0)
+        const auto postings = word_to_document_freqs_.find(word);
+        if (postings == word_to_document_freqs_.end())
         {
             continue;
         }
         const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word))
+        cursors.push_back({postings->second.begin(),
+                           postings->second.end(),
+                           inverse_document_freq,
+                           inverse_document_freq});
+    }
+    return FindBudgetedDocuments(query, std::move(cursors), budget,
+                                 start_time, document_predicate);
+}
+
+template <typename PostingIterator, typename DocumentPredicate>
+BudgetedSearchResult
+SearchServer::FindBudgetedDocuments(const Query &query,
+                                    std::vector<PostingCursor<PostingIterator>> cursors,
+                                    const SearchBudget &budget,
+                                    std::chrono::steady_clock::time_point start_time,
+                                    DocumentPredicate document_predicate) const
+{
+    PROFILE_SCOPE("FindAllDocuments");
+    const auto by_bound = [](const PostingCursor<PostingIterator> &lhs,
+            const PostingCursor<PostingIterator> &rhs)
+    {
+        return lhs.bound < rhs.bound;
+    };
+    std::make_heap(cursors.begin(), cursors.end(), by_bound);
+
+    BudgetedSearchResult result;
+    std::map<int, double> document_to_relevance;
+    while (!cursors.empty())
+    {
+        if ((budget.max_postings && result.processed_postings >= *budget.max_postings) ||
+                (budget.time && std::chrono::steady_clock::now() - start_time >= *budget.time))
+        {
+            result.is_exact = false;
+            break;
+        }
+
+        // The last segment is cut short so the posting budget holds exactly
+        const size_t segment_size = budget.max_postings ?
+                    std::min(IMPACT_SEGMENT_SIZE, *budget.max_postings - result.processed_postings) :
+                    IMPACT_SEGMENT_SIZE;
+
+        std::pop_heap(cursors.begin(), cursors.end(), by_bound);
+        auto &cursor = cursors.back();
+        for (size_t ii = 0; ii < segment_size && cursor.next != cursor.end;
+             ++ii, ++cursor.next)
         {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating))
+            const auto &[document_id, term_freq] = *cursor.next;
+            if (AcceptsDocument(document_predicate, document_id))
             {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+                document_to_relevance[document_id] += term_freq * cursor.inverse_document_freq;
             }
+            ++result.processed_postings;
+        }
+
+        if (cursor.next == cursor.end)
+        {
+            cursors.pop_back();
+            continue;
+        }
+        if (impact_ordered_)
+        {
+            cursor.bound = cursor.inverse_document_freq * cursor.next->second;
         }
+        std::push_heap(cursors.begin(), cursors.end(), by_bound);
     }
 
-    for (const auto& word : query.minus_words)
+    // Minus words are applied to the candidates only, so they cost no budget
+    for (const auto word : query.minus_words)
     {
-        if (word_to_document_freqs_.count(word) == 0)
+        const auto postings = word_to_document_freqs_.find(word);
+        if (postings == word_to_document_freqs_.end())
         {
             continue;
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(word))
+        for (auto it = document_to_relevance.begin(); it != document_to_relevance.end();)
         {
-            document_to_relevance.erase(document_id);
+            it = postings->second.count(it->first) != 0U ?
+                        document_to_relevance.erase(it) : std::next(it);
         }
     }
+    RemovePositionalMismatches(query, document_to_relevance);
 
-    std::vector<Document> matched_documents;
+    result.documents.reserve(document_to_relevance.size());
     for (const auto [document_id, relevance] : document_to_relevance)
     {
-        matched_documents.emplace_back(Document{document_id,
-                                                relevance,
-                                                documents_.at(document_id).rating});
+        result.documents.emplace_back(document_id,
+                                      relevance,
+                                      documents_.at(document_id).rating);
+    }
+
+    {
+        PROFILE_SCOPE("SortDocuments");
+        const size_t top_count = std::min(result.documents.size(), MAX_RESULT_DOCUMENT_COUNT);
+        std::partial_sort(result.documents.begin(),
+                          result.documents.begin() + top_count,
+                          result.documents.end(),
+                          [this](const Document& lhs, const Document& rhs)
+        {
+            return IsMoreRelevant(lhs, rhs);
+        });
+        result.documents.resize(top_count);
+    }
+
+    return result;
+}
+
+template <typename ExecutionPolicy>
+std::vector<SearchServer::MatchResult>
+SearchServer::MatchParsedQuery(ExecutionPolicy policy,
+                               std::string_view raw_query,
+                               const std::vector<int> &document_ids) const
+{
+    PROFILE_SCOPE("MatchDocuments");
+    using namespace std::literals::string_literals;
+
+    for (const int document_id : document_ids)
+    {
+        if (documents_.count(document_id) == 0U)
+        {
+            throw std::out_of_range("there is no such id "s + std::to_string(document_id));
+        }
+    }
+
+    const Query query = ParseQuery(raw_query, true);
+
+    std::vector<MatchResult> results(document_ids.size());
+    std::transform(policy, document_ids.begin(), document_ids.end(), results.begin(),
+                   [this, &query](int document_id)
+    {
+        return MatchParsedQuery(query, document_id);
+    });
+    return results;
+}
+
+template <typename ExecutionPolicy>
+std::vector<int> SearchServer::CollectDuplicates(ExecutionPolicy policy) const
+{
+    std::vector<const std::pmr::set<int>*> groups;
+    for (const auto &[fingerprint, document_ids] : fingerprint_to_documents_)
+    {
+        if (document_ids.size() > 1U)
+        {
+            groups.push_back(&document_ids);
+        }
+    }
+
+    std::vector<size_t> offsets(groups.size() + 1U, 0U);
+    std::transform_inclusive_scan(policy, groups.begin(), groups.end(),
+                                  offsets.begin() + 1, std::plus<>{},
+                                  [](const std::pmr::set<int> *document_ids)
+    {
+        return document_ids->size() - 1U;
+    });
+
+    // Every group keeps its smallest id, the rest are duplicates
+    std::vector<int> duplicates(offsets.back());
+    std::vector<size_t> group_indexes(groups.size());
+    std::iota(group_indexes.begin(), group_indexes.end(), 0U);
+    std::for_each(policy, group_indexes.begin(), group_indexes.end(),
+                  [&groups, &offsets, &duplicates](size_t index)
+    {
+        std::copy(std::next(groups[index]->begin()), groups[index]->end(),
+                  duplicates.begin() + offsets[index]);
+    });
+
+    std::sort(policy, duplicates.begin(), duplicates.end());
+    return duplicates;
+}
+
+template <typename DocumentPredicate>
+std::vector<Document>
+SearchServer::FindTopDocuments(std::string_view raw_query,
+                               const CorpusStatistics &statistics,
+                               DocumentPredicate document_predicate) const
+{
+    return RunQuery(raw_query, document_predicate, QueryControl{}, &statistics);
+}
+
+template <typename DocumentPredicate>
+std::future<std::vector<Document>>
+SearchServer::SubmitQuery(std::string raw_query,
+                          DocumentPredicate document_predicate,
+                          QueryOptions options) const
+{
+    return GetThreadPool().Submit([this,
+                                  raw_query = std::move(raw_query),
+                                  document_predicate,
+                                  options = std::move(options)]()
+    {
+        const QueryControl control(options);
+        control.Check();
+        return RunQuery(raw_query, document_predicate, control);
+    });
+}
+
+#ifdef SEARCH_SERVER_HAS_COROUTINES
+// Suspends the awaiting coroutine and resumes it on a pool thread
+// once the query has finished
+class SearchServer::QueryAwaitable
+{
+public:
+    QueryAwaitable(const SearchServer &search_server,
+                   std::function<std::vector<Document>()> query) :
+        search_server_(search_server),
+        query_(std::move(query))
+    {
+
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        search_server_.GetThreadPool().Post([this, handle]()
+        {
+            try
+            {
+                result_ = query_();
+            }
+            catch (...)
+            {
+                error_ = std::current_exception();
+            }
+            handle.resume();
+        });
+    }
+
+    std::vector<Document> await_resume()
+    {
+        if (error_)
+        {
+            std::rethrow_exception(error_);
+        }
+        return std::move(result_);
+    }
+
+private:
+    const SearchServer &search_server_;
+    std::function<std::vector<Document>()> query_;
+    std::vector<Document> result_;
+    std::exception_ptr error_;
+};
+
+template <typename DocumentPredicate>
+SearchServer::QueryAwaitable
+SearchServer::AwaitQuery(std::string raw_query,
+                         DocumentPredicate document_predicate,
+                         QueryOptions options) const
+{
+    return QueryAwaitable(*this, [this,
+                          raw_query = std::move(raw_query),
+                          document_predicate,
+                          options = std::move(options)]()
+    {
+        const QueryControl control(options);
+        control.Check();
+        return RunQuery(raw_query, document_predicate, control);
+    });
+}
+#endif
+
+template <typename DocumentPredicate>
+bool SearchServer::AcceptsDocument(const DocumentPredicate &document_predicate,
+                                   int document_id) const
+{
+    if constexpr (NeedsDocumentData<DocumentPredicate>())
+    {
+        const auto& document_data = documents_.at(document_id);
+        return document_predicate(document_id, document_data.status, document_data.rating);
+    }
+    else
+    {
+        // Id filters ignore the status and the rating
+        return document_predicate(document_id, DocumentStatus::ACTUAL, 0);
+    }
+}
+
+template<typename DocumentPredicate>
+void SearchServer::FindAllDocuments(QueryContext &context,
+                                    DocumentPredicate document_predicate,
+                                    const QueryControl &control,
+                                    const CorpusStatistics *statistics) const
+{
+    PROFILE_SCOPE("FindAllDocuments");
+    const Query &query = context.query_;
+
+    auto &postings = context.postings_;
+    postings.clear();
+    const IdBounds id_bounds = GetIdBounds(document_predicate);
+    for (const auto word : query.plus_words)
+    {
+        const auto word_postings = word_to_document_freqs_.find(word);
+        if (word_postings == word_to_document_freqs_.end() || id_bounds.IsEmpty())
+        {
+            continue;
+        }
+        control.Check();
+        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word, statistics);
+        size_t postings_until_check = QueryControl::CHECK_INTERVAL;
+        const auto first = word_postings->second.lower_bound(id_bounds.first);
+        const auto last = word_postings->second.upper_bound(id_bounds.last);
+        for (auto posting = first; posting != last; ++posting)
+        {
+            const auto [document_id, term_freq] = *posting;
+            if (--postings_until_check == 0U)
+            {
+                control.Check();
+                postings_until_check = QueryControl::CHECK_INTERVAL;
+            }
+            if (AcceptsDocument(document_predicate, document_id))
+            {
+                postings.emplace_back(document_id, term_freq * inverse_document_freq);
+            }
+        }
+    }
+    std::sort(postings.begin(), postings.end());
+
+    context.minus_postings_.clear();
+    for (const auto word : query.minus_words)
+    {
+        const auto word_postings = word_to_document_freqs_.find(word);
+        if (word_postings != word_to_document_freqs_.end())
+        {
+            context.minus_postings_.push_back(&word_postings->second);
+        }
+    }
+
+    const bool has_positions = !query.phrases.empty() || !query.proximities.empty();
+    context.documents_.clear();
+    for (auto it = postings.begin(); it != postings.end();)
+    {
+        const int document_id = it->first;
+        double relevance = 0.0;
+        for (; it != postings.end() && it->first == document_id; ++it)
+        {
+            relevance += it->second;
+        }
+
+        const bool has_minus_word = std::any_of(context.minus_postings_.begin(),
+                                                context.minus_postings_.end(),
+                                                [document_id](const auto *minus_postings)
+        {
+            return minus_postings->count(document_id) != 0U;
+        });
+        if (!has_minus_word && (!has_positions || MatchesPositions(query, document_id)))
+        {
+            context.documents_.emplace_back(Document{document_id,
+                                                     relevance,
+                                                     documents_.at(document_id).rating});
+        }
     }
-    return matched_documents;
 }
 
 template<typename DocumentPredicate>
@@ -283,6 +1138,7 @@ SearchServer::FindAllDocuments(std::execution::parallel_policy /*unused*/,
                                const Query &query,
                                DocumentPredicate document_predicate) const
 {
+    PROFILE_SCOPE("FindAllDocuments");
     const size_t COUNT_BUCKETS = 120;
     ConcurrentMap<int, double> map_document_to_relevance(COUNT_BUCKETS);
 
@@ -291,13 +1147,17 @@ SearchServer::FindAllDocuments(std::execution::parallel_policy /*unused*/,
                   query.plus_words.end(),
                   [this, &map_document_to_relevance, &document_predicate](auto &item)
     {
-        if (word_to_document_freqs_.count(item) != 0)
+        const IdBounds id_bounds = GetIdBounds(document_predicate);
+        if (word_to_document_freqs_.count(item) != 0 && !id_bounds.IsEmpty())
         {
             const double inverse_document_freq = ComputeWordInverseDocumentFreq(item);
-            for (const auto &[document_id, term_freq] : word_to_document_freqs_.at(item))
+            const auto &word_postings = word_to_document_freqs_.at(item);
+            const auto last = word_postings.upper_bound(id_bounds.last);
+            for (auto posting = word_postings.lower_bound(id_bounds.first);
+                 posting != last; ++posting)
             {
-                const auto& document_data = documents_.at(document_id);
-                if (document_predicate(document_id, document_data.status, document_data.rating))
+                const auto &[document_id, term_freq] = *posting;
+                if (AcceptsDocument(document_predicate, document_id))
                 {
                     map_document_to_relevance[document_id].ref_to_value +=
                             term_freq * inverse_document_freq;
@@ -322,7 +1182,9 @@ SearchServer::FindAllDocuments(std::execution::parallel_policy /*unused*/,
     });
 
     auto document_to_relevance = map_document_to_relevance.BuildOrdinaryMap();
-    std::vector<Document> matched_documents(document_to_relevance.size());
+    RemovePositionalMismatches(query, document_to_relevance);
+    std::vector<Document> matched_documents;
+    matched_documents.reserve(document_to_relevance.size());
     for (const auto [document_id, relevance] : document_to_relevance)
     {
         matched_documents.emplace_back(Document{document_id,
@@ -332,11 +1194,3 @@ SearchServer::FindAllDocuments(std::execution::parallel_policy /*unused*/,
 
     return matched_documents;
 }
-
-template <typename DocumentPredicate>
-std::vector<Document>
-SearchServer::FindAllDocuments(const Query& query,
-                               DocumentPredicate document_predicate) const
-{
-    return FindAllDocuments(std::execution::seq, query, document_predicate);
-}
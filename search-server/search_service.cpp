@@ -0,0 +1,157 @@
+#include "search_service.h"
+
+#include <mutex>
+#include <stdexcept>
+
+using namespace std::literals::string_literals;
+
+SearchService::SearchService(SearchServer &search_server)
+    : search_server_(search_server)
+{
+
+}
+
+std::string SearchService::Handle(const FrameHeader &header, std::string_view payload)
+{
+    MessageReader reader(payload);
+    MessageWriter writer;
+    try
+    {
+        Execute(static_cast<MessageType>(header.type), reader, writer);
+        return writer.Finish(header.request_id, static_cast<uint8_t>(ResponseStatus::OK));
+    }
+    catch (const std::invalid_argument &error)
+    {
+        MessageWriter error_writer;
+        error_writer.PutString(error.what());
+        return error_writer.Finish(header.request_id,
+                                   static_cast<uint8_t>(ResponseStatus::INVALID_ARGUMENT));
+    }
+    catch (const std::out_of_range &error)
+    {
+        MessageWriter error_writer;
+        error_writer.PutString(error.what());
+        return error_writer.Finish(header.request_id,
+                                   static_cast<uint8_t>(ResponseStatus::OUT_OF_RANGE));
+    }
+    catch (const std::exception &error)
+    {
+        MessageWriter error_writer;
+        error_writer.PutString(error.what());
+        return error_writer.Finish(header.request_id,
+                                   static_cast<uint8_t>(ResponseStatus::INTERNAL_ERROR));
+    }
+}
+
+void SearchService::AddDocument(int document_id,
+                                std::string_view document,
+                                DocumentStatus status,
+                                const std::vector<int> &ratings)
+{
+    std::unique_lock lock(mutex_);
+    search_server_.AddDocument(document_id, document, status, ratings);
+}
+
+void SearchService::RemoveDocument(int document_id)
+{
+    std::unique_lock lock(mutex_);
+    search_server_.RemoveDocument(document_id);
+}
+
+std::vector<Document> SearchService::FindTopDocuments(std::string_view raw_query,
+                                                      DocumentStatus status,
+                                                      const CorpusStatistics *statistics)
+{
+    std::shared_lock lock(mutex_);
+    return statistics != nullptr
+            ? search_server_.FindTopDocuments(raw_query, *statistics, status)
+            : search_server_.FindTopDocuments(raw_query, status);
+}
+
+CorpusStatistics SearchService::CollectQueryStatistics(std::string_view raw_query)
+{
+    std::shared_lock lock(mutex_);
+    return search_server_.CollectQueryStatistics(raw_query);
+}
+
+std::tuple<std::vector<std::string>, DocumentStatus>
+SearchService::MatchDocument(std::string_view raw_query, int document_id)
+{
+    std::shared_lock lock(mutex_);
+    const auto [words, status] = search_server_.MatchDocument(raw_query, document_id);
+    return {std::vector<std::string>(words.begin(), words.end()), status};
+}
+
+int SearchService::GetDocumentCount()
+{
+    std::shared_lock lock(mutex_);
+    return search_server_.GetDocumentCount();
+}
+
+void SearchService::Execute(MessageType type, MessageReader &reader, MessageWriter &writer)
+{
+    switch (type)
+    {
+    case MessageType::ADD_DOCUMENT:
+    {
+        const int document_id = reader.GetI32();
+        const std::string_view text = reader.GetString();
+        const DocumentStatus status = GetDocumentStatus(reader);
+        std::vector<int> ratings(reader.GetU32());
+        for (int &rating : ratings)
+        {
+            rating = reader.GetI32();
+        }
+        reader.ExpectEnd();
+        AddDocument(document_id, text, status, ratings);
+        return;
+    }
+    case MessageType::REMOVE_DOCUMENT:
+    {
+        const int document_id = reader.GetI32();
+        reader.ExpectEnd();
+        RemoveDocument(document_id);
+        return;
+    }
+    case MessageType::COLLECT_STATISTICS:
+    {
+        const std::string_view raw_query = reader.GetString();
+        reader.ExpectEnd();
+        PutStatistics(writer, CollectQueryStatistics(raw_query));
+        return;
+    }
+    case MessageType::FIND_TOP_DOCUMENTS:
+    {
+        const std::string_view raw_query = reader.GetString();
+        const DocumentStatus status = GetDocumentStatus(reader);
+        const CorpusStatistics statistics = GetStatistics(reader);
+        reader.ExpectEnd();
+        // Without global statistics the server ranks with its own
+        PutDocuments(writer, FindTopDocuments(raw_query, status,
+                                              statistics.document_count > 0 ? &statistics
+                                                                            : nullptr));
+        return;
+    }
+    case MessageType::MATCH_DOCUMENT:
+    {
+        const std::string_view raw_query = reader.GetString();
+        const int document_id = reader.GetI32();
+        reader.ExpectEnd();
+        const auto [words, status] = MatchDocument(raw_query, document_id);
+        writer.PutU32(static_cast<uint32_t>(words.size()));
+        for (const std::string &word : words)
+        {
+            writer.PutString(word);
+        }
+        writer.PutU8(static_cast<uint8_t>(status));
+        return;
+    }
+    case MessageType::GET_DOCUMENT_COUNT:
+    {
+        reader.ExpectEnd();
+        writer.PutI32(GetDocumentCount());
+        return;
+    }
+    }
+    throw ProtocolError("Unknown message type "s + std::to_string(static_cast<int>(type)));
+}
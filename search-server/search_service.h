@@ -0,0 +1,51 @@
+#ifndef SEARCH_SERVICE_H
+#define SEARCH_SERVICE_H
+
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "binary_protocol.h"
+#include "search_server.h"
+
+// Executes binary protocol requests against a SearchServer. Searches
+// share the server, adding and removing documents takes it exclusively.
+class SearchService
+{
+public:
+    explicit SearchService(SearchServer &search_server);
+
+    void AddDocument(int document_id,
+                     std::string_view document,
+                     DocumentStatus status,
+                     const std::vector<int> &ratings);
+
+    void RemoveDocument(int document_id);
+
+    // Ranks with the server's own statistics if none are given
+    std::vector<Document> FindTopDocuments(std::string_view raw_query,
+                                           DocumentStatus status,
+                                           const CorpusStatistics *statistics = nullptr);
+
+    CorpusStatistics CollectQueryStatistics(std::string_view raw_query);
+
+    // The words are copied, as the document may be removed once the lock is released
+    std::tuple<std::vector<std::string>, DocumentStatus>
+    MatchDocument(std::string_view raw_query, int document_id);
+
+    int GetDocumentCount();
+
+    // Returns the whole response frame. A failing request is answered
+    // with an error status, so the connection stays usable.
+    std::string Handle(const FrameHeader &header, std::string_view payload);
+
+private:
+    void Execute(MessageType type, MessageReader &reader, MessageWriter &writer);
+
+    SearchServer &search_server_;
+    std::shared_mutex mutex_;
+};
+
+#endif // SEARCH_SERVICE_H
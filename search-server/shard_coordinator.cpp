@@ -0,0 +1,288 @@
+#include "shard_coordinator.h"
+
+#include <mutex>
+#include <stdexcept>
+
+#include "search_server.h"
+#include "sharded_search_server.h"
+#include "socket_io.h"
+
+using namespace std::literals::string_literals;
+
+namespace
+{
+// Keeps a connection's replies from being read more than this far behind,
+// so neither side blocks on a full socket buffer
+const size_t PIPELINE_WINDOW = 64;
+
+struct ShardConnection
+{
+    SocketHandle socket;
+    uint32_t next_request_id = 0;
+};
+}
+
+class ShardCoordinator::ConnectionPool
+{
+public:
+    ConnectionPool(std::string address, size_t max_idle_connections)
+        : address_(std::move(address))
+        , max_idle_connections_(max_idle_connections)
+    {
+
+    }
+
+    std::unique_ptr<ShardConnection> Acquire()
+    {
+        {
+            std::lock_guard guard(mutex_);
+            if (!idle_.empty())
+            {
+                auto connection = std::move(idle_.back());
+                idle_.pop_back();
+                return connection;
+            }
+        }
+        return std::make_unique<ShardConnection>(ShardConnection{ConnectTo(address_)});
+    }
+
+    void Release(std::unique_ptr<ShardConnection> connection)
+    {
+        std::lock_guard guard(mutex_);
+        if (idle_.size() < max_idle_connections_)
+        {
+            idle_.push_back(std::move(connection));
+        }
+    }
+
+private:
+    const std::string address_;
+    const size_t max_idle_connections_;
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<ShardConnection>> idle_;
+};
+
+ShardCoordinator::ShardCoordinator(std::vector<std::string> shard_addresses,
+                                   size_t max_idle_connections)
+{
+    if (shard_addresses.empty())
+    {
+        throw std::invalid_argument("At least one shard address is required"s);
+    }
+    for (std::string &address : shard_addresses)
+    {
+        pools_.push_back(std::make_unique<ConnectionPool>(std::move(address),
+                                                          max_idle_connections));
+    }
+}
+
+ShardCoordinator::~ShardCoordinator() = default;
+
+void ShardCoordinator::AddDocument(int document_id,
+                                   std::string_view document,
+                                   DocumentStatus status,
+                                   const std::vector<int> &ratings)
+{
+    AddDocuments({RemoteDocument{document_id, std::string{document}, status, ratings}});
+}
+
+void ShardCoordinator::AddDocuments(const std::vector<RemoteDocument> &documents)
+{
+    std::vector<Request> requests;
+    requests.reserve(documents.size());
+    for (const RemoteDocument &document : documents)
+    {
+        Request request{SelectShard(document.id, pools_.size()), MessageType::ADD_DOCUMENT, {}};
+        request.message.PutI32(document.id);
+        request.message.PutString(document.text);
+        request.message.PutU8(static_cast<uint8_t>(document.status));
+        request.message.PutU32(static_cast<uint32_t>(document.ratings.size()));
+        for (const int rating : document.ratings)
+        {
+            request.message.PutI32(rating);
+        }
+        requests.push_back(std::move(request));
+    }
+    Exchange(std::move(requests));
+}
+
+std::vector<Document> ShardCoordinator::FindTopDocuments(std::string_view raw_query,
+                                                         DocumentStatus status) const
+{
+    const CorpusStatistics statistics = CollectQueryStatistics(raw_query);
+
+    MessageWriter message;
+    message.PutString(raw_query);
+    message.PutU8(static_cast<uint8_t>(status));
+    PutStatistics(message, statistics);
+
+    std::vector<std::vector<Document>> shard_results;
+    for (const Response &response : Exchange(MakeBroadcast(MessageType::FIND_TOP_DOCUMENTS,
+                                                           message)))
+    {
+        MessageReader reader(response.payload);
+        shard_results.push_back(GetDocuments(reader));
+        reader.ExpectEnd();
+    }
+    return SearchServer::MergeTopDocuments(shard_results);
+}
+
+CorpusStatistics ShardCoordinator::CollectQueryStatistics(std::string_view raw_query) const
+{
+    MessageWriter message;
+    message.PutString(raw_query);
+
+    CorpusStatistics statistics;
+    for (const Response &response : Exchange(MakeBroadcast(MessageType::COLLECT_STATISTICS,
+                                                           message)))
+    {
+        MessageReader reader(response.payload);
+        statistics.Merge(GetStatistics(reader));
+        reader.ExpectEnd();
+    }
+    return statistics;
+}
+
+std::tuple<std::vector<std::string>, DocumentStatus>
+ShardCoordinator::MatchDocument(std::string_view raw_query, int document_id) const
+{
+    Request request{SelectShard(document_id, pools_.size()), MessageType::MATCH_DOCUMENT, {}};
+    request.message.PutString(raw_query);
+    request.message.PutI32(document_id);
+
+    std::vector<Request> requests;
+    requests.push_back(std::move(request));
+    const Response response = std::move(Exchange(std::move(requests)).front());
+
+    MessageReader reader(response.payload);
+    std::vector<std::string> words(reader.GetU32());
+    for (std::string &word : words)
+    {
+        word = reader.GetString();
+    }
+    const DocumentStatus status = GetDocumentStatus(reader);
+    reader.ExpectEnd();
+    return {words, status};
+}
+
+void ShardCoordinator::RemoveDocument(int document_id)
+{
+    Request request{SelectShard(document_id, pools_.size()), MessageType::REMOVE_DOCUMENT, {}};
+    request.message.PutI32(document_id);
+
+    std::vector<Request> requests;
+    requests.push_back(std::move(request));
+    Exchange(std::move(requests));
+}
+
+int ShardCoordinator::GetDocumentCount() const
+{
+    int document_count = 0;
+    for (const Response &response : Exchange(MakeBroadcast(MessageType::GET_DOCUMENT_COUNT,
+                                                           MessageWriter{})))
+    {
+        MessageReader reader(response.payload);
+        document_count += reader.GetI32();
+        reader.ExpectEnd();
+    }
+    return document_count;
+}
+
+size_t ShardCoordinator::GetShardCount() const
+{
+    return pools_.size();
+}
+
+std::vector<ShardCoordinator::Response>
+ShardCoordinator::Exchange(std::vector<Request> requests) const
+{
+    std::vector<std::vector<size_t>> shard_requests(pools_.size());
+    for (size_t ii = 0; ii < requests.size(); ++ii)
+    {
+        shard_requests[requests[ii].shard].push_back(ii);
+    }
+
+    std::vector<std::unique_ptr<ShardConnection>> connections(pools_.size());
+    for (size_t shard = 0; shard < pools_.size(); ++shard)
+    {
+        if (!shard_requests[shard].empty())
+        {
+            connections[shard] = pools_[shard]->Acquire();
+        }
+    }
+
+    // On an I/O or protocol error the connections are dropped with this
+    // frame, since their streams are no longer in sync
+    std::vector<Response> responses(requests.size());
+    std::vector<size_t> sent(pools_.size(), 0U);
+    std::vector<size_t> received(pools_.size(), 0U);
+    size_t total_received = 0;
+    while (total_received < requests.size())
+    {
+        for (size_t shard = 0; shard < pools_.size(); ++shard)
+        {
+            const auto &indexes = shard_requests[shard];
+            while (sent[shard] < indexes.size() && sent[shard] - received[shard] < PIPELINE_WINDOW)
+            {
+                Request &request = requests[indexes[sent[shard]++]];
+                ShardConnection &connection = *connections[shard];
+                WriteAll(connection.socket.Get(),
+                         request.message.Finish(connection.next_request_id++,
+                                                static_cast<uint8_t>(request.type)));
+            }
+        }
+
+        for (size_t shard = 0; shard < pools_.size(); ++shard)
+        {
+            if (received[shard] == sent[shard])
+            {
+                continue;
+            }
+
+            ShardConnection &connection = *connections[shard];
+            const uint32_t expected_id = connection.next_request_id -
+                    static_cast<uint32_t>(sent[shard] - received[shard]);
+            FrameHeader header;
+            Response &response = responses[shard_requests[shard][received[shard]++]];
+            if (!ReadFrame(connection.socket.Get(), header, response.payload))
+            {
+                throw ProtocolError("Shard closed the connection"s);
+            }
+            if (header.request_id != expected_id)
+            {
+                throw ProtocolError("Shard replied out of order"s);
+            }
+            response.status = static_cast<ResponseStatus>(header.type);
+            ++total_received;
+        }
+    }
+
+    for (size_t shard = 0; shard < pools_.size(); ++shard)
+    {
+        if (connections[shard])
+        {
+            pools_[shard]->Release(std::move(connections[shard]));
+        }
+    }
+
+    for (const Response &response : responses)
+    {
+        if (response.status != ResponseStatus::OK)
+        {
+            MessageReader reader(response.payload);
+            ThrowRemoteError(response.status, reader.GetString());
+        }
+    }
+    return responses;
+}
+
+std::vector<ShardCoordinator::Request>
+ShardCoordinator::MakeBroadcast(MessageType type, const MessageWriter &message) const
+{
+    std::vector<Request> requests;
+    for (size_t shard = 0; shard < pools_.size(); ++shard)
+    {
+        requests.push_back({shard, type, message});
+    }
+    return requests;
+}
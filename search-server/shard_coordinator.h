@@ -0,0 +1,84 @@
+#ifndef SHARD_COORDINATOR_H
+#define SHARD_COORDINATOR_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "binary_protocol.h"
+#include "corpus_statistics.h"
+#include "document.h"
+
+struct RemoteDocument
+{
+    int id = 0;
+    std::string text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
+
+// Client of several ShardServer processes holding one corpus. Documents
+// are routed by id like in ShardedSearchServer. A query gathers document
+// frequencies from every shard and then ranks on all of them with those
+// global counts. Requests to different shards are written before any
+// reply is read, and connections are kept in a per-shard pool.
+// Thread-safe; remote errors are rethrown as std::invalid_argument,
+// std::out_of_range or std::runtime_error.
+class ShardCoordinator
+{
+public:
+    explicit ShardCoordinator(std::vector<std::string> shard_addresses,
+                              size_t max_idle_connections = 4);
+
+    ~ShardCoordinator();
+
+    void AddDocument(int document_id,
+                     std::string_view document,
+                     DocumentStatus status,
+                     const std::vector<int> &ratings);
+
+    // Pipelines the documents of each shard over one connection
+    void AddDocuments(const std::vector<RemoteDocument> &documents);
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query,
+                                           DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+    CorpusStatistics CollectQueryStatistics(std::string_view raw_query) const;
+
+    std::tuple<std::vector<std::string>, DocumentStatus>
+    MatchDocument(std::string_view raw_query, int document_id) const;
+
+    void RemoveDocument(int document_id);
+
+    int GetDocumentCount() const;
+
+    size_t GetShardCount() const;
+
+private:
+    class ConnectionPool;
+
+    struct Request
+    {
+        size_t shard = 0;
+        MessageType type = MessageType::GET_DOCUMENT_COUNT;
+        MessageWriter message;
+    };
+
+    struct Response
+    {
+        ResponseStatus status = ResponseStatus::OK;
+        std::string payload;
+    };
+
+    // Responses come in the order of requests. Throws the first remote
+    // error only after every response has been read.
+    std::vector<Response> Exchange(std::vector<Request> requests) const;
+
+    std::vector<Request> MakeBroadcast(MessageType type, const MessageWriter &message) const;
+
+    std::vector<std::unique_ptr<ConnectionPool>> pools_;
+};
+
+#endif // SHARD_COORDINATOR_H
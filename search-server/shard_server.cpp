@@ -0,0 +1,113 @@
+#include "shard_server.h"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <iostream>
+#include <system_error>
+#include <thread>
+
+using namespace std::literals::string_literals;
+
+ShardServer::ShardServer(SearchServer &search_server, std::string address)
+    : service_(search_server)
+    , address_(std::move(address))
+    , listener_(ListenOn(address_))
+    , wake_event_(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+{
+    if (!wake_event_.IsValid())
+    {
+        throw std::system_error(errno, std::generic_category(), "eventfd"s);
+    }
+}
+
+ShardServer::~ShardServer()
+{
+    RemoveSocketFile(address_);
+}
+
+void ShardServer::Run()
+{
+    while (!stopping_.load())
+    {
+        pollfd fds[] = {{listener_.Get(), POLLIN, 0}, {wake_event_.Get(), POLLIN, 0}};
+        if (::poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "poll"s);
+        }
+        if (stopping_.load() || (fds[0].revents & POLLIN) == 0)
+        {
+            continue;
+        }
+
+        SocketHandle connection = AcceptConnection(listener_.Get());
+        {
+            std::lock_guard guard(connections_mutex_);
+            connections_.insert(connection.Get());
+            ++active_connections_;
+        }
+        std::thread([this, connection = std::move(connection)]() mutable
+        {
+            ServeConnection(std::move(connection));
+        }).detach();
+    }
+
+    // Wakes connection threads blocked in recv; each closes its own socket
+    std::unique_lock lock(connections_mutex_);
+    for (const int fd : connections_)
+    {
+        ::shutdown(fd, SHUT_RDWR);
+    }
+    connections_finished_.wait(lock, [this]()
+    {
+        return active_connections_ == 0U;
+    });
+}
+
+void ShardServer::Stop()
+{
+    stopping_.store(true);
+    const uint64_t one = 1;
+    [[maybe_unused]] const ssize_t written = ::write(wake_event_.Get(), &one, sizeof(one));
+}
+
+const std::string &ShardServer::GetAddress() const
+{
+    return address_;
+}
+
+void ShardServer::ServeConnection(SocketHandle connection)
+{
+    try
+    {
+        FrameHeader header;
+        std::string payload;
+        while (!stopping_.load() && ReadFrame(connection.Get(), header, payload))
+        {
+            WriteAll(connection.Get(), service_.Handle(header, payload));
+        }
+    }
+    catch (const std::exception &error)
+    {
+        // A broken connection only concerns its client
+        if (!stopping_.load())
+        {
+            std::cerr << "Shard connection closed: "s << error.what() << std::endl;
+        }
+    }
+
+    std::lock_guard guard(connections_mutex_);
+    connections_.erase(connection.Get());
+    connection.Reset();
+    if (--active_connections_ == 0U)
+    {
+        connections_finished_.notify_all();
+    }
+}
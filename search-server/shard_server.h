@@ -0,0 +1,50 @@
+#ifndef SHARD_SERVER_H
+#define SHARD_SERVER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+
+#include "search_server.h"
+#include "search_service.h"
+#include "socket_io.h"
+
+// Serves one SearchServer over the binary protocol, one thread per
+// connection. Requests on a connection are answered in order, so a
+// client may pipeline them.
+class ShardServer
+{
+public:
+    // Starts listening right away, so clients may connect before Run
+    ShardServer(SearchServer &search_server, std::string address);
+
+    ~ShardServer();
+
+    // Accepts connections until Stop, then closes them and waits
+    // for their threads
+    void Run();
+
+    // Async-signal-safe, may be called from any thread
+    void Stop();
+
+    const std::string &GetAddress() const;
+
+private:
+    void ServeConnection(SocketHandle connection);
+
+    SearchService service_;
+    const std::string address_;
+    SocketHandle listener_;
+    SocketHandle wake_event_;
+    std::atomic<bool> stopping_ = false;
+
+    std::mutex connections_mutex_;
+    std::condition_variable connections_finished_;
+    std::set<int> connections_;
+    size_t active_connections_ = 0;
+};
+
+#endif // SHARD_SERVER_H
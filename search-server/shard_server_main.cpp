@@ -0,0 +1,82 @@
+#include <csignal>
+#include <iostream>
+#include <string>
+
+#include "search_server.h"
+#include "shard_server.h"
+
+/**
+ * Serves one shard of a corpus over the binary protocol, to be driven
+ * by a ShardCoordinator. Runs until SIGINT or SIGTERM.
+ *
+ *  SearchServerShard --listen=unix:/tmp/shard0.sock [--stop-words="a the"]
+ *  SearchServerShard --listen=tcp:127.0.0.1:7001
+ */
+
+using namespace std;
+
+namespace
+{
+ShardServer *running_server = nullptr;
+
+void HandleStopSignal(int /*unused*/)
+{
+    if (running_server != nullptr)
+    {
+        running_server->Stop();
+    }
+}
+}
+
+int main(int argc, char *argv[])
+{
+    string address;
+    string stop_words;
+    for (int ii = 1; ii < argc; ++ii)
+    {
+        const string argument = argv[ii];
+        const auto separator = argument.find('=');
+        const string name = argument.substr(0, separator);
+        const string value = separator == string::npos ? ""s : argument.substr(separator + 1);
+
+        if (name == "--listen"s)
+        {
+            address = value;
+        }
+        else if (name == "--stop-words"s)
+        {
+            stop_words = value;
+        }
+        else
+        {
+            cerr << "Unknown option "s << argument << endl;
+            return 1;
+        }
+    }
+    if (address.empty())
+    {
+        cerr << "Usage: SearchServerShard --listen=unix:PATH|tcp:HOST:PORT [--stop-words=WORDS]"s
+             << endl;
+        return 1;
+    }
+
+    try
+    {
+        SearchServer search_server(stop_words);
+        ShardServer server(search_server, address);
+
+        running_server = &server;
+        signal(SIGINT, HandleStopSignal);
+        signal(SIGTERM, HandleStopSignal);
+
+        cerr << "Serving shard on "s << server.GetAddress() << endl;
+        server.Run();
+        running_server = nullptr;
+    }
+    catch (const exception &error)
+    {
+        cerr << error.what() << endl;
+        return 1;
+    }
+    return 0;
+}
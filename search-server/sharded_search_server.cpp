@@ -0,0 +1,118 @@
+#include "sharded_search_server.h"
+
+#include <numeric>
+
+#include "hashing.h"
+
+size_t SelectShard(int document_id, size_t shard_count)
+{
+    return MixHash(static_cast<uint64_t>(static_cast<uint32_t>(document_id))) % shard_count;
+}
+
+ShardedSearchServer::ShardedSearchServer(const std::string &stop_words_text,
+                                         size_t shard_count)
+    : ShardedSearchServer(SplitIntoWords(stop_words_text), shard_count)
+{
+
+}
+
+void ShardedSearchServer::AddDocument(int document_id,
+                                      std::string_view document,
+                                      DocumentStatus status,
+                                      const std::vector<int> &ratings)
+{
+    // An id always maps to the same shard, which rejects it if it is taken
+    shards_[GetShardIndex(document_id)]->AddDocument(document_id, document, status, ratings);
+    document_ids_.insert(document_id);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query,
+                                                            DocumentStatus status) const
+{
+    return FindTopDocuments(raw_query,
+                            [status](int /*unused*/,
+                            DocumentStatus document_status,
+                            int /*unused*/)
+    {
+        return document_status == status;
+    });
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query) const
+{
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+CorpusStatistics ShardedSearchServer::CollectQueryStatistics(std::string_view raw_query) const
+{
+    CorpusStatistics statistics;
+    for (const auto &shard : shards_)
+    {
+        statistics.Merge(shard->CollectQueryStatistics(raw_query));
+    }
+    return statistics;
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus>
+ShardedSearchServer::MatchDocument(std::string_view raw_query, int document_id) const
+{
+    return shards_[GetShardIndex(document_id)]->MatchDocument(raw_query, document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id)
+{
+    shards_[GetShardIndex(document_id)]->RemoveDocument(document_id);
+    document_ids_.erase(document_id);
+}
+
+void ShardedSearchServer::RemoveDocuments(const std::vector<int> &document_ids)
+{
+    std::vector<std::vector<int>> shard_ids(shards_.size());
+    for (const int document_id : document_ids)
+    {
+        shard_ids[GetShardIndex(document_id)].push_back(document_id);
+    }
+
+    std::vector<size_t> indexes(shards_.size());
+    std::iota(indexes.begin(), indexes.end(), 0U);
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(),
+                  [this, &shard_ids](size_t index)
+    {
+        shards_[index]->RemoveDocuments(std::execution::seq, shard_ids[index]);
+    });
+
+    for (const int document_id : document_ids)
+    {
+        document_ids_.erase(document_id);
+    }
+}
+
+int ShardedSearchServer::GetDocumentCount() const
+{
+    return static_cast<int>(document_ids_.size());
+}
+
+std::set<int>::const_iterator ShardedSearchServer::begin() const
+{
+    return document_ids_.begin();
+}
+
+std::set<int>::const_iterator ShardedSearchServer::end() const
+{
+    return document_ids_.end();
+}
+
+size_t ShardedSearchServer::GetShardCount() const
+{
+    return shards_.size();
+}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id) const
+{
+    return SelectShard(document_id, shards_.size());
+}
+
+const SearchServer &ShardedSearchServer::GetShard(size_t index) const
+{
+    return *shards_.at(index);
+}
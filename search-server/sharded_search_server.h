@@ -0,0 +1,110 @@
+#ifndef SHARDED_SEARCH_SERVER_H
+#define SHARDED_SEARCH_SERVER_H
+
+#include <algorithm>
+#include <execution>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "corpus_statistics.h"
+#include "document.h"
+#include "search_server.h"
+
+// Shard of a document, shared by every sharded setup so that they agree
+size_t SelectShard(int document_id, size_t shard_count);
+
+// Spreads documents over several SearchServer shards by id hash.
+// A query first gathers document frequencies from every shard, then runs
+// on all shards in parallel with these global counts, so the ranking
+// matches a single SearchServer holding all documents.
+class ShardedSearchServer
+{
+public:
+    ShardedSearchServer(const std::string &stop_words_text, size_t shard_count);
+
+    template <typename StringContainer>
+    ShardedSearchServer(const StringContainer &stop_words, size_t shard_count);
+
+    void AddDocument(int document_id,
+                     std::string_view document,
+                     DocumentStatus status,
+                     const std::vector<int> &ratings);
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query,
+                                           DocumentPredicate document_predicate) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query,
+                                           DocumentStatus status) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    // Statistics of the whole corpus for the query's plus words
+    CorpusStatistics CollectQueryStatistics(std::string_view raw_query) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus>
+    MatchDocument(std::string_view raw_query, int document_id) const;
+
+    void RemoveDocument(int document_id);
+
+    void RemoveDocuments(const std::vector<int> &document_ids);
+
+    int GetDocumentCount() const;
+
+    std::set<int>::const_iterator begin() const;
+
+    std::set<int>::const_iterator end() const;
+
+    size_t GetShardCount() const;
+
+    size_t GetShardIndex(int document_id) const;
+
+    const SearchServer &GetShard(size_t index) const;
+
+private:
+    std::vector<std::unique_ptr<SearchServer>> shards_;
+    std::set<int> document_ids_;
+};
+
+template <typename StringContainer>
+ShardedSearchServer::ShardedSearchServer(const StringContainer &stop_words,
+                                         size_t shard_count)
+{
+    using namespace std::literals::string_literals;
+    if (shard_count == 0U)
+    {
+        throw std::invalid_argument("Shard count must be positive"s);
+    }
+
+    shards_.reserve(shard_count);
+    for (size_t ii = 0; ii < shard_count; ++ii)
+    {
+        shards_.push_back(std::make_unique<SearchServer>(stop_words));
+    }
+}
+
+template <typename DocumentPredicate>
+std::vector<Document>
+ShardedSearchServer::FindTopDocuments(std::string_view raw_query,
+                                      DocumentPredicate document_predicate) const
+{
+    // Collected sequentially: it also validates the query, and an exception
+    // escaping a parallel algorithm would terminate the program
+    const CorpusStatistics statistics = CollectQueryStatistics(raw_query);
+
+    std::vector<std::vector<Document>> shard_results(shards_.size());
+    std::transform(std::execution::par, shards_.begin(), shards_.end(), shard_results.begin(),
+                   [raw_query, &statistics, &document_predicate](const auto &shard)
+    {
+        return shard->FindTopDocuments(raw_query, statistics, document_predicate);
+    });
+
+    return SearchServer::MergeTopDocuments(shard_results);
+}
+
+#endif // SHARDED_SEARCH_SERVER_H
@@ -0,0 +1,310 @@
+#include "socket_io.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+using namespace std::literals::string_literals;
+
+namespace
+{
+const std::string_view UNIX_PREFIX = "unix:";
+const std::string_view TCP_PREFIX = "tcp:";
+
+[[noreturn]] void ThrowSystemError(const std::string &what)
+{
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+sockaddr_un MakeUnixAddress(std::string_view path)
+{
+    sockaddr_un address{};
+    if (path.empty() || path.size() >= sizeof(address.sun_path))
+    {
+        throw std::invalid_argument("Invalid unix socket path "s + std::string{path});
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.data(), path.size());
+    return address;
+}
+
+sockaddr_in MakeTcpAddress(std::string_view host_port)
+{
+    const auto separator = host_port.rfind(':');
+    if (separator == std::string_view::npos)
+    {
+        throw std::invalid_argument("Expected host:port, got "s + std::string{host_port});
+    }
+
+    std::string host{host_port.substr(0, separator)};
+    if (host == "localhost"s)
+    {
+        host = "127.0.0.1"s;
+    }
+    const std::string port{host_port.substr(separator + 1)};
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    size_t parsed = 0;
+    int port_number = -1;
+    try
+    {
+        port_number = std::stoi(port, &parsed);
+    }
+    catch (const std::exception&)
+    {
+    }
+    if (parsed != port.size() || port_number < 0 || port_number > 65535 ||
+            inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1)
+    {
+        throw std::invalid_argument("Invalid tcp address "s + std::string{host_port});
+    }
+    address.sin_port = htons(static_cast<uint16_t>(port_number));
+    return address;
+}
+
+SocketHandle MakeSocket(std::string_view address, int family)
+{
+    SocketHandle socket_handle(::socket(family, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    if (!socket_handle.IsValid())
+    {
+        ThrowSystemError("socket "s + std::string{address});
+    }
+    return socket_handle;
+}
+
+void SetNoDelay(int fd)
+{
+    const int enabled = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+}
+
+// Returns the number of bytes read, less than size only at end of stream
+size_t ReadUpTo(int fd, char *data, size_t size)
+{
+    size_t done = 0;
+    while (done < size)
+    {
+        const ssize_t count = ::recv(fd, data + done, size - done, 0);
+        if (count == 0)
+        {
+            break;
+        }
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            ThrowSystemError("recv"s);
+        }
+        done += static_cast<size_t>(count);
+    }
+    return done;
+}
+}
+
+SocketHandle::SocketHandle(int fd)
+    : fd_(fd)
+{
+
+}
+
+SocketHandle::SocketHandle(SocketHandle &&other) noexcept
+    : fd_(std::exchange(other.fd_, -1))
+{
+
+}
+
+SocketHandle &SocketHandle::operator=(SocketHandle &&other) noexcept
+{
+    if (this != &other)
+    {
+        Reset();
+        fd_ = std::exchange(other.fd_, -1);
+    }
+    return *this;
+}
+
+SocketHandle::~SocketHandle()
+{
+    Reset();
+}
+
+int SocketHandle::Get() const
+{
+    return fd_;
+}
+
+bool SocketHandle::IsValid() const
+{
+    return fd_ >= 0;
+}
+
+void SocketHandle::Reset()
+{
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+SocketHandle ListenOn(std::string_view address, int backlog)
+{
+    SocketHandle listener;
+    if (address.substr(0, UNIX_PREFIX.size()) == UNIX_PREFIX)
+    {
+        const sockaddr_un unix_address = MakeUnixAddress(address.substr(UNIX_PREFIX.size()));
+        SocketHandle socket_handle = MakeSocket(address, AF_UNIX);
+        // A socket file left by a previous run would make bind fail
+        ::unlink(unix_address.sun_path);
+        if (::bind(socket_handle.Get(), reinterpret_cast<const sockaddr*>(&unix_address),
+                   sizeof(unix_address)) != 0)
+        {
+            ThrowSystemError("bind "s + std::string{address});
+        }
+        listener = std::move(socket_handle);
+    }
+    else if (address.substr(0, TCP_PREFIX.size()) == TCP_PREFIX)
+    {
+        const sockaddr_in tcp_address = MakeTcpAddress(address.substr(TCP_PREFIX.size()));
+        SocketHandle socket_handle = MakeSocket(address, AF_INET);
+        const int enabled = 1;
+        setsockopt(socket_handle.Get(), SOL_SOCKET, SO_REUSEADDR, &enabled, sizeof(enabled));
+        if (::bind(socket_handle.Get(), reinterpret_cast<const sockaddr*>(&tcp_address),
+                   sizeof(tcp_address)) != 0)
+        {
+            ThrowSystemError("bind "s + std::string{address});
+        }
+        listener = std::move(socket_handle);
+    }
+    else
+    {
+        throw std::invalid_argument("Unknown address scheme "s + std::string{address});
+    }
+
+    if (::listen(listener.Get(), backlog) != 0)
+    {
+        ThrowSystemError("listen "s + std::string{address});
+    }
+    return listener;
+}
+
+SocketHandle ConnectTo(std::string_view address)
+{
+    if (address.substr(0, UNIX_PREFIX.size()) == UNIX_PREFIX)
+    {
+        const sockaddr_un unix_address = MakeUnixAddress(address.substr(UNIX_PREFIX.size()));
+        SocketHandle socket_handle = MakeSocket(address, AF_UNIX);
+        if (::connect(socket_handle.Get(), reinterpret_cast<const sockaddr*>(&unix_address),
+                      sizeof(unix_address)) != 0)
+        {
+            ThrowSystemError("connect "s + std::string{address});
+        }
+        return socket_handle;
+    }
+    if (address.substr(0, TCP_PREFIX.size()) == TCP_PREFIX)
+    {
+        const sockaddr_in tcp_address = MakeTcpAddress(address.substr(TCP_PREFIX.size()));
+        SocketHandle socket_handle = MakeSocket(address, AF_INET);
+        if (::connect(socket_handle.Get(), reinterpret_cast<const sockaddr*>(&tcp_address),
+                      sizeof(tcp_address)) != 0)
+        {
+            ThrowSystemError("connect "s + std::string{address});
+        }
+        SetNoDelay(socket_handle.Get());
+        return socket_handle;
+    }
+    throw std::invalid_argument("Unknown address scheme "s + std::string{address});
+}
+
+SocketHandle AcceptConnection(int listener_fd, bool non_blocking)
+{
+    const int flags = SOCK_CLOEXEC | (non_blocking ? SOCK_NONBLOCK : 0);
+    while (true)
+    {
+        SocketHandle connection(::accept4(listener_fd, nullptr, nullptr, flags));
+        if (connection.IsValid())
+        {
+            // Fails harmlessly for unix sockets
+            SetNoDelay(connection.Get());
+            return connection;
+        }
+        if (non_blocking && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            return connection;
+        }
+        if (errno != EINTR && errno != ECONNABORTED)
+        {
+            ThrowSystemError("accept"s);
+        }
+    }
+}
+
+void SetNonBlocking(int fd)
+{
+    const int flags = ::fcntl(fd, F_GETFL);
+    if (flags < 0 || ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0)
+    {
+        ThrowSystemError("fcntl"s);
+    }
+}
+
+void RemoveSocketFile(std::string_view address)
+{
+    if (address.substr(0, UNIX_PREFIX.size()) == UNIX_PREFIX)
+    {
+        ::unlink(std::string{address.substr(UNIX_PREFIX.size())}.c_str());
+    }
+}
+
+void WriteAll(int fd, std::string_view data)
+{
+    while (!data.empty())
+    {
+        // MSG_NOSIGNAL: a closed peer is an error, not a SIGPIPE
+        const ssize_t count = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            ThrowSystemError("send"s);
+        }
+        data.remove_prefix(static_cast<size_t>(count));
+    }
+}
+
+bool ReadFrame(int fd, FrameHeader &header, std::string &payload)
+{
+    char header_bytes[FrameHeader::SIZE];
+    const size_t header_size = ReadUpTo(fd, header_bytes, FrameHeader::SIZE);
+    if (header_size == 0U)
+    {
+        return false;
+    }
+    if (header_size < FrameHeader::SIZE)
+    {
+        throw ProtocolError("Connection closed inside a frame header"s);
+    }
+
+    header = DecodeFrameHeader({header_bytes, FrameHeader::SIZE});
+    payload.resize(header.payload_size);
+    if (ReadUpTo(fd, payload.data(), payload.size()) < payload.size())
+    {
+        throw ProtocolError("Connection closed inside a frame"s);
+    }
+    return true;
+}
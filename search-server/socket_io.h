@@ -0,0 +1,54 @@
+#ifndef SOCKET_IO_H
+#define SOCKET_IO_H
+
+#include <string>
+#include <string_view>
+
+#include "binary_protocol.h"
+
+// Owns a file descriptor and closes it on destruction
+class SocketHandle
+{
+public:
+    SocketHandle() = default;
+    explicit SocketHandle(int fd);
+    SocketHandle(SocketHandle &&other) noexcept;
+    SocketHandle &operator=(SocketHandle &&other) noexcept;
+    SocketHandle(const SocketHandle &) = delete;
+    SocketHandle &operator=(const SocketHandle &) = delete;
+    ~SocketHandle();
+
+    int Get() const;
+
+    bool IsValid() const;
+
+    void Reset();
+
+private:
+    int fd_ = -1;
+};
+
+// Addresses are "unix:/path/to/socket" or "tcp:host:port", where host is
+// a numeric IPv4 address or localhost. Errors are std::system_error,
+// a malformed address is std::invalid_argument.
+SocketHandle ListenOn(std::string_view address, int backlog = 128);
+
+SocketHandle ConnectTo(std::string_view address);
+
+// Retries on EINTR and on connections aborted before being accepted.
+// A non-blocking accept returns an invalid handle when nobody is waiting,
+// and the accepted socket is non-blocking too.
+SocketHandle AcceptConnection(int listener_fd, bool non_blocking = false);
+
+void SetNonBlocking(int fd);
+
+// Removes the socket file of a unix address, does nothing for tcp
+void RemoveSocketFile(std::string_view address);
+
+void WriteAll(int fd, std::string_view data);
+
+// Blocks until a whole frame arrives. Returns false if the peer closed
+// the connection between frames, throws if it did so inside a frame.
+bool ReadFrame(int fd, FrameHeader &header, std::string &payload);
+
+#endif // SOCKET_IO_H
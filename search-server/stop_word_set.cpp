@@ -0,0 +1,48 @@
+#include "stop_word_set.h"
+
+#include <algorithm>
+
+StopWordSet::StopWordSet(std::vector<std::string> words)
+{
+    words.erase(std::remove(words.begin(), words.end(), std::string{}), words.end());
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    if (words.empty())
+    {
+        return;
+    }
+
+    const size_t count = words.size();
+    std::vector<uint64_t> hashes(count);
+    std::vector<size_t> slots(count);
+    std::vector<size_t> order(count);
+    std::vector<size_t> bucket_sizes(count);
+    std::vector<char> taken(count);
+    seeds_.resize(count);
+    if (!perfect_hash::Build(words, hashes, seeds_, slots, order, bucket_sizes, taken))
+    {
+        throw std::runtime_error("No perfect hash found for the stop words");
+    }
+
+    words_.reserve(count);
+    for (const size_t index : slots)
+    {
+        filter_.Add(words[index]);
+        words_.push_back(std::move(words[index]));
+    }
+}
+
+size_t StopWordSet::size() const
+{
+    return words_.size();
+}
+
+std::vector<std::string>::const_iterator StopWordSet::begin() const
+{
+    return words_.begin();
+}
+
+std::vector<std::string>::const_iterator StopWordSet::end() const
+{
+    return words_.end();
+}
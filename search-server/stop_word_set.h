@@ -0,0 +1,265 @@
+#ifndef STOP_WORD_SET_H
+#define STOP_WORD_SET_H
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "hashing.h"
+#include "string_processing.h"
+
+/**
+ * Stop words are kept in a minimal perfect hash (hash and displace): the word
+ * hash picks a bucket, the bucket's seed picks one of N slots, and no two stop
+ * words share a slot. A lookup is one hash and one comparison. Most tokens
+ * are rejected by the length and first byte masks before that.
+ */
+namespace perfect_hash
+{
+constexpr uint32_t MAX_SEED = 1U << 20U;
+
+constexpr size_t GetSlot(uint64_t hash, uint32_t seed, size_t slot_count)
+{
+    return MixHash(hash ^ (seed * 0x9e3779b97f4a7c15ULL)) % slot_count;
+}
+
+struct WordFilter
+{
+    // Bit i for words of length i, the last bit for all longer ones
+    uint64_t lengths = 0;
+    std::array<uint64_t, 4> first_bytes{};
+
+    static constexpr size_t LengthBit(size_t length)
+    {
+        return length < 63U ? length : 63U;
+    }
+
+    constexpr void Add(std::string_view word)
+    {
+        lengths |= uint64_t{1} << LengthBit(word.size());
+        const auto first = static_cast<unsigned char>(word[0]);
+        first_bytes[first / 64U] |= uint64_t{1} << (first % 64U);
+    }
+
+    constexpr bool MayContain(std::string_view word) const
+    {
+        if (word.empty() || (lengths & (uint64_t{1} << LengthBit(word.size()))) == 0U)
+        {
+            return false;
+        }
+        const auto first = static_cast<unsigned char>(word[0]);
+        return (first_bytes[first / 64U] & (uint64_t{1} << (first % 64U))) != 0U;
+    }
+};
+
+// Fills seeds (one per bucket, N buckets for N words) and slots (the index
+// of the word in every slot). Larger buckets are placed first, while most
+// slots are still free. The remaining arguments are scratch space of N
+// elements. Returns false if some bucket found no seed, which happens for
+// repeated words.
+template <typename Words, typename Hashes, typename Indexes, typename Seeds, typename Flags>
+constexpr bool Build(const Words &words,
+                     Hashes &hashes,
+                     Seeds &seeds,
+                     Indexes &slots,
+                     Indexes &order,
+                     Indexes &bucket_sizes,
+                     Flags &taken)
+{
+    const size_t count = words.size();
+    for (size_t ii = 0; ii < count; ++ii)
+    {
+        hashes[ii] = HashWord(words[ii]);
+        ++bucket_sizes[hashes[ii] % count];
+        order[ii] = ii;
+    }
+
+    const auto is_placed_before = [&](size_t lhs, size_t rhs)
+    {
+        const size_t lhs_bucket = hashes[lhs] % count;
+        const size_t rhs_bucket = hashes[rhs] % count;
+        return bucket_sizes[lhs_bucket] != bucket_sizes[rhs_bucket]
+                ? bucket_sizes[lhs_bucket] > bucket_sizes[rhs_bucket]
+                : lhs_bucket < rhs_bucket;
+    };
+    for (size_t ii = 1; ii < count; ++ii)
+    {
+        const size_t item = order[ii];
+        size_t position = ii;
+        for (; position > 0 && is_placed_before(item, order[position - 1U]); --position)
+        {
+            order[position] = order[position - 1U];
+        }
+        order[position] = item;
+    }
+
+    for (size_t begin = 0; begin < count;)
+    {
+        const size_t bucket = hashes[order[begin]] % count;
+        const size_t end = begin + bucket_sizes[bucket];
+
+        uint32_t seed = 0;
+        for (; seed < MAX_SEED; ++seed)
+        {
+            size_t placed = begin;
+            for (; placed < end; ++placed)
+            {
+                const size_t slot = GetSlot(hashes[order[placed]], seed, count);
+                if (taken[slot])
+                {
+                    break;
+                }
+                taken[slot] = true;
+                slots[slot] = order[placed];
+            }
+            if (placed == end)
+            {
+                break;
+            }
+            for (size_t ii = begin; ii < placed; ++ii)
+            {
+                taken[GetSlot(hashes[order[ii]], seed, count)] = false;
+            }
+        }
+        if (seed == MAX_SEED)
+        {
+            return false;
+        }
+
+        seeds[bucket] = seed;
+        begin = end;
+    }
+    return true;
+}
+}
+
+// Stop words known at compile time: the perfect hash is built by the
+// compiler, e.g. constexpr auto table = MakeStopWordTable({"in"sv, "the"sv});
+template <size_t N>
+class StaticStopWordTable
+{
+public:
+    constexpr explicit StaticStopWordTable(const std::string_view (&words)[N])
+    {
+        std::array<std::string_view, N> source{};
+        for (size_t ii = 0; ii < N; ++ii)
+        {
+            if (words[ii].empty())
+            {
+                throw std::invalid_argument("Stop word is empty");
+            }
+            source[ii] = words[ii];
+            filter_.Add(words[ii]);
+        }
+
+        std::array<uint64_t, N> hashes{};
+        std::array<size_t, N> slots{};
+        std::array<size_t, N> order{};
+        std::array<size_t, N> bucket_sizes{};
+        std::array<bool, N> taken{};
+        if (!perfect_hash::Build(source, hashes, seeds_, slots, order, bucket_sizes, taken))
+        {
+            throw std::invalid_argument("Stop words are repeated");
+        }
+        for (size_t ii = 0; ii < N; ++ii)
+        {
+            words_[ii] = source[slots[ii]];
+        }
+    }
+
+    constexpr bool Contains(std::string_view word) const
+    {
+        if (!filter_.MayContain(word))
+        {
+            return false;
+        }
+        const uint64_t hash = HashWord(word);
+        return words_[perfect_hash::GetSlot(hash, seeds_[hash % N], N)] == word;
+    }
+
+    // The layout StopWordSet copies instead of hashing again
+    constexpr const perfect_hash::WordFilter &GetFilter() const
+    {
+        return filter_;
+    }
+
+    constexpr const std::array<std::string_view, N> &GetWords() const
+    {
+        return words_;
+    }
+
+    constexpr const std::array<uint32_t, N> &GetSeeds() const
+    {
+        return seeds_;
+    }
+
+private:
+    perfect_hash::WordFilter filter_;
+    std::array<std::string_view, N> words_{};
+    std::array<uint32_t, N> seeds_{};
+};
+
+template <size_t N>
+constexpr StaticStopWordTable<N> MakeStopWordTable(const std::string_view (&words)[N])
+{
+    return StaticStopWordTable<N>(words);
+}
+
+class StopWordSet
+{
+public:
+    StopWordSet() = default;
+
+    // Empty and repeated words are dropped
+    explicit StopWordSet(std::vector<std::string> words);
+
+    template <typename StringContainer>
+    explicit StopWordSet(const StringContainer &words);
+
+    template <size_t N>
+    explicit StopWordSet(const StaticStopWordTable<N> &table);
+
+    bool Contains(std::string_view word) const
+    {
+        if (!filter_.MayContain(word))
+        {
+            return false;
+        }
+        const uint64_t hash = HashWord(word);
+        return words_[perfect_hash::GetSlot(hash, seeds_[hash % words_.size()],
+                                            words_.size())] == word;
+    }
+
+    size_t size() const;
+
+    // In slot order
+    std::vector<std::string>::const_iterator begin() const;
+
+    std::vector<std::string>::const_iterator end() const;
+
+private:
+    perfect_hash::WordFilter filter_;
+    std::vector<std::string> words_;
+    std::vector<uint32_t> seeds_;
+};
+
+template <typename StringContainer>
+StopWordSet::StopWordSet(const StringContainer &words)
+{
+    const auto unique_words = MakeUniqueNonEmptyStrings(words);
+    *this = StopWordSet(std::vector<std::string>(unique_words.begin(), unique_words.end()));
+}
+
+template <size_t N>
+StopWordSet::StopWordSet(const StaticStopWordTable<N> &table)
+    : filter_(table.GetFilter()),
+      words_(table.GetWords().begin(), table.GetWords().end()),
+      seeds_(table.GetSeeds().begin(), table.GetSeeds().end())
+{
+
+}
+
+#endif // STOP_WORD_SET_H
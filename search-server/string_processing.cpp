@@ -29,6 +29,13 @@ std::vector<std::string> SplitIntoWords(const std::string& text)
 std::vector<std::string_view> SplitIntoWords(std::string_view text)
 {
     std::vector<std::string_view> words;
+    SplitIntoWords(text, words);
+    return words;
+}
+
+void SplitIntoWords(std::string_view text, std::vector<std::string_view> &words)
+{
+    words.clear();
 
     int64_t pos = text.find_first_not_of(' ');
     const int64_t pos_end = std::string_view::npos;
@@ -40,6 +47,4 @@ std::vector<std::string_view> SplitIntoWords(std::string_view text)
                             text.substr(pos) : text.substr(pos, space - pos));
         pos = text.find_first_not_of(' ', space);
     }
-
-    return words;
 }
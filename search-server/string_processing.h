@@ -7,6 +7,9 @@ std::vector<std::string> SplitIntoWords(const std::string& text);
 
 std::vector<std::string_view> SplitIntoWords(std::string_view text);
 
+// Replaces the contents of words, reusing its capacity
+void SplitIntoWords(std::string_view text, std::vector<std::string_view> &words);
+
 template <typename stringContainer>
 std::set<std::string, std::less<>>
 MakeUniqueNonEmptyStrings(const stringContainer& strings)
@@ -0,0 +1,229 @@
+#include "term_dictionary.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+void AppendVarint(std::pmr::string &output, uint32_t value)
+{
+    while (value >= 0x80U)
+    {
+        output.push_back(static_cast<char>((value & 0x7FU) | 0x80U));
+        value >>= 7U;
+    }
+    output.push_back(static_cast<char>(value));
+}
+
+uint32_t ReadVarint(std::string_view input, size_t &position)
+{
+    uint32_t value = 0;
+    for (uint32_t shift = 0;; shift += 7U)
+    {
+        const auto bits = static_cast<uint32_t>(static_cast<unsigned char>(input[position++]));
+        value |= (bits & 0x7FU) << shift;
+        if ((bits & 0x80U) == 0U)
+        {
+            return value;
+        }
+    }
+}
+
+// Heterogeneous erase of std::set only comes with C++23
+bool EraseTerm(std::pmr::set<std::pmr::string, std::less<>> &terms, std::string_view term)
+{
+    const auto it = terms.find(term);
+    if (it == terms.end())
+    {
+        return false;
+    }
+    terms.erase(it);
+    return true;
+}
+
+bool StartsWith(std::string_view text, std::string_view prefix)
+{
+    return text.substr(0, prefix.size()) == prefix;
+}
+}
+
+TermDictionary::TermDictionary(std::pmr::memory_resource *resource) :
+    encoded_(resource),
+    block_offsets_(resource),
+    inserted_(resource),
+    erased_(resource)
+{
+
+}
+
+template <typename Callback>
+void TermDictionary::ForEachInBlocks(std::string_view prefix, Callback on_term) const
+{
+    if (block_offsets_.empty())
+    {
+        return;
+    }
+
+    const std::string_view encoded = encoded_;
+    std::string term;
+    const size_t block = FindBlock(prefix);
+    size_t position = block_offsets_[block];
+    for (size_t index = block * BLOCK_SIZE; index < block_term_count_; ++index)
+    {
+        const uint32_t shared = index % BLOCK_SIZE == 0U ? 0U : ReadVarint(encoded, position);
+        const uint32_t suffix = ReadVarint(encoded, position);
+        term.resize(shared);
+        term.append(encoded.substr(position, suffix));
+        position += suffix;
+        if (!on_term(term))
+        {
+            return;
+        }
+    }
+}
+
+void TermDictionary::Insert(std::string_view term)
+{
+    if (!EraseTerm(erased_, term) && !ContainsInBlocks(term))
+    {
+        inserted_.emplace(term);
+    }
+    MergePending();
+}
+
+void TermDictionary::Erase(std::string_view term)
+{
+    if (!EraseTerm(inserted_, term) && ContainsInBlocks(term))
+    {
+        erased_.emplace(term);
+    }
+    MergePending();
+}
+
+bool TermDictionary::Contains(std::string_view term) const
+{
+    if (inserted_.count(term) != 0U)
+    {
+        return true;
+    }
+    return erased_.count(term) == 0U && ContainsInBlocks(term);
+}
+
+size_t TermDictionary::GetSize() const
+{
+    return block_term_count_ - erased_.size() + inserted_.size();
+}
+
+void TermDictionary::ForEachWithPrefix(std::string_view prefix,
+                                       const std::function<void(std::string_view)> &on_term) const
+{
+    // Both sources are sorted, so they merge in one pass
+    auto inserted = inserted_.lower_bound(prefix);
+    auto erased = erased_.lower_bound(prefix);
+    ForEachInBlocks(prefix, [&](std::string_view term)
+    {
+        if (term < prefix)
+        {
+            return true;
+        }
+        if (!StartsWith(term, prefix))
+        {
+            return false;
+        }
+        for (; inserted != inserted_.end() && *inserted < term; ++inserted)
+        {
+            on_term(*inserted);
+        }
+        while (erased != erased_.end() && *erased < term)
+        {
+            ++erased;
+        }
+        if (erased == erased_.end() || *erased != term)
+        {
+            on_term(term);
+        }
+        return true;
+    });
+    for (; inserted != inserted_.end() && StartsWith(*inserted, prefix); ++inserted)
+    {
+        on_term(*inserted);
+    }
+}
+
+size_t TermDictionary::FindBlock(std::string_view term) const
+{
+    size_t first = 0;
+    size_t last = block_offsets_.size();
+    while (last - first > 1U)
+    {
+        const size_t middle = first + (last - first) / 2U;
+        if (GetFirstTerm(middle) <= term)
+        {
+            first = middle;
+        }
+        else
+        {
+            last = middle;
+        }
+    }
+    return first;
+}
+
+std::string_view TermDictionary::GetFirstTerm(size_t block) const
+{
+    size_t position = block_offsets_[block];
+    const uint32_t size = ReadVarint(encoded_, position);
+    return std::string_view{encoded_}.substr(position, size);
+}
+
+bool TermDictionary::ContainsInBlocks(std::string_view term) const
+{
+    bool is_found = false;
+    ForEachInBlocks(term, [term, &is_found](std::string_view block_term)
+    {
+        is_found = block_term == term;
+        return block_term < term;
+    });
+    return is_found;
+}
+
+void TermDictionary::MergePending()
+{
+    const size_t pending_count = inserted_.size() + erased_.size();
+    if (pending_count < std::max(MIN_PENDING_COUNT, block_term_count_ / PENDING_DIVISOR))
+    {
+        return;
+    }
+
+    std::pmr::string encoded(encoded_.get_allocator());
+    std::pmr::vector<uint32_t> block_offsets(block_offsets_.get_allocator());
+    size_t term_count = 0;
+    std::string previous;
+    ForEachWithPrefix({}, [&](std::string_view term)
+    {
+        if (term_count % BLOCK_SIZE == 0U)
+        {
+            block_offsets.push_back(static_cast<uint32_t>(encoded.size()));
+            AppendVarint(encoded, static_cast<uint32_t>(term.size()));
+            encoded.append(term);
+        }
+        else
+        {
+            const size_t shared = std::mismatch(previous.begin(), previous.end(),
+                                                term.begin(), term.end()).first - previous.begin();
+            AppendVarint(encoded, static_cast<uint32_t>(shared));
+            AppendVarint(encoded, static_cast<uint32_t>(term.size() - shared));
+            encoded.append(term.substr(shared));
+        }
+        previous = term;
+        ++term_count;
+    });
+
+    encoded.shrink_to_fit();
+    block_offsets.shrink_to_fit();
+    encoded_ = std::move(encoded);
+    block_offsets_ = std::move(block_offsets);
+    block_term_count_ = term_count;
+    inserted_.clear();
+    erased_.clear();
+}
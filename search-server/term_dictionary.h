@@ -0,0 +1,64 @@
+#ifndef TERM_DICTIONARY_H
+#define TERM_DICTIONARY_H
+
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Sorted set of terms for ordered prefix enumeration, a few bytes per term.
+// Most terms live in front-coded blocks: every block of BLOCK_SIZE terms
+// starts with a full term, and the others keep only the suffix that differs
+// from their predecessor. Inserted and erased terms wait in small sorted
+// sets and are merged into new blocks once they make up a fraction of the
+// whole, so a change costs a constant amortized number of term copies.
+class TermDictionary
+{
+public:
+    explicit TermDictionary(std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+    void Insert(std::string_view term);
+
+    void Erase(std::string_view term);
+
+    bool Contains(std::string_view term) const;
+
+    size_t GetSize() const;
+
+    // Calls on_term in ascending order for every term starting with prefix;
+    // the view is valid during the call only
+    void ForEachWithPrefix(std::string_view prefix,
+                           const std::function<void(std::string_view)> &on_term) const;
+
+private:
+    static constexpr size_t BLOCK_SIZE = 16;
+    // Pending changes merge at MIN_PENDING_COUNT or at this fraction of the blocks
+    static constexpr size_t MIN_PENDING_COUNT = 64;
+    static constexpr size_t PENDING_DIVISOR = 8;
+
+    // The block that would hold term: the last one starting at or before it
+    size_t FindBlock(std::string_view term) const;
+
+    std::string_view GetFirstTerm(size_t block) const;
+
+    bool ContainsInBlocks(std::string_view term) const;
+
+    // Terms of the blocks from the one that may hold prefix on, until
+    // on_term returns false
+    template <typename Callback>
+    void ForEachInBlocks(std::string_view prefix, Callback on_term) const;
+
+    void MergePending();
+
+    std::pmr::string encoded_;
+    std::pmr::vector<uint32_t> block_offsets_;
+    size_t block_term_count_ = 0;
+    std::pmr::set<std::pmr::string, std::less<>> inserted_;
+    // Terms of the blocks that are no longer in the dictionary
+    std::pmr::set<std::pmr::string, std::less<>> erased_;
+};
+
+#endif // TERM_DICTIONARY_H
@@ -2,13 +2,32 @@
 
 #include <iostream>
 #include <cmath>
+#include <fstream>
+#include <sstream>
+
+#include <thread>
+
+#include <sys/socket.h>
+#include <unistd.h>
 
 #include "search_server.h"
+#include "allocation_counter.h"
+#include "concurrent_request_queue.h"
+#include "corpus_loader.h"
+#include "counting_memory_resource.h"
 #include "request_queue.h"
 #include "paginator.h"
+#include "near_duplicates.h"
+#include "profiler.h"
+#include "query_server.h"
+#include "sharded_search_server.h"
+#include "shard_coordinator.h"
+#include "shard_server.h"
+#include "term_dictionary.h"
 #include "remove_duplicates.h"
 
 using namespace std;
+using namespace std::literals::chrono_literals;
 
 template <typename Key, typename Value>
 void Print(std::ostream& out, const map<Key, Value>& container)
@@ -659,6 +678,1307 @@ void TestRemoveDuplicates()
                 "Некорректно удаляются дупликаты документов");
 }
 
+void TestSubmitQuery()
+{
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(1, "funny pet and nasty rat"s,
+                              DocumentStatus::ACTUAL, {7, 2, 7});
+    search_server.AddDocument(2, "funny pet with curly hair"s,
+                              DocumentStatus::ACTUAL, {1, 2, 3});
+    search_server.AddDocument(3, "big cat nasty hair"s,
+                              DocumentStatus::BANNED, {1, 2, 8});
+
+    {
+        auto future = search_server.SubmitQuery("curly nasty cat"s);
+        const vector<Document> expected =
+                search_server.FindTopDocuments("curly nasty cat"s);
+        const vector<Document> result = future.get();
+        ASSERT_EQUAL_HINT(result.size(), expected.size(),
+                          "Асинхронный запрос вернул другое число документов"s);
+        for (size_t ii = 0; ii < result.size(); ++ii)
+        {
+            ASSERT_EQUAL(result[ii].id, expected[ii].id);
+        }
+    }
+
+    {
+        const vector<Document> result =
+                search_server.SubmitQuery("nasty cat"s, DocumentStatus::BANNED).get();
+        ASSERT_HINT(result.size() == 1 && result[0].id == 3,
+                    "Асинхронный запрос не учитывает статус документа"s);
+    }
+
+    {
+        QueryOptions options;
+        options.cancellation = CancellationToken{};
+        options.cancellation->Cancel();
+        auto future = search_server.SubmitQuery("curly"s, options);
+        bool cancelled = false;
+        try
+        {
+            future.get();
+        }
+        catch (const QueryCancelled&)
+        {
+            cancelled = true;
+        }
+        ASSERT_HINT(cancelled, "Отменённый запрос не был прерван"s);
+    }
+
+    {
+        QueryOptions options;
+        options.deadline = QueryOptions::Clock::now() - 1ms;
+        auto future = search_server.SubmitQuery("curly"s, options);
+        bool expired = false;
+        try
+        {
+            future.get();
+        }
+        catch (const QueryDeadlineExceeded&)
+        {
+            expired = true;
+        }
+        ASSERT_HINT(expired, "Запрос с истёкшим сроком не был прерван"s);
+    }
+}
+
+void TestBudgetedFindTopDocuments()
+{
+    SearchServer search_server("and with"s);
+    for (int id = 0; id < 300; ++id)
+    {
+        search_server.AddDocument(id,
+                                  id % 3 == 0 ? "funny pet and nasty rat"s :
+                                                "curly hair with curly rat tail"s,
+                                  DocumentStatus::ACTUAL, {id % 10});
+    }
+    search_server.EnableImpactOrderedPostings();
+    search_server.AddDocument(300, "nasty nasty nasty cat"s,
+                              DocumentStatus::ACTUAL, {1});
+
+    const vector<Document> expected = search_server.FindTopDocuments("nasty curly -cat"s);
+
+    {
+        const BudgetedSearchResult result =
+                search_server.FindTopDocuments("nasty curly -cat"s, SearchBudget{});
+        ASSERT_HINT(result.is_exact,
+                    "Запрос без ограничений должен быть точным"s);
+        ASSERT_EQUAL(result.documents.size(), expected.size());
+        for (size_t ii = 0; ii < expected.size(); ++ii)
+        {
+            ASSERT(abs(result.documents[ii].relevance - expected[ii].relevance) < 1e-6);
+            ASSERT_EQUAL(result.documents[ii].rating, expected[ii].rating);
+        }
+    }
+
+    {
+        SearchBudget budget;
+        budget.max_postings = 64;
+        const BudgetedSearchResult result =
+                search_server.FindTopDocuments("nasty curly"s, budget);
+        ASSERT_HINT(!result.is_exact,
+                    "Исчерпание бюджета должно помечать результат как приближённый"s);
+        ASSERT_EQUAL(result.processed_postings, 64U);
+        ASSERT_HINT(!result.documents.empty() && result.documents[0].id == 300,
+                    "Сегменты с наибольшим вкладом должны обрабатываться первыми"s);
+    }
+
+    {
+        SearchBudget budget;
+        budget.max_postings = 70;
+        const BudgetedSearchResult result =
+                search_server.FindTopDocuments("nasty curly"s, budget);
+        ASSERT_HINT(!result.is_exact && result.processed_postings == 70U,
+                    "Бюджет не должен превышаться внутри сегмента"s);
+    }
+
+    search_server.RemoveDocument(300);
+    ASSERT(search_server.FindTopDocuments("nasty"s, SearchBudget{}).documents[0].id != 300);
+}
+
+void TestDuplicatePolicy()
+{
+    {
+        SearchServer search_server("and with"s);
+        search_server.SetDuplicatePolicy(DuplicatePolicy::FLAG);
+        search_server.AddDocument(1, "funny pet and nasty rat"s,
+                                  DocumentStatus::ACTUAL, {7, 2, 7});
+        search_server.AddDocument(2, "nasty rat with funny funny pet"s,
+                                  DocumentStatus::ACTUAL, {1, 2});
+        search_server.AddDocument(3, "funny pet with curly hair"s,
+                                  DocumentStatus::ACTUAL, {1, 2});
+
+        ASSERT_HINT(!search_server.IsFlaggedDuplicate(1) &&
+                    search_server.IsFlaggedDuplicate(2) &&
+                    !search_server.IsFlaggedDuplicate(3),
+                    "Некорректно помечаются дубликаты при добавлении"s);
+        ASSERT_EQUAL(search_server.FindDuplicates(execution::par), vector<int>{2});
+
+        search_server.RemoveDocument(1);
+        ASSERT_HINT(search_server.FindDuplicates().empty(),
+                    "Удаление документа не обновляет индекс отпечатков"s);
+        ASSERT_HINT(!search_server.IsFlaggedDuplicate(2),
+                    "После удаления оригинала пометка снимается"s);
+
+        // Оригинал с меньшим id, добавленный позже, снимает пометку с себя
+        search_server.AddDocument(0, "pet rat funny nasty"s, DocumentStatus::ACTUAL, {1});
+        ASSERT_HINT(!search_server.IsFlaggedDuplicate(0) && search_server.IsFlaggedDuplicate(2),
+                    "Помечается дубликат с большим id"s);
+        ASSERT_EQUAL(search_server.FindDuplicates(), vector<int>{2});
+    }
+
+    {
+        SearchServer search_server("and with"s);
+        search_server.SetDuplicatePolicy(DuplicatePolicy::REJECT);
+        search_server.AddDocument(1, "funny pet and nasty rat"s,
+                                  DocumentStatus::ACTUAL, {7, 2, 7});
+        bool rejected = false;
+        try
+        {
+            search_server.AddDocument(2, "rat nasty pet funny"s,
+                                      DocumentStatus::ACTUAL, {1, 2});
+        }
+        catch (const invalid_argument&)
+        {
+            rejected = true;
+        }
+        ASSERT_HINT(rejected && search_server.GetDocumentCount() == 1,
+                    "Дубликат должен быть отклонён при добавлении"s);
+        search_server.AddDocument(2, "funny pet"s, DocumentStatus::ACTUAL, {1});
+        ASSERT_EQUAL(search_server.GetDocumentCount(), 2);
+    }
+}
+
+void TestNearDuplicates()
+{
+    SearchServer search_server("and with"s);
+    const string base = "alpha bravo charlie delta echo foxtrot golf hotel india "
+                        "juliett kilo lima mike november oscar papa quebec romeo "
+                        "sierra tango"s;
+    search_server.AddDocument(1, base, DocumentStatus::ACTUAL, {1});
+    // отличается одним словом, похожесть по Жаккару 20 / 21
+    search_server.AddDocument(2, base + " uniform"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(3, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(4, base + " victor"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(5, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1});
+
+    const vector<vector<int>> clusters = FindNearDuplicateClusters(search_server);
+    ASSERT_EQUAL_HINT(clusters.size(), 1U,
+                      "Некорректно находятся почти-дубликаты"s);
+    ASSERT_EQUAL(clusters[0], (vector<int>{1, 2, 4}));
+
+    RemoveNearDuplicates(search_server);
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 3);
+
+    for (const NearDuplicateOptions &options : {NearDuplicateOptions{0, 32, 0.8},
+                                                NearDuplicateOptions{128, 32, 0.0},
+                                                NearDuplicateOptions{128, 32, 1.5}})
+    {
+        try
+        {
+            FindNearDuplicateClusters(search_server, options);
+            ASSERT_HINT(false, "Некорректные параметры отклоняются"s);
+        }
+        catch (const invalid_argument&)
+        {
+        }
+    }
+}
+
+void TestConcurrentRequestQueue()
+{
+    SearchServer search_server("and in at"s);
+    search_server.AddDocument(1, "curly cat curly tail"s,
+                              DocumentStatus::ACTUAL, {7, 2, 7});
+    search_server.AddDocument(2, "curly dog and fancy collar"s,
+                              DocumentStatus::ACTUAL, {1, 2, 3});
+    ConcurrentRequestQueue request_queue(search_server);
+
+    // 4 потока по 300 запросов, половина с нулевым результатом
+    vector<thread> producers;
+    for (int ii = 0; ii < 4; ++ii)
+    {
+        producers.emplace_back([&request_queue]()
+        {
+            for (int jj = 0; jj < 150; ++jj)
+            {
+                request_queue.AddFindRequest("empty request"s);
+                request_queue.RecordRequest(2);
+            }
+        });
+    }
+    for (thread &producer : producers)
+    {
+        producer.join();
+    }
+
+    ASSERT_EQUAL_HINT(request_queue.GetNoResultRequests(), 600,
+                      "Некорректно считаются запросы из нескольких потоков"s);
+    ASSERT_EQUAL(request_queue.GetTotalRequests(), 1200U);
+
+    // окно в 1440 запросов: вытесняются самые старые
+    for (int ii = 0; ii < 1440; ++ii)
+    {
+        request_queue.AddFindRequest("curly dog"s);
+    }
+    ASSERT_EQUAL_HINT(request_queue.GetNoResultRequests(), 0,
+                      "Старые запросы не вытесняются из окна"s);
+    request_queue.AddFindRequest("sparrow"s);
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), 1);
+}
+
+void TestRequestLatencyStats()
+{
+    {
+        LatencyHistogram histogram;
+        for (uint64_t value = 1; value <= 1000; ++value)
+        {
+            histogram.Record(value * 1000);
+        }
+        const uint64_t p50 = histogram.GetPercentile(50.0);
+        const uint64_t p99 = histogram.GetPercentile(99.0);
+        ASSERT_HINT(p50 > 500000 * 0.94 && p50 < 500000 * 1.06,
+                    "Некорректно вычисляется медиана гистограммы"s);
+        ASSERT_HINT(p99 > 990000 * 0.94 && p99 < 990000 * 1.06,
+                    "Некорректно вычисляется 99-й перцентиль гистограммы"s);
+    }
+
+    SearchServer search_server("and in at"s);
+    RequestQueue request_queue(search_server);
+
+    const auto start = RequestStatistics::Clock::now();
+    // 90 запросов за первые 90 секунд, каждый десятый без результата
+    for (int ii = 0; ii < 90; ++ii)
+    {
+        request_queue.RecordRequest(start + ii * 1s, (ii + 1) * 1ms, ii % 10 == 0 ? 0 : 3);
+    }
+
+    const auto now = start + 90s;
+    const LatencyStats minute = request_queue.GetLatencyStats(StatsWindow::MINUTE, now);
+    const LatencyStats five_minutes =
+            request_queue.GetLatencyStats(StatsWindow::FIVE_MINUTES, now);
+
+    ASSERT_HINT(minute.request_count >= 59 && minute.request_count <= 61,
+                "Минутное окно содержит запросы старше минуты"s);
+    ASSERT_EQUAL(five_minutes.request_count, 90U);
+    ASSERT(abs(five_minutes.zero_result_rate - 0.1) < 1e-9);
+    ASSERT(abs(five_minutes.queries_per_second - 1.0) < 1e-9);
+    ASSERT_HINT(five_minutes.p99 >= 84ms && five_minutes.p99 <= 96ms,
+                "Некорректно вычисляется 99-й перцентиль задержки"s);
+    ASSERT_HINT(minute.p50 > five_minutes.p50,
+                "Медиана минутного окна должна учитывать только свежие запросы"s);
+
+    const LatencyStats later =
+            request_queue.GetLatencyStats(StatsWindow::MINUTE, now + 10min);
+    ASSERT_EQUAL(later.request_count, 0U);
+}
+
+void TestProfiler()
+{
+    Profiler::Reset();
+    for (int ii = 0; ii < 3; ++ii)
+    {
+        ProfileScope outer("TestOuter");
+        ProfileScope inner("TestInner");
+    }
+    thread([]()
+    {
+        ProfileScope outer("TestOuter");
+    }).join();
+
+    const vector<ScopeStats> stats = Profiler::GetScopeStats();
+    map<string, uint64_t> counts;
+    for (const ScopeStats &scope : stats)
+    {
+        counts[scope.path] = scope.count;
+        ASSERT(scope.min <= scope.p50 && scope.p50 <= scope.max);
+    }
+    ASSERT_EQUAL_HINT(counts["TestOuter"s], 4U,
+                      "Некорректно агрегируются события из разных потоков"s);
+    ASSERT_EQUAL_HINT(counts["TestOuter/TestInner"s], 3U,
+                      "Некорректно отслеживается вложенность областей"s);
+
+    ostringstream trace;
+    Profiler::WriteChromeTrace(trace);
+    ASSERT(trace.str().find("\"name\":\"TestInner\""s) != string::npos);
+    ASSERT(trace.str().rfind("{\"traceEvents\":["s, 0) == 0U);
+    Profiler::Reset();
+}
+
+void TestGetWordFrequencies()
+{
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(1, "funny pet and nasty rat"s,
+                              DocumentStatus::ACTUAL, {7, 2, 7});
+    search_server.AddDocument(2, "curly curly hair"s,
+                              DocumentStatus::ACTUAL, {1, 2});
+
+    const auto first = search_server.GetWordFrequencies(1);
+    const auto second = search_server.GetWordFrequencies(2);
+    ASSERT_EQUAL_HINT(first.size(), 4,
+                      "Повторный вызов GetWordFrequencies изменил ранее полученный результат"s);
+    ASSERT_EQUAL(second.size(), 2);
+    ASSERT(abs(second.begin()->second - 2.0 / 3.0) < 1e-6);
+    ASSERT(search_server.GetWordFrequencies(42).empty());
+
+    vector<thread> readers;
+    vector<size_t> word_counts(4);
+    for (size_t ii = 0; ii < word_counts.size(); ++ii)
+    {
+        readers.emplace_back([&search_server, &word_counts, ii]()
+        {
+            for (int jj = 0; jj < 1000; ++jj)
+            {
+                word_counts[ii] += search_server.GetWordFrequencies(1 + jj % 2).size();
+            }
+        });
+    }
+    for (thread &reader : readers)
+    {
+        reader.join();
+    }
+    for (const size_t word_count : word_counts)
+    {
+        ASSERT_EQUAL(word_count, 3000U);
+    }
+}
+
+void TestMatchDocuments()
+{
+    SearchServer search_server("и в на"s);
+    search_server.AddDocument(0, "белый кот и модный ошейник"s,
+                              DocumentStatus::ACTUAL, {});
+    search_server.AddDocument(1, "пушистый кот пушистый хвост"s,
+                              DocumentStatus::IRRELEVANT, {});
+    search_server.AddDocument(3, "ухоженный скворец евгений"s,
+                              DocumentStatus::BANNED, {});
+
+    const vector<int> ids = {3, 1, 0};
+    for (const auto &results : {search_server.MatchDocuments("пушистый кот -ошейник"s, ids),
+                                search_server.MatchDocuments(execution::par,
+                                                             "пушистый кот -ошейник"s, ids)})
+    {
+        ASSERT_EQUAL(results.size(), ids.size());
+        for (size_t ii = 0; ii < ids.size(); ++ii)
+        {
+            const auto [expected_words, expected_status] =
+                    search_server.MatchDocument("пушистый кот -ошейник"s, ids[ii]);
+            const auto &[words, status] = results[ii];
+            ASSERT_EQUAL_HINT(words, expected_words,
+                              "MatchDocuments расходится с MatchDocument"s);
+            ASSERT(status == expected_status);
+        }
+        ASSERT_EQUAL(get<0>(results[1]), (vector<string_view>{"кот"sv, "пушистый"sv}));
+        ASSERT(get<0>(results[2]).empty());
+    }
+
+    bool thrown = false;
+    try
+    {
+        search_server.MatchDocuments("кот"s, {0, 2});
+    }
+    catch (const out_of_range&)
+    {
+        thrown = true;
+    }
+    ASSERT_HINT(thrown, "Ожидается исключение для несуществующего документа"s);
+}
+
+void TestRemoveDocuments()
+{
+    const vector<string> texts = {"белый кот и модный ошейник"s,
+                                  "пушистый кот пушистый хвост"s,
+                                  "ухоженный пёс выразительные глаза"s,
+                                  "ухоженный скворец евгений"s,
+                                  "белый пёс и пушистый хвост"s};
+
+    for (const bool impact_ordered : {false, true})
+    {
+        SearchServer seq_server("и в на"s);
+        SearchServer par_server("и в на"s);
+        SearchServer single_server("и в на"s);
+        SearchServer expected_server("и в на"s);
+        for (int id = 0; id < static_cast<int>(texts.size()); ++id)
+        {
+            seq_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+            par_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+            single_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+            if (id == 1 || id == 4)
+            {
+                expected_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+            }
+        }
+        if (impact_ordered)
+        {
+            seq_server.EnableImpactOrderedPostings();
+            par_server.EnableImpactOrderedPostings();
+            single_server.EnableImpactOrderedPostings();
+        }
+
+        // Документы 0 и 2 первыми добавили слова "белый", "кот" и "пёс"
+        seq_server.RemoveDocuments({3, 0, 42, 2, 0});
+        par_server.RemoveDocuments(execution::par, {3, 0, 42, 2, 0});
+        single_server.RemoveDocument(3);
+        single_server.RemoveDocument(0);
+        single_server.RemoveDocument(42);
+        single_server.RemoveDocument(execution::par, 2);
+
+        for (const SearchServer *server : {&seq_server, &par_server, &single_server})
+        {
+            ASSERT_EQUAL(server->GetDocumentCount(), 2);
+            ASSERT_EQUAL(vector<int>(server->begin(), server->end()), (vector<int>{1, 4}));
+
+            for (const string &query : {"белый кот"s, "пёс хвост"s, "ухоженный скворец"s})
+            {
+                const auto found = server->FindTopDocuments(query);
+                const auto expected = expected_server.FindTopDocuments(query);
+                ASSERT_EQUAL_HINT(found.size(), expected.size(),
+                                  "После удаления найдено неверное число документов"s);
+                for (size_t ii = 0; ii < found.size(); ++ii)
+                {
+                    ASSERT_EQUAL(found[ii].id, expected[ii].id);
+                    ASSERT(abs(found[ii].relevance - expected[ii].relevance) < 1e-6);
+                }
+                const auto budgeted = server->FindTopDocuments(query, SearchBudget{});
+                ASSERT_EQUAL(budgeted.documents.size(), expected.size());
+            }
+        }
+    }
+}
+
+void TestShardedSearchServer()
+{
+    const vector<string> texts = {"белый кот и модный ошейник"s,
+                                  "пушистый кот пушистый хвост"s,
+                                  "ухоженный пёс выразительные глаза"s,
+                                  "ухоженный скворец евгений"s,
+                                  "белый пёс и пушистый хвост"s,
+                                  "большой кот модный хвост"s,
+                                  "скворец и кот"s};
+
+    SearchServer search_server("и в на"s);
+    ShardedSearchServer sharded_server("и в на"s, 3);
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id)
+    {
+        search_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id % 3});
+        sharded_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id % 3});
+    }
+    ASSERT_EQUAL(sharded_server.GetDocumentCount(), search_server.GetDocumentCount());
+
+    size_t non_empty_shards = 0;
+    for (size_t ii = 0; ii < sharded_server.GetShardCount(); ++ii)
+    {
+        non_empty_shards += sharded_server.GetShard(ii).GetDocumentCount() > 0 ? 1 : 0;
+    }
+    ASSERT_HINT(non_empty_shards > 1U, "Документы должны распределяться по шардам"s);
+
+    const auto check_same_ranking = [&search_server, &sharded_server](const string &query)
+    {
+        const auto expected = search_server.FindTopDocuments(query);
+        const auto found = sharded_server.FindTopDocuments(query);
+        ASSERT_EQUAL_HINT(found.size(), expected.size(), query);
+        for (size_t ii = 0; ii < found.size(); ++ii)
+        {
+            ASSERT_HINT(abs(found[ii].relevance - expected[ii].relevance) < 1e-6,
+                        "Релевантность должна совпадать с нешардированным сервером"s);
+            ASSERT_EQUAL(found[ii].rating, expected[ii].rating);
+        }
+    };
+    for (const string &query : {"белый кот"s, "пушистый хвост -пёс"s, "скворец"s,
+                               "модный ухоженный кот хвост"s})
+    {
+        check_same_ranking(query);
+    }
+
+    ASSERT_EQUAL(get<0>(sharded_server.MatchDocument("кот хвост"s, 1)),
+                 get<0>(search_server.MatchDocument("кот хвост"s, 1)));
+
+    bool thrown = false;
+    try
+    {
+        sharded_server.AddDocument(3, "кот"s, DocumentStatus::ACTUAL, {});
+    }
+    catch (const invalid_argument&)
+    {
+        thrown = true;
+    }
+    ASSERT_HINT(thrown, "Повторный id должен отклоняться"s);
+
+    search_server.RemoveDocuments({0, 5});
+    sharded_server.RemoveDocuments({0, 5});
+    search_server.RemoveDocument(2);
+    sharded_server.RemoveDocument(2);
+    ASSERT_EQUAL(vector<int>(sharded_server.begin(), sharded_server.end()),
+                 vector<int>(search_server.begin(), search_server.end()));
+    check_same_ranking("белый кот"s);
+    check_same_ranking("ухоженный пёс хвост"s);
+}
+
+void TestShardedPrefixQueries()
+{
+    // 200 слов px0..px199 с разной частотой в разных шардах
+    SearchServer search_server(""s);
+    ShardedSearchServer sharded_server(""s, 4);
+    for (int id = 0; id < 400; ++id)
+    {
+        string text;
+        for (int ii = 0; ii < 6; ++ii)
+        {
+            text += "px"s + to_string((id * (ii + 3) + ii * ii * 7) % (10 + (id * 13) % 190)) + " "s;
+        }
+        search_server.AddDocument(id, text, DocumentStatus::ACTUAL, {id % 7});
+        sharded_server.AddDocument(id, text, DocumentStatus::ACTUAL, {id % 7});
+    }
+
+    for (const string &query : {"px*"s, "px1*"s, "px1* -px10*"s, "px5 px*"s})
+    {
+        const auto expected = search_server.FindTopDocuments(query);
+        const auto found = sharded_server.FindTopDocuments(query);
+        ASSERT_EQUAL_HINT(found.size(), expected.size(), query);
+        for (size_t ii = 0; ii < found.size(); ++ii)
+        {
+            ASSERT_EQUAL_HINT(found[ii].id, expected[ii].id, query);
+            ASSERT_HINT(abs(found[ii].relevance - expected[ii].relevance) < 1e-6,
+                        "Префикс раскрывается одинаково во всех шардах"s);
+        }
+    }
+}
+
+void TestShardCoordinator()
+{
+    const vector<string> texts = {"белый кот и модный ошейник"s,
+                                  "пушистый кот пушистый хвост"s,
+                                  "ухоженный пёс выразительные глаза"s,
+                                  "ухоженный скворец евгений"s,
+                                  "белый пёс и пушистый хвост"s,
+                                  "большой кот модный хвост"s,
+                                  "скворец и кот"s};
+
+    vector<unique_ptr<SearchServer>> shards;
+    vector<unique_ptr<ShardServer>> servers;
+    vector<thread> server_threads;
+    vector<string> addresses;
+    for (int ii = 0; ii < 2; ++ii)
+    {
+        addresses.push_back("unix:/tmp/search-server-test-"s + to_string(getpid()) +
+                            "-"s + to_string(ii) + ".sock"s);
+        shards.push_back(make_unique<SearchServer>("и в на"s));
+        servers.push_back(make_unique<ShardServer>(*shards.back(), addresses.back()));
+        server_threads.emplace_back([&server = *servers.back()]()
+        {
+            server.Run();
+        });
+    }
+
+    {
+        ShardCoordinator coordinator(addresses);
+        SearchServer search_server("и в на"s);
+        vector<RemoteDocument> documents;
+        for (int id = 0; id < static_cast<int>(texts.size()); ++id)
+        {
+            search_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id % 3});
+            documents.push_back({id, texts[id], DocumentStatus::ACTUAL, {id % 3}});
+        }
+        coordinator.AddDocuments(documents);
+        ASSERT_EQUAL(coordinator.GetDocumentCount(), search_server.GetDocumentCount());
+        ASSERT_HINT(shards[0]->GetDocumentCount() > 0 && shards[1]->GetDocumentCount() > 0,
+                    "Документы должны распределяться по шардам"s);
+
+        for (const string &query : {"белый кот"s, "пушистый хвост -пёс"s, "скворец"s,
+                                    "пуш* -пёс"s})
+        {
+            const auto expected = search_server.FindTopDocuments(query);
+            const auto found = coordinator.FindTopDocuments(query);
+            ASSERT_EQUAL_HINT(found.size(), expected.size(), query);
+            for (size_t ii = 0; ii < found.size(); ++ii)
+            {
+                ASSERT_HINT(abs(found[ii].relevance - expected[ii].relevance) < 1e-6,
+                            "Релевантность должна совпадать с нешардированным сервером"s);
+                ASSERT_EQUAL(found[ii].rating, expected[ii].rating);
+            }
+        }
+
+        const auto [words, status] = coordinator.MatchDocument("кот хвост -ошейник"s, 1);
+        ASSERT_EQUAL(words, (vector<string>{"кот"s, "хвост"s}));
+        ASSERT(status == DocumentStatus::ACTUAL);
+
+        bool thrown = false;
+        try
+        {
+            coordinator.AddDocument(3, "кот"s, DocumentStatus::ACTUAL, {});
+        }
+        catch (const invalid_argument&)
+        {
+            thrown = true;
+        }
+        ASSERT_HINT(thrown, "Ошибка шарда должна передаваться клиенту"s);
+
+        thrown = false;
+        try
+        {
+            coordinator.MatchDocument("кот"s, 42);
+        }
+        catch (const out_of_range&)
+        {
+            thrown = true;
+        }
+        ASSERT(thrown);
+
+        coordinator.RemoveDocument(1);
+        ASSERT_EQUAL(coordinator.GetDocumentCount(), search_server.GetDocumentCount() - 1);
+    }
+
+    for (size_t ii = 0; ii < servers.size(); ++ii)
+    {
+        servers[ii]->Stop();
+        server_threads[ii].join();
+    }
+}
+
+void TestQueryServer()
+{
+    const string prefix = "unix:/tmp/search-server-test-"s + to_string(getpid());
+    QueryServerOptions options;
+    options.http_address = prefix + "-http.sock"s;
+    options.binary_address = prefix + "-binary.sock"s;
+    options.io_thread_count = 2;
+    options.worker_count = 2;
+
+    SearchServer search_server("и в на"s);
+    QueryServer server(search_server, options);
+    thread server_thread([&server]()
+    {
+        server.Run();
+    });
+
+    // Конвейер из нескольких запросов в одной записи; ответы должны прийти по порядку
+    const SocketHandle http = ConnectTo(options.http_address);
+    WriteAll(http.Get(),
+             "POST /documents?id=1&ratings=5,3 HTTP/1.1\r\nContent-Length: 26\r\n\r\n"
+             "fluffy cat and fluffy tail"
+             "POST /documents?id=2 HTTP/1.1\r\nContent-Length: 16\r\n\r\nwell-groomed dog"
+             "GET /search?query=fluffy+cat HTTP/1.1\r\n\r\n"
+             "GET /match?query=cat&id=42 HTTP/1.1\r\n\r\n"
+             "GET /count HTTP/1.1\r\nConnection: close\r\n\r\n"
+             "GET /count HTTP/1.1\r\n\r\n"s);
+    string output;
+    char buffer[4096];
+    for (ssize_t count = 0; (count = recv(http.Get(), buffer, sizeof(buffer), 0)) > 0;)
+    {
+        output.append(buffer, static_cast<size_t>(count));
+    }
+
+    vector<size_t> positions;
+    for (const string &expected : {"{\"added\": 1}"s, "{\"added\": 2}"s, "[{\"id\": 1, "s,
+                                  "HTTP/1.1 404"s, "Connection: close"s, "{\"document_count\": 2}"s})
+    {
+        positions.push_back(output.find(expected));
+        ASSERT_HINT(positions.back() != string::npos, expected);
+    }
+    ASSERT_HINT(is_sorted(positions.begin(), positions.end()),
+                "Ответы на конвейерные запросы должны идти в порядке запросов"s);
+    ASSERT_EQUAL_HINT(output.find("HTTP/1.1"s, positions.back()), string::npos,
+                      "Запросы после Connection: close не обрабатываются"s);
+
+    ShardCoordinator binary_client({options.binary_address});
+    const auto found = binary_client.FindTopDocuments("dog"s);
+    ASSERT_EQUAL(found.size(), 1U);
+    ASSERT_EQUAL(found[0].id, 2);
+    binary_client.RemoveDocument(2);
+    ASSERT_EQUAL(binary_client.GetDocumentCount(), 1);
+
+    server.Stop();
+    server_thread.join();
+}
+
+void TestPositionalIndex()
+{
+    SearchServer server("in the"s);
+    server.AddDocument(1, "white cat in the city"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "city cat white"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "white dog and cat"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(4, "cat white cat"s, DocumentStatus::ACTUAL, {4});
+
+    const auto found_ids = [&server](const string &query)
+    {
+        vector<int> ids;
+        for (const auto &document : server.FindTopDocuments(query))
+        {
+            ids.push_back(document.id);
+        }
+        sort(ids.begin(), ids.end());
+        return ids;
+    };
+
+    bool thrown = false;
+    try
+    {
+        server.FindTopDocuments("\"white cat\""s);
+    }
+    catch (const invalid_argument&)
+    {
+        thrown = true;
+    }
+    ASSERT_HINT(thrown, "Фразовый запрос без позиционного индекса должен бросать исключение"s);
+
+    server.EnablePositionalIndex();
+    ASSERT(server.HasPositionalIndex());
+    ASSERT_EQUAL(found_ids("\"white cat\""s), (vector<int>{1, 4}));
+    ASSERT_HINT(found_ids("\"cat in the city\""s) == vector<int>{1},
+                "Стоп-слова внутри фразы занимают позицию"s);
+    ASSERT(found_ids("\"cat city\""s).empty());
+    ASSERT_EQUAL(found_ids("\"white cat\" -city"s), vector<int>{4});
+    ASSERT_EQUAL(found_ids("white NEAR/1 cat"s), (vector<int>{1, 2, 4}));
+    ASSERT_EQUAL(found_ids("white NEAR/3 cat"s), (vector<int>{1, 2, 3, 4}));
+    ASSERT_EQUAL(found_ids("cat NEAR/1 cat"s), vector<int>{});
+    ASSERT_EQUAL(found_ids("cat NEAR/2 cat"s), vector<int>{4});
+
+    const auto [words, status] = server.MatchDocument("\"white cat\""s, 1);
+    ASSERT_EQUAL(words, (vector<string_view>{"cat"sv, "white"sv}));
+    ASSERT(get<0>(server.MatchDocument("\"white cat\""s, 2)).empty());
+
+    for (const string &query : {"\"white cat"s, "white NEAR/x cat"s, "NEAR/2 cat"s,
+                               "white NEAR/2"s, "\"white -cat\""s})
+    {
+        thrown = false;
+        try
+        {
+            server.FindTopDocuments(query);
+        }
+        catch (const invalid_argument&)
+        {
+            thrown = true;
+        }
+        ASSERT_HINT(thrown, query);
+    }
+
+    server.AddDocument(5, "white cat"s, DocumentStatus::ACTUAL, {5});
+    server.RemoveDocument(1);
+    ASSERT_EQUAL(found_ids("\"white cat\""s), (vector<int>{4, 5}));
+    ASSERT(found_ids("\"cat in the city\""s).empty());
+
+    // Слова "white dog" остаются только в удаляемых вместе документах
+    server.AddDocument(6, "dog white cat"s, DocumentStatus::ACTUAL, {6});
+    server.AddDocument(7, "white dog"s, DocumentStatus::ACTUAL, {7});
+    server.RemoveDocuments({2, 3, 4, 5, 7});
+    ASSERT_EQUAL(found_ids("\"white cat\""s), vector<int>{6});
+    ASSERT_EQUAL(found_ids("\"dog white\""s), vector<int>{6});
+    ASSERT(found_ids("\"white dog\""s).empty());
+
+    for (int id = 10; id < 30; ++id)
+    {
+        server.AddDocument(id, "cat white cat"s, DocumentStatus::ACTUAL, {id});
+    }
+    for (int id = 10; id < 26; ++id)
+    {
+        server.RemoveDocument(id);
+    }
+    ASSERT_HINT(found_ids("\"white cat\""s) == (vector<int>{6, 26, 27, 28, 29}),
+                "Позиции сохраняются после уплотнения буфера"s);
+    ASSERT_EQUAL(found_ids("cat NEAR/2 cat"s), (vector<int>{26, 27, 28, 29}));
+}
+
+void TestTermDictionary()
+{
+    TermDictionary dictionary;
+    set<string> expected;
+    const auto check = [&dictionary, &expected](const string &prefix)
+    {
+        vector<string> found;
+        dictionary.ForEachWithPrefix(prefix, [&found](string_view term)
+        {
+            found.emplace_back(term);
+        });
+        vector<string> expected_terms;
+        for (const string &term : expected)
+        {
+            if (term.substr(0, prefix.size()) == prefix)
+            {
+                expected_terms.push_back(term);
+            }
+        }
+        ASSERT_EQUAL_HINT(found, expected_terms, prefix);
+    };
+
+    // Порядок вставки перемешан, слияния с блоками происходят по ходу
+    for (int ii = 0; ii < 1000; ++ii)
+    {
+        const string term = "w"s + to_string(ii * 379 % 1000);
+        dictionary.Insert(term);
+        expected.insert(term);
+    }
+    for (int ii = 0; ii < 1000; ii += 3)
+    {
+        dictionary.Erase("w"s + to_string(ii));
+        expected.erase("w"s + to_string(ii));
+    }
+    for (int ii = 0; ii < 100; ii += 9)
+    {
+        dictionary.Insert("w"s + to_string(ii));
+        expected.insert("w"s + to_string(ii));
+    }
+    dictionary.Insert("w1"s);
+    dictionary.Erase("absent"s);
+
+    ASSERT_EQUAL(dictionary.GetSize(), expected.size());
+    ASSERT(dictionary.Contains("w1"s) && dictionary.Contains("w9"s));
+    ASSERT(!dictionary.Contains("w3"s) && !dictionary.Contains("w"s) && !dictionary.Contains("x"s));
+    for (const string &prefix : {""s, "w"s, "w1"s, "w99"s, "w3"s, "w999"s, "w9990"s, "x"s})
+    {
+        check(prefix);
+    }
+}
+
+void TestPrefixQueries()
+{
+    SearchServer server("and"s);
+    for (int id = 0; id < 70; ++id)
+    {
+        const string word = "cat"s + (id < 10 ? "0"s : ""s) + to_string(id);
+        server.AddDocument(id, word, DocumentStatus::ACTUAL, {id});
+    }
+    server.AddDocument(100, "catzz"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(101, "catzz and dog"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(102, "dog"s, DocumentStatus::ACTUAL, {1});
+
+    ASSERT_EQUAL(get<0>(server.MatchDocument("cat0*"s, 7)), vector<string_view>{"cat07"sv});
+    ASSERT(get<0>(server.MatchDocument("dog*"s, 7)).empty());
+
+    // 71 words start with cat, the most frequent one must survive the cap
+    ASSERT_EQUAL(get<0>(server.MatchDocument("cat*"s, 100)), vector<string_view>{"catzz"sv});
+    ASSERT_EQUAL(get<0>(server.MatchDocument("cat*"s, 0)), vector<string_view>{"cat00"sv});
+    ASSERT_HINT(get<0>(server.MatchDocument("cat*"s, 69)).empty(),
+                "Расширение префикса ограничено самыми частыми словами"s);
+
+    const auto found = server.FindTopDocuments("dog -cat*"s);
+    ASSERT_EQUAL(found.size(), 1U);
+    ASSERT_HINT(found[0].id == 102, "Минус-префикс исключает все расширения"s);
+    ASSERT(server.FindTopDocuments("an*"s).empty());
+
+    for (const string &query : {"*"s, "-*"s})
+    {
+        bool thrown = false;
+        try
+        {
+            server.FindTopDocuments(query);
+        }
+        catch (const invalid_argument&)
+        {
+            thrown = true;
+        }
+        ASSERT_HINT(thrown, query);
+    }
+}
+
+void TestStopWordSet()
+{
+    const StopWordSet stop_words(vector<string>{"in"s, "the"s, ""s, "in"s, "and"s});
+    ASSERT_EQUAL(stop_words.size(), 3U);
+    for (const string_view word : {"in"sv, "the"sv, "and"sv})
+    {
+        ASSERT_HINT(stop_words.Contains(word), string{word});
+    }
+    for (const string_view word : {"i"sv, "inn"sv, "th"sv, ""sv, "cat"sv})
+    {
+        ASSERT_HINT(!stop_words.Contains(word), string{word});
+    }
+
+    vector<string> many_words;
+    for (int ii = 0; ii < 1000; ++ii)
+    {
+        many_words.push_back("w"s + to_string(ii));
+    }
+    const StopWordSet many_stop_words(many_words);
+    ASSERT(all_of(many_words.begin(), many_words.end(), [&many_stop_words](const string &word)
+    {
+        return many_stop_words.Contains(word);
+    }));
+    ASSERT(!many_stop_words.Contains("w1000"sv));
+
+    static constexpr auto table = MakeStopWordTable({"in"sv, "the"sv, "and"sv});
+    static_assert(table.Contains("the"sv), "Compile-time stop word lookup");
+    static_assert(!table.Contains("cat"sv), "Compile-time stop word lookup");
+
+    SearchServer server(table);
+    server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_HINT(server.FindTopDocuments("in"s).empty(),
+                "Стоп-слова из таблицы времени компиляции исключаются из документа"s);
+    ASSERT_EQUAL(get<0>(server.MatchDocument("the cat"s, 1)), vector<string_view>{"cat"sv});
+
+    bool thrown = false;
+    try
+    {
+        SearchServer invalid_server(MakeStopWordTable({"in"sv, "b\x12"sv}));
+    }
+    catch (const invalid_argument&)
+    {
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+
+void TestCorpusLoader()
+{
+    const string path = "/tmp/search_server_corpus_"s + to_string(getpid());
+    {
+        ofstream output(path);
+        output << "plain text one\n5\tBANNED\t1,2,3\tcat dog\n\r\nlast"s;
+    }
+
+    SearchServer server(""s);
+    CorpusLoadOptions options;
+    options.batch_size = 1;
+    options.queue_capacity = 1;
+    ASSERT_EQUAL(LoadCorpus(server, path, options), 7);
+    ASSERT_EQUAL(server.GetDocumentCount(), 4);
+    const auto banned = server.FindTopDocuments("cat"s, DocumentStatus::BANNED);
+    ASSERT_EQUAL(banned.size(), 1U);
+    ASSERT_EQUAL(banned[0].id, 5);
+    ASSERT_EQUAL(banned[0].rating, 2);
+    ASSERT_EQUAL(server.FindTopDocuments("last"s).at(0).id, 7);
+
+    {
+        string records;
+        AppendCorpusRecord(records, {3, DocumentStatus::ACTUAL, {4}, "fluffy cat"sv});
+        AppendCorpusRecord(records, {8, DocumentStatus::IRRELEVANT, {}, "dog"sv});
+        ofstream output(path, ios::binary);
+        output << records;
+    }
+    SearchServer records_server(""s);
+    ASSERT_EQUAL(LoadCorpus(records_server, path, CorpusLoadOptions{CorpusFormat::RECORDS}), 8);
+    ASSERT_EQUAL(records_server.FindTopDocuments("cat"s).at(0).rating, 4);
+    ASSERT_EQUAL(records_server.FindTopDocuments("dog"s, DocumentStatus::IRRELEVANT).at(0).id, 8);
+
+    {
+        ofstream output(path);
+        output << "1\tACTUAL\t1\tcat\nx\tACTUAL\t1\tdog\n"s;
+    }
+    bool thrown = false;
+    try
+    {
+        SearchServer broken_server(""s);
+        LoadCorpus(broken_server, path);
+    }
+    catch (const invalid_argument&)
+    {
+        thrown = true;
+    }
+    ASSERT_HINT(thrown, "Ошибка разбора корпуса передается вызывающему"s);
+    remove(path.c_str());
+}
+
+void TestQueryContextAllocations()
+{
+    SearchServer server("and in on"s);
+    server.AddDocument(1, "white cat and fashionable collar"s, DocumentStatus::ACTUAL, {8, -3});
+    server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(3, "well-groomed dog expressive eyes"s, DocumentStatus::ACTUAL, {5, -12, 2, 1});
+    server.AddDocument(4, "well-groomed starling evgeny"s, DocumentStatus::BANNED, {9});
+
+    const vector<string> queries = {"fluffy well-groomed cat"s, "cat -collar"s,
+                                    "dog and eyes in tail"s, "starling"s};
+    SearchServer::QueryContext context;
+    for (const string &query : queries)
+    {
+        const auto &found = server.FindTopDocuments(context, query);
+        const auto expected = server.FindTopDocuments(query);
+        ASSERT_EQUAL(found.size(), expected.size());
+        for (size_t ii = 0; ii < found.size(); ++ii)
+        {
+            ASSERT_EQUAL(found[ii].id, expected[ii].id);
+            ASSERT(abs(found[ii].relevance - expected[ii].relevance) < 1e-6);
+        }
+        const auto [words, status] = server.MatchDocument(context, query, 2);
+        ASSERT_EQUAL(words, get<0>(server.MatchDocument(query, 2)));
+    }
+
+    size_t found_count = 0;
+    const size_t allocations_before = GetThreadAllocationCount();
+    for (int round = 0; round < 3; ++round)
+    {
+        for (const string &query : queries)
+        {
+            found_count += server.FindTopDocuments(context, query).size();
+            found_count += server.FindTopDocuments(context, query, DocumentStatus::BANNED).size();
+            found_count += get<0>(server.MatchDocument(context, query, 3)).size();
+        }
+    }
+    const size_t allocations = GetThreadAllocationCount() - allocations_before;
+    ASSERT(found_count > 0U);
+    const size_t plain_allocations_before = GetThreadAllocationCount();
+    server.FindTopDocuments(queries[0]);
+    ASSERT(GetThreadAllocationCount() > plain_allocations_before);
+    ASSERT_EQUAL_HINT(allocations, 0U,
+                      "Повторные запросы через QueryContext не выделяют память"s);
+}
+
+// Records the threads that use it
+class ThreadRecordingResource : public std::pmr::memory_resource
+{
+public:
+    set<thread::id> GetThreads() const
+    {
+        lock_guard guard(mutex_);
+        return threads_;
+    }
+
+private:
+    void *do_allocate(size_t bytes, size_t alignment) override
+    {
+        Record();
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *memory, size_t bytes, size_t alignment) override
+    {
+        Record();
+        std::pmr::new_delete_resource()->deallocate(memory, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    void Record()
+    {
+        lock_guard guard(mutex_);
+        threads_.insert(this_thread::get_id());
+    }
+
+    mutable mutex mutex_;
+    set<thread::id> threads_;
+};
+
+void TestMemoryResource()
+{
+    const string first_text = "white cat and fashionable collar, long enough for the heap"s;
+    CountingMemoryResource resource;
+    {
+        SearchServer server("and"s, &resource);
+        ASSERT(server.GetMemoryResource() == &resource);
+        server.EnableImpactOrderedPostings();
+        server.EnablePositionalIndex();
+        server.AddDocument(1, first_text, DocumentStatus::ACTUAL, {1});
+        server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {2});
+
+        const size_t allocated = resource.GetAllocatedBytes();
+        ASSERT_HINT(allocated > first_text.size(), "Текст и индекс размещаются в ресурсе"s);
+        ASSERT(resource.GetAllocationCount() > 0U);
+        ASSERT_EQUAL(server.FindTopDocuments("\"white cat\""s).size(), 1U);
+
+        server.RemoveDocument(1);
+        ASSERT(resource.GetAllocatedBytes() < allocated);
+        ASSERT_EQUAL(server.FindTopDocuments("cat"s).at(0).id, 2);
+    }
+    ASSERT_EQUAL_HINT(resource.GetAllocatedBytes(), 0U,
+                      "Уничтожение сервера возвращает всю память ресурсу"s);
+    ASSERT(resource.GetPeakBytes() > first_text.size());
+
+    ThreadRecordingResource recording;
+    {
+        SearchServer server(""s, &recording);
+        server.EnableImpactOrderedPostings();
+        vector<int> document_ids;
+        for (int id = 0; id < 200; ++id)
+        {
+            server.AddDocument(id, "word"s + to_string(id) + " cat shared text"s,
+                               DocumentStatus::ACTUAL, {1});
+            document_ids.push_back(id);
+        }
+        document_ids.resize(150);
+        server.RemoveDocuments(execution::par, document_ids);
+        ASSERT_EQUAL(server.GetDocumentCount(), 50);
+    }
+    ASSERT_EQUAL_HINT(recording.GetThreads().size(), 1U,
+                      "Ресурс используется только из изменяющего сервер потока"s);
+
+    // An arena is released at once, after the server
+    std::pmr::monotonic_buffer_resource arena;
+    SearchServer arena_server(""s, &arena);
+    arena_server.AddDocument(1, first_text, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(arena_server.FindTopDocuments("cat"s).size(), 1U);
+}
+
+void TestDocumentFilters()
+{
+    SearchServer server(""s);
+    server.AddDocument(1, "cat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "cat dog"s, DocumentStatus::BANNED, {5});
+    server.AddDocument(3, "fluffy cat"s, DocumentStatus::ACTUAL, {4});
+    server.AddDocument(4, "cat collar"s, DocumentStatus::IRRELEVANT, {2});
+    server.AddDocument(5, "cat and dog"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(6, "old cat"s, DocumentStatus::REMOVED, {6});
+
+    const auto ids = [](const vector<Document> &documents)
+    {
+        set<int> result;
+        for (const Document &document : documents)
+        {
+            result.insert(document.id);
+        }
+        return result;
+    };
+    const auto check = [&server, &ids](const string &query, const auto &filter,
+            const set<int> &expected)
+    {
+        const auto lambda = [&filter](int document_id, DocumentStatus status, int rating)
+        {
+            return filter(document_id, status, rating);
+        };
+        ASSERT_EQUAL(ids(server.FindTopDocuments(query, filter)), expected);
+        ASSERT_EQUAL(ids(server.FindTopDocuments(query, lambda)), expected);
+        ASSERT_EQUAL_HINT(ids(server.FindTopDocuments(execution::par, query, filter)), expected,
+                          "Параллельный поиск применяет тот же фильтр"s);
+        ASSERT_EQUAL(server.FindTopDocuments(execution::par, query, filter).size(), expected.size());
+    };
+
+    check("cat"s, StatusFilter{DocumentStatus::ACTUAL, DocumentStatus::BANNED}, {1, 2, 3, 5});
+    check("cat"s, RatingRange{2, 4}, {3, 4, 5});
+    check("cat"s, IdRange{2, 4} && StatusFilter{DocumentStatus::ACTUAL}, {3});
+    check("cat"s, IdSet{1, 6} || RatingRange{5, 5}, {1, 2, 6});
+    check("cat -dog"s, IdRange{1, 5} && (IdSet{2, 3} || RatingRange{3, 3}), {3});
+    check("cat"s, IdRange{10, 20}, {});
+    check("cat"s, IdSet(vector<int>{}) || IdRange{5, 6}, {5, 6});
+
+    static_assert(!NeedsDocumentData<decltype(IdRange{1, 2} && IdSet{1})>());
+    static_assert(NeedsDocumentData<decltype(IdRange{1, 2} || RatingRange{1, 2})>());
+    ASSERT_HINT(IdSet(vector<int>{}).GetIdBounds().IsEmpty(),
+                "Пустое множество не принимает ни одного id"s);
+    ASSERT_EQUAL((IdRange{1, 4} && IdSet{3, 8}).GetIdBounds().last, 4);
+}
+
+void TestCursorPagination()
+{
+    SearchServer server(""s);
+    const vector<string> tails = {""s, " dog"s, " dog collar"s};
+    for (int id = 0; id < 12; ++id)
+    {
+        server.AddDocument(id, "cat"s + tails[id % 3], DocumentStatus::ACTUAL, {id % 2});
+    }
+    server.AddDocument(12, "lonely dog"s, DocumentStatus::ACTUAL, {1});
+
+    const SearchPage all = server.FindPage("cat"s, {}, 100);
+    ASSERT_EQUAL(all.documents.size(), 12U);
+    ASSERT(!all.next);
+
+    vector<int> paged_ids;
+    SearchCursor cursor;
+    size_t page_count = 0;
+    do
+    {
+        const SearchPage page = server.FindPage("cat"s, cursor, 5);
+        ASSERT(!page.documents.empty() && page.documents.size() <= 5U);
+        for (const Document &document : page.documents)
+        {
+            paged_ids.push_back(document.id);
+        }
+        ++page_count;
+        if (!page.next)
+        {
+            break;
+        }
+        // The token is all the client keeps between requests
+        cursor = SearchCursor::FromToken(page.next->ToToken());
+    } while (true);
+    ASSERT_EQUAL(page_count, 3U);
+    vector<int> all_ids;
+    for (const Document &document : all.documents)
+    {
+        all_ids.push_back(document.id);
+    }
+    ASSERT_EQUAL_HINT(paged_ids, all_ids, "Страницы продолжают одна другую без пропусков"s);
+    ASSERT(abs(server.FindPage("cat"s, {}, 5).documents.at(0).relevance -
+               server.FindTopDocuments("cat"s).at(0).relevance) < 1e-6);
+
+    const SearchCursor second = *server.FindPage("cat"s, {}, 5).next;
+    try
+    {
+        server.FindPage("dog"s, second, 5);
+        ASSERT_HINT(false, "Курсор другого запроса отклоняется"s);
+    }
+    catch (const invalid_argument&)
+    {
+    }
+    try
+    {
+        SearchCursor::FromToken("not a cursor"s);
+        ASSERT_HINT(false, "Испорченный токен отклоняется"s);
+    }
+    catch (const invalid_argument&)
+    {
+    }
+
+    // Pages are fetched only as the iteration reaches them
+    size_t fetch_count = 0;
+    CursorPaginator pages([&server, &fetch_count](const SearchCursor &page_cursor)
+    {
+        ++fetch_count;
+        return server.FindPage("cat"s, page_cursor, 5);
+    });
+    for (const auto &page : pages)
+    {
+        ASSERT_EQUAL(page.size(), 5);
+        break;
+    }
+    ASSERT_EQUAL(fetch_count, 1U);
+    size_t lazy_document_count = 0;
+    for (const auto &page : Paginate(server, "cat"s, 5))
+    {
+        lazy_document_count += page.size();
+    }
+    ASSERT_EQUAL(lazy_document_count, 12U);
+    ASSERT(Paginate(server, "absent"s, 5).begin() == Paginate(server, "absent"s, 5).end());
+
+    server.AddDocument(13, "cat"s, DocumentStatus::ACTUAL, {1});
+    try
+    {
+        server.FindPage("cat"s, second, 5);
+        ASSERT_HINT(false, "Курсор устаревает после изменения индекса"s);
+    }
+    catch (const StaleCursorError&)
+    {
+    }
+}
+
+void TestMemoryStats()
+{
+    CountingMemoryResource resource;
+    SearchServer server("and"s, &resource);
+    server.EnableImpactOrderedPostings();
+    server.EnablePositionalIndex();
+    server.AddDocument(1, "white cat and fashionable collar"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "fluffy cat fluffy tail and whiskers"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "well groomed dog with expressive eyes"s, DocumentStatus::ACTUAL, {3});
+
+    MemoryStats stats = server.GetMemoryStats();
+    ASSERT_EQUAL(stats.document_count, 3U);
+    ASSERT_EQUAL(stats.term_count, 13U);
+    ASSERT_EQUAL(stats.posting_count, 14U);
+    ASSERT(abs(stats.GetAveragePostingListLength() - 14.0 / 13.0) < 1e-9);
+    for (const MemoryUsage &usage : {stats.inverted_index, stats.term_dictionary,
+                                     stats.forward_index, stats.documents,
+                                     stats.document_texts, stats.document_words,
+                                     stats.impact_postings, stats.positions, stats.duplicates})
+    {
+        ASSERT(usage.bytes > 0U && usage.live_allocations > 0U);
+    }
+    ASSERT_EQUAL_HINT(stats.GetTotal().bytes, resource.GetAllocatedBytes(),
+                      "Вся память индекса учтена по структурам"s);
+
+    server.RemoveDocument(2);
+    stats = server.GetMemoryStats();
+    ASSERT_EQUAL(stats.document_count, 2U);
+    ASSERT_EQUAL(stats.posting_count, 10U);
+    ASSERT_EQUAL(stats.GetTotal().bytes, resource.GetAllocatedBytes());
+    server.RemoveDocuments({1, 3});
+    ASSERT_EQUAL(server.GetMemoryStats().posting_count, 0U);
+
+    ostringstream output;
+    PrintMemoryStats(output, stats);
+    ASSERT(output.str().find("inverted index: bytes = "s) != string::npos);
+}
+
 // Функция TestSearchServer является точкой входа для запуска тестов
 void TestSearchServer()
 {
@@ -673,6 +1993,30 @@ void TestSearchServer()
     RUN_TEST(TestPaginator);
     RUN_TEST(TestRequestQueue);
     RUN_TEST(TestRemoveDuplicates);
+    RUN_TEST(TestSubmitQuery);
+    RUN_TEST(TestBudgetedFindTopDocuments);
+    RUN_TEST(TestDuplicatePolicy);
+    RUN_TEST(TestNearDuplicates);
+    RUN_TEST(TestConcurrentRequestQueue);
+    RUN_TEST(TestRequestLatencyStats);
+    RUN_TEST(TestProfiler);
+    RUN_TEST(TestGetWordFrequencies);
+    RUN_TEST(TestMatchDocuments);
+    RUN_TEST(TestRemoveDocuments);
+    RUN_TEST(TestShardedSearchServer);
+    RUN_TEST(TestShardedPrefixQueries);
+    RUN_TEST(TestShardCoordinator);
+    RUN_TEST(TestQueryServer);
+    RUN_TEST(TestPositionalIndex);
+    RUN_TEST(TestTermDictionary);
+    RUN_TEST(TestPrefixQueries);
+    RUN_TEST(TestStopWordSet);
+    RUN_TEST(TestCorpusLoader);
+    RUN_TEST(TestQueryContextAllocations);
+    RUN_TEST(TestMemoryResource);
+    RUN_TEST(TestDocumentFilters);
+    RUN_TEST(TestCursorPagination);
+    RUN_TEST(TestMemoryStats);
 }
 
 // --------- Окончание модульных тестов поисковой системы -----------
@@ -0,0 +1,70 @@
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(size_t thread_count)
+{
+    if (thread_count == 0U)
+    {
+        thread_count = 1U;
+    }
+
+    workers_.reserve(thread_count);
+    for (size_t ii = 0; ii < thread_count; ++ii)
+    {
+        workers_.emplace_back([this]()
+        {
+            WorkerLoop();
+        });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard guard(mutex_);
+        stopping_ = true;
+    }
+    has_task_.notify_all();
+
+    for (std::thread &worker : workers_)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::Post(std::function<void()> task)
+{
+    {
+        std::lock_guard guard(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    has_task_.notify_one();
+}
+
+size_t ThreadPool::GetThreadCount() const
+{
+    return workers_.size();
+}
+
+void ThreadPool::WorkerLoop()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex_);
+            has_task_.wait(lock, [this]()
+            {
+                return stopping_ || !tasks_.empty();
+            });
+
+            if (tasks_.empty())
+            {
+                return;
+            }
+
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
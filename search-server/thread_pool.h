@@ -0,0 +1,59 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    explicit ThreadPool(size_t thread_count = std::thread::hardware_concurrency());
+
+    ThreadPool(const ThreadPool &other) = delete;
+
+    ThreadPool &operator=(const ThreadPool &other) = delete;
+
+    // Tasks already queued are executed before the workers are joined
+    ~ThreadPool();
+
+    void Post(std::function<void()> task);
+
+    template <typename Task>
+    std::future<std::invoke_result_t<Task>> Submit(Task task);
+
+    size_t GetThreadCount() const;
+
+private:
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable has_task_;
+    bool stopping_ = false;
+
+    void WorkerLoop();
+};
+
+template <typename Task>
+std::future<std::invoke_result_t<Task>> ThreadPool::Submit(Task task)
+{
+    using Result = std::invoke_result_t<Task>;
+
+    // std::function requires a copyable callable, packaged_task is move-only
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+    std::future<Result> result = packaged->get_future();
+    Post([packaged]()
+    {
+        (*packaged)();
+    });
+
+    return result;
+}
+
+#endif // THREAD_POOL_H